@@ -0,0 +1,233 @@
+/**
+ * @file host_main.c
+ * @brief Runs the FocusBar firmware as a Linux process
+ *
+ * The firmware's app_main() runs in a "main" task on the shim scheduler
+ * with the real-time clock, like on the device. Buttons are pressed by
+ * typing commands on stdin:
+ *
+ *   press <button> [ms]   Hold button 0-4 for ms milliseconds (default 100)
+ *   quit                  Stop the firmware
+ *
+ * Any other line is sent to the firmware's serial commands on UART0,
+ * e.g. "latency" for the button input latency report.
+ *
+ * With --pty, UART0 is a pseudo-terminal instead of stdout, so programs
+ * such as focusbar_ctl talk to this virtual FocusBar exactly as to the
+ * board's USB serial port. The terminal's path is printed at startup,
+ * and --pty LINK also makes LINK a symlink to it. The log stays on stderr.
+ *
+ * --uart-sleep makes UART0 lose the input that wakes the chip from light
+ * sleep, as the board does, so hosts can be tested against it.
+ *
+ * Usage: focusbar_host [--trace FILE] [--seconds N] [--pty [LINK]] [--uart-sleep]
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#define _GNU_SOURCE
+#include "shim.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "driver/uart.h"
+#include "esp_log.h"
+#include "button.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+
+static const char *TAG = "host";
+
+#define CONSOLE_LINE_MAX        64
+#define CONSOLE_QUEUE_LENGTH    8
+#define DEFAULT_PRESS_MS        100
+
+typedef struct {
+    char text[CONSOLE_LINE_MAX];
+} console_line_t;
+
+static const uint8_t button_gpios[NUM_BUTTONS] = {
+    BUTTON_SW0_GPIO, BUTTON_SW1_GPIO, BUTTON_SW2_GPIO, BUTTON_SW3_GPIO, BUTTON_SW4_GPIO
+};
+
+static QueueHandle_t console_queue = NULL;
+static console_line_t console_partial;
+static size_t console_partial_len = 0;
+
+void app_main(void);
+
+/**
+ * @brief Task wrapper matching how ESP-IDF starts app_main()
+ */
+static void main_task(void *pvParameters)
+{
+    app_main();
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief stdin readable: split input into lines for the console task
+ */
+static void console_input_ready(int fd, void *arg)
+{
+    char chunk[CONSOLE_LINE_MAX];
+    ssize_t got = read(fd, chunk, sizeof(chunk));
+    if (got <= 0) {
+        shim_unwatch_fd(fd);
+        return;
+    }
+
+    for (ssize_t i = 0; i < got; i++) {
+        if (chunk[i] == '\n') {
+            console_partial.text[console_partial_len] = '\0';
+            xQueueSendFromISR(console_queue, &console_partial, NULL);
+            console_partial_len = 0;
+        } else if (console_partial_len < CONSOLE_LINE_MAX - 1) {
+            console_partial.text[console_partial_len++] = chunk[i];
+        }
+    }
+}
+
+/**
+ * @brief Execute console commands
+ */
+static void console_task(void *pvParameters)
+{
+    console_line_t line;
+
+    while (1) {
+        if (xQueueReceive(console_queue, &line, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        int button;
+        int press_ms = DEFAULT_PRESS_MS;
+        if (sscanf(line.text, "press %d %d", &button, &press_ms) >= 1) {
+            if (button < 0 || button >= NUM_BUTTONS || press_ms <= 0) {
+                ESP_LOGW(TAG, "Usage: press <0-%d> [ms]", NUM_BUTTONS - 1);
+                continue;
+            }
+            shim_gpio_drive(button_gpios[button], 1);
+            vTaskDelay(pdMS_TO_TICKS(press_ms));
+            shim_gpio_drive(button_gpios[button], 0);
+        } else if (strncmp(line.text, "quit", 4) == 0) {
+            shim_stop();
+        } else if (line.text[0] != '\0') {
+            // Everything else is for the device's serial console
+            size_t length = strlen(line.text);
+            line.text[length] = '\n';
+            shim_uart_receive(UART_NUM_0, line.text, length + 1);
+        }
+    }
+}
+
+static void stop_callback(void *arg)
+{
+    shim_stop();
+}
+
+/**
+ * @brief Create the pseudo-terminal that stands in for the USB serial port
+ *
+ * The terminal side is set raw, so frames pass unchanged, and is kept
+ * open here: the device side then keeps working while no program has
+ * the port open, and output nobody reads is dropped once the terminal's
+ * buffer is full, as a disconnected USB port would.
+ *
+ * @param link_path Symlink to create to the terminal, or NULL
+ * @return Device side file descriptor, or -1 on failure
+ */
+static int open_virtual_port(const char *link_path)
+{
+    int device_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (device_fd < 0 || grantpt(device_fd) != 0 || unlockpt(device_fd) != 0) {
+        perror("posix_openpt");
+        return -1;
+    }
+    const char *path = ptsname(device_fd);
+    int terminal_fd = path != NULL ? open(path, O_RDWR | O_NOCTTY) : -1;
+    struct termios tio;
+    if (terminal_fd < 0 || tcgetattr(terminal_fd, &tio) != 0) {
+        perror("ptsname");
+        close(device_fd);
+        return -1;
+    }
+    cfmakeraw(&tio);
+    tcsetattr(terminal_fd, TCSANOW, &tio);
+    fcntl(device_fd, F_SETFL, fcntl(device_fd, F_GETFL) | O_NONBLOCK);
+
+    if (link_path != NULL) {
+        unlink(link_path);
+        if (symlink(path, link_path) != 0) {
+            perror(link_path);
+        }
+    }
+    printf("Virtual FocusBar on %s\n", link_path != NULL ? link_path : path);
+    fflush(stdout);
+    return device_fd;
+}
+
+int main(int argc, char **argv)
+{
+    const char *trace_path = NULL;
+    double seconds = 0.0;
+    bool virtual_port = false;
+    bool uart_sleep = false;
+    const char *link_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--pty") == 0) {
+            virtual_port = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                link_path = argv[++i];
+            }
+        } else if (strcmp(argv[i], "--uart-sleep") == 0) {
+            uart_sleep = true;
+        } else {
+            fprintf(stderr, "Usage: %s [--trace FILE] [--seconds N] [--pty [LINK]] [--uart-sleep]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    shim_init(SHIM_CLOCK_REAL);
+    if (trace_path != NULL && !shim_trace_open(trace_path)) {
+        return 1;
+    }
+    if (seconds > 0.0) {
+        shim_post_callback((int64_t)(seconds * 1000000.0), stop_callback, NULL);
+    }
+
+    // The device console is UART0; its output goes to stdout here, or to
+    // the virtual serial port
+    if (virtual_port) {
+        int port_fd = open_virtual_port(link_path);
+        if (port_fd < 0) {
+            return 1;
+        }
+        shim_uart_attach(UART_NUM_0, port_fd, port_fd);
+    } else {
+        shim_uart_attach(UART_NUM_0, -1, STDOUT_FILENO);
+    }
+    shim_uart_emulate_sleep(UART_NUM_0, uart_sleep);
+
+    console_queue = xQueueCreate(CONSOLE_QUEUE_LENGTH, sizeof(console_line_t));
+    shim_watch_fd(STDIN_FILENO, console_input_ready, NULL);
+    xTaskCreate(console_task, "console", 4096, NULL, 2, NULL);
+    xTaskCreate(main_task, "main", 3584, NULL, 1, NULL);
+
+    shim_run();
+    shim_trace_close();
+    if (link_path != NULL) {
+        unlink(link_path);
+    }
+    return 0;
+}
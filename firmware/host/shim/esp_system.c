@@ -0,0 +1,299 @@
+/**
+ * @file esp_system.c
+ * @brief Host shims for logging, errors, time, reset reason, power management and tracing
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#define _GNU_SOURCE
+
+#include "shim.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_pm.h"
+#include "esp_system.h"
+#include "sdkconfig.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <sys/time.h>
+
+static const char *TAG = "shim";
+
+static esp_log_level_t log_level = (esp_log_level_t)-1;  // Resolved on first use
+static int log_to_stderr(const char *format, va_list args);
+static vprintf_like_t log_vprintf = log_to_stderr;
+static FILE *trace_file = NULL;
+static esp_reset_reason_t reset_reason = ESP_RST_POWERON;
+static int64_t rtc_boot_us = 0;         // RTC time at shim_init(), i.e. at boot
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_NVS_NOT_INITIALIZED: return "ESP_ERR_NVS_NOT_INITIALIZED";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_NOT_ENOUGH_SPACE: return "ESP_ERR_NVS_NOT_ENOUGH_SPACE";
+        case ESP_ERR_NVS_INVALID_HANDLE: return "ESP_ERR_NVS_INVALID_HANDLE";
+        case ESP_ERR_NVS_READ_ONLY: return "ESP_ERR_NVS_READ_ONLY";
+        case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+        case ESP_ERR_NVS_NO_FREE_PAGES: return "ESP_ERR_NVS_NO_FREE_PAGES";
+        case ESP_ERR_NVS_NEW_VERSION_FOUND: return "ESP_ERR_NVS_NEW_VERSION_FOUND";
+        default: return "UNKNOWN ERROR";
+    }
+}
+
+/**
+ * @brief Parse a level name or letter from FOCUSBAR_LOG_LEVEL
+ */
+static esp_log_level_t parse_log_level(const char *name)
+{
+    static const char *const names[] = { "none", "error", "warn", "info", "debug", "verbose" };
+    for (int i = 0; i <= ESP_LOG_VERBOSE; i++) {
+        if (strcasecmp(name, names[i]) == 0 || (name[1] == '\0' && (name[0] | 0x20) == names[i][0])) {
+            return (esp_log_level_t)i;
+        }
+    }
+    return ESP_LOG_INFO;
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    // Per-tag levels are not needed on the host; every tag shares one level
+    (void)tag;
+    log_level = level;
+}
+
+esp_log_level_t esp_log_level_get(const char *tag)
+{
+    (void)tag;
+    if (log_level == (esp_log_level_t)-1) {
+        const char *env = getenv("FOCUSBAR_LOG_LEVEL");
+        log_level = env != NULL ? parse_log_level(env) : (esp_log_level_t)CONFIG_LOG_DEFAULT_LEVEL;
+    }
+    return log_level;
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return (uint32_t)(shim_now_us() / 1000);
+}
+
+/**
+ * @brief Default log output: the device console is stderr here
+ */
+static int log_to_stderr(const char *format, va_list args)
+{
+    return vfprintf(stderr, format, args);
+}
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func)
+{
+    vprintf_like_t previous = log_vprintf;
+    log_vprintf = func;
+    return previous;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    (void)level;
+    (void)tag;
+    va_list args;
+    va_start(args, format);
+    log_vprintf(format, args);
+    va_end(args);
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return shim_now_us();
+}
+
+/**
+ * @brief System time, as newlib keeps it on the RTC timer on the device
+ *
+ * Replaces the C library's gettimeofday() so the firmware's wall clock
+ * follows the shim clock, starting from the time set with shim_set_rtc_us().
+ */
+int gettimeofday(struct timeval *tv, void *tz)
+{
+    (void)tz;
+    int64_t now_us = rtc_boot_us + shim_now_us();
+    tv->tv_sec = now_us / 1000000;
+    tv->tv_usec = now_us % 1000000;
+    return 0;
+}
+
+void shim_set_rtc_us(int64_t rtc_us)
+{
+    rtc_boot_us = rtc_us;
+}
+
+esp_reset_reason_t esp_reset_reason(void)
+{
+    return reset_reason;
+}
+
+void shim_set_reset_reason(int reason)
+{
+    reset_reason = (esp_reset_reason_t)reason;
+}
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (esp_cpu_cycle_count_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+
+struct esp_pm_lock {
+    esp_pm_lock_type_t type;
+    const char *name;
+    int count;
+    uint32_t acquisitions;      // Times the lock went from free to held
+    int64_t held_since_us;
+    int64_t held_total_us;
+    struct esp_pm_lock *next;
+};
+
+static esp_pm_lock_handle_t pm_locks = NULL;
+static int pm_locks_held = 0;               // Locks with a non-zero count
+static int64_t pm_free_since_us = 0;
+static int64_t pm_free_total_us = 0;        // Time light sleep was allowed
+
+static esp_pm_config_t pm_config = { .max_freq_mhz = 96, .min_freq_mhz = 96, .light_sleep_enable = false };
+
+esp_err_t esp_pm_configure(const void *config)
+{
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(&pm_config, config, sizeof(pm_config));
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_get_configuration(void *config)
+{
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(config, &pm_config, sizeof(pm_config));
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t lock_type, int arg, const char *name, esp_pm_lock_handle_t *out_handle)
+{
+    (void)arg;
+    if (out_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_pm_lock_handle_t lock = calloc(1, sizeof(*lock));
+    if (lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    lock->type = lock_type;
+    lock->name = name;
+    lock->next = pm_locks;
+    pm_locks = lock;
+    *out_handle = lock;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (handle->count++ == 0) {
+        handle->acquisitions++;
+        handle->held_since_us = shim_now_us();
+        if (pm_locks_held++ == 0) {
+            pm_free_total_us += handle->held_since_us - pm_free_since_us;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (handle->count == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (--handle->count == 0) {
+        int64_t now = shim_now_us();
+        handle->held_total_us += now - handle->held_since_us;
+        if (--pm_locks_held == 0) {
+            pm_free_since_us = now;
+        }
+    }
+    return ESP_OK;
+}
+
+int64_t shim_pm_unlocked_us(void)
+{
+    return pm_free_total_us + (pm_locks_held == 0 ? shim_now_us() - pm_free_since_us : 0);
+}
+
+bool shim_pm_asleep(void)
+{
+    return pm_config.light_sleep_enable && pm_locks_held == 0;
+}
+
+void shim_pm_report(FILE *out)
+{
+    for (esp_pm_lock_handle_t lock = pm_locks; lock != NULL; lock = lock->next) {
+        int64_t held_us = lock->held_total_us + (lock->count > 0 ? shim_now_us() - lock->held_since_us : 0);
+        fprintf(out, "PM lock %-12s %8" PRIu32 " acquisitions, held %10.3f s\n",
+                lock->name != NULL ? lock->name : "?", lock->acquisitions, held_us / 1e6);
+    }
+    fprintf(out, "No PM lock held for %.3f s (light sleep allowed)\n", shim_pm_unlocked_us() / 1e6);
+}
+
+bool shim_trace_open(const char *path)
+{
+    shim_trace_close();
+    trace_file = fopen(path, "w");
+    if (trace_file == NULL) {
+        ESP_LOGE(TAG, "Cannot open trace file %s", path);
+        return false;
+    }
+    return true;
+}
+
+void shim_trace_close(void)
+{
+    if (trace_file != NULL) {
+        fclose(trace_file);
+        trace_file = NULL;
+    }
+}
+
+void shim_trace_event(const char *event, const char *format, ...)
+{
+    if (trace_file == NULL) {
+        return;
+    }
+    fprintf(trace_file, "%" PRId64 " %s ", shim_now_us(), event);
+    va_list args;
+    va_start(args, format);
+    vfprintf(trace_file, format, args);
+    va_end(args);
+    fputc('\n', trace_file);
+}
@@ -0,0 +1,135 @@
+/**
+ * @file esp_timer.c
+ * @brief One-shot esp_timer shim on the shim callback queue
+ *
+ * As in ESP-IDF with ESP_TIMER_TASK dispatch, an expired timer is handed
+ * to a high-priority "esp_timer" task that runs the callback, so the
+ * callback may take mutexes and call drivers. The alarm itself is a shim
+ * callback, which the virtual clock jumps to like any other deadline.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#include "shim.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <stdlib.h>
+
+static const char *TAG = "shim_esp_timer";
+
+#define ESP_TIMER_TASK_PRIORITY     22      // ESP_TASK_TIMER_PRIO
+#define ESP_TIMER_QUEUE_LEN         8
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    const char *name;
+    bool armed;
+    int64_t alarm_us;
+};
+
+static QueueHandle_t expired_queue = NULL;
+
+/**
+ * @brief Alarm interrupt: pass the timer on to the esp_timer task
+ */
+static void timer_alarm(void *arg)
+{
+    esp_timer_handle_t timer = arg;
+    if (xQueueSendFromISR(expired_queue, &timer, NULL) != pdTRUE) {
+        ESP_LOGE(TAG, "Expired timer queue full, %s dropped", timer->name);
+    }
+}
+
+/**
+ * @brief Runs the callbacks of expired timers
+ *
+ * A timer stopped or restarted after its alarm fired is skipped.
+ */
+static void esp_timer_task(void *pvParameters)
+{
+    esp_timer_handle_t timer;
+    while (1) {
+        if (xQueueReceive(expired_queue, &timer, portMAX_DELAY) == pdTRUE &&
+            timer->armed && shim_now_us() >= timer->alarm_us) {
+            timer->armed = false;
+            timer->callback(timer->arg);
+        }
+    }
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    if (create_args == NULL || create_args->callback == NULL || out_handle == NULL ||
+        create_args->dispatch_method != ESP_TIMER_TASK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (expired_queue == NULL) {
+        expired_queue = xQueueCreate(ESP_TIMER_QUEUE_LEN, sizeof(esp_timer_handle_t));
+        if (expired_queue == NULL ||
+            xTaskCreate(esp_timer_task, "esp_timer", 4096, NULL, ESP_TIMER_TASK_PRIORITY, NULL) != pdPASS) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    esp_timer_handle_t timer = calloc(1, sizeof(*timer));
+    if (timer == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    timer->callback = create_args->callback;
+    timer->arg = create_args->arg;
+    timer->name = create_args->name != NULL ? create_args->name : "timer";
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = true;
+    timer->alarm_us = shim_now_us() + (int64_t)timeout_us;
+    if (!shim_post_callback(timer->alarm_us, timer_alarm, timer)) {
+        timer->armed = false;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (timer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    shim_cancel_callback(timer_alarm, timer);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (timer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    free(timer);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer != NULL && timer->armed;
+}
@@ -0,0 +1,765 @@
+/**
+ * @file freertos.c
+ * @brief FreeRTOS shim: cooperative scheduler, tasks, queues and notifications
+ *
+ * Every task is a ucontext coroutine with its own stack. The scheduler
+ * loop in shim_run() picks the highest-priority ready task (first come,
+ * first served within a priority) and runs it until it blocks. When no
+ * task is ready it fires due callbacks, polls watched descriptors and
+ * either sleeps (real clock) or jumps to the next deadline (virtual
+ * clock).
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#define _GNU_SOURCE
+
+#include "shim.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include <ucontext.h>
+#include <poll.h>
+#include <time.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "shim";
+
+#define SHIM_TICK_US        (1000000 / configTICK_RATE_HZ)
+#define SHIM_STACK_SCALE    16              // Host frames are much larger than RISC-V ones
+#define SHIM_STACK_MIN      (64 * 1024)
+#define SHIM_MAX_CALLBACKS  64
+#define SHIM_MAX_FDS        8
+
+typedef enum {
+    TASK_READY,
+    TASK_BLOCKED,
+    TASK_DELETED,
+} task_state_t;
+
+struct tskTaskControlBlock {
+    ucontext_t context;
+    void *stack;
+    TaskFunction_t function;
+    void *parameter;
+    char name[configMAX_TASK_NAME_LEN];
+    UBaseType_t priority;
+    task_state_t state;
+    const void *wait_object;        // What a blocked task waits for (NULL: only its deadline)
+    int64_t wake_time_us;           // Deadline of a blocked task
+    bool timed_out;
+    uint64_t ready_order;           // FIFO order among ready tasks of equal priority
+    uint32_t notify_value;
+    bool host_only;                 // Simulator or console task, not firmware
+    uint32_t wakeups;               // Times it ran first after every task was blocked
+    struct tskTaskControlBlock *next;
+};
+
+struct QueueDefinition {
+    uint8_t *storage;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t count;
+    UBaseType_t head;
+    char not_empty;                 // Wait objects: address only
+    char not_full;
+};
+
+typedef struct {
+    bool used;
+    int64_t when_us;
+    uint64_t order;
+    shim_callback_t callback;
+    void *arg;
+} shim_pending_callback_t;
+
+typedef struct {
+    int fd;
+    shim_fd_handler_t handler;
+    void *arg;
+} shim_watch_t;
+
+static shim_clock_mode_t clock_mode = SHIM_CLOCK_REAL;
+static struct timespec clock_epoch;
+static int64_t virtual_now_us = 0;
+
+static ucontext_t scheduler_context;
+static TaskHandle_t task_list = NULL;
+static TaskHandle_t current_task = NULL;
+static uint64_t ready_sequence = 0;
+static int isr_nesting = 0;
+static bool stop_requested = false;
+static bool sleeping = false;           // No firmware task has run since the last idle
+static uint32_t wakeup_count = 0;
+
+static shim_pending_callback_t callbacks[SHIM_MAX_CALLBACKS];
+static uint64_t callback_sequence = 0;
+static shim_watch_t watches[SHIM_MAX_FDS];
+static int watch_count = 0;
+
+/**
+ * @brief Host monotonic time in microseconds
+ */
+static int64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void shim_init(shim_clock_mode_t mode)
+{
+    clock_mode = mode;
+    clock_gettime(CLOCK_MONOTONIC, &clock_epoch);
+    virtual_now_us = 0;
+    stop_requested = false;
+    sleeping = false;
+    wakeup_count = 0;
+}
+
+int64_t shim_now_us(void)
+{
+    if (clock_mode == SHIM_CLOCK_VIRTUAL) {
+        return virtual_now_us;
+    }
+    return monotonic_us() - ((int64_t)clock_epoch.tv_sec * 1000000 + clock_epoch.tv_nsec / 1000);
+}
+
+int64_t shim_ticks_to_deadline(uint32_t ticks)
+{
+    if (ticks == portMAX_DELAY) {
+        return SHIM_NO_DEADLINE;
+    }
+    // FreeRTOS timeouts expire on a tick boundary
+    return (shim_now_us() / SHIM_TICK_US + ticks) * SHIM_TICK_US;
+}
+
+void shim_stop(void)
+{
+    stop_requested = true;
+}
+
+void shim_mark_host_task(TaskHandle_t task)
+{
+    if (task == NULL) {
+        task = current_task;
+    }
+    if (task != NULL) {
+        task->host_only = true;
+    }
+}
+
+uint32_t shim_wakeup_count(void)
+{
+    return wakeup_count;
+}
+
+void shim_wakeup_report(FILE *out)
+{
+    for (TaskHandle_t task = task_list; task != NULL; task = task->next) {
+        if (!task->host_only && task->state != TASK_DELETED) {
+            fprintf(out, "Task %-16s %8" PRIu32 " wakeups\n", task->name, task->wakeups);
+        }
+    }
+}
+
+void shim_isr_enter(void)
+{
+    isr_nesting++;
+}
+
+void shim_isr_exit(void)
+{
+    isr_nesting--;
+}
+
+BaseType_t xPortInIsrContext(void)
+{
+    return isr_nesting > 0 ? pdTRUE : pdFALSE;
+}
+
+/**
+ * @brief Put a task at the back of its priority's ready list
+ */
+static void make_ready(TaskHandle_t task, bool timed_out)
+{
+    task->state = TASK_READY;
+    task->wait_object = NULL;
+    task->timed_out = timed_out;
+    task->ready_order = ++ready_sequence;
+}
+
+/**
+ * @brief Hand the CPU back to the scheduler loop
+ */
+static void switch_to_scheduler(TaskHandle_t task)
+{
+    swapcontext(&task->context, &scheduler_context);
+}
+
+bool shim_block(const void *object, int64_t deadline_us)
+{
+    TaskHandle_t task = current_task;
+    if (task == NULL || isr_nesting > 0 || deadline_us <= shim_now_us()) {
+        return false;
+    }
+
+    task->state = TASK_BLOCKED;
+    task->wait_object = object;
+    task->wake_time_us = deadline_us;
+    task->timed_out = false;
+    switch_to_scheduler(task);
+    return !task->timed_out;
+}
+
+void shim_wake(const void *object)
+{
+    for (TaskHandle_t task = task_list; task != NULL; task = task->next) {
+        if (task->state == TASK_BLOCKED && task->wait_object == object && object != NULL) {
+            make_ready(task, false);
+        }
+    }
+}
+
+bool shim_post_callback(int64_t when_us, shim_callback_t callback, void *arg)
+{
+    for (int i = 0; i < SHIM_MAX_CALLBACKS; i++) {
+        if (!callbacks[i].used) {
+            callbacks[i] = (shim_pending_callback_t) {
+                .used = true,
+                .when_us = when_us,
+                .order = ++callback_sequence,
+                .callback = callback,
+                .arg = arg,
+            };
+            return true;
+        }
+    }
+    ESP_LOGE(TAG, "Callback table full");
+    return false;
+}
+
+void shim_cancel_callback(shim_callback_t callback, void *arg)
+{
+    for (int i = 0; i < SHIM_MAX_CALLBACKS; i++) {
+        if (callbacks[i].used && callbacks[i].callback == callback && callbacks[i].arg == arg) {
+            callbacks[i].used = false;
+        }
+    }
+}
+
+bool shim_watch_fd(int fd, shim_fd_handler_t handler, void *arg)
+{
+    if (watch_count >= SHIM_MAX_FDS) {
+        return false;
+    }
+    watches[watch_count++] = (shim_watch_t) { .fd = fd, .handler = handler, .arg = arg };
+    return true;
+}
+
+void shim_unwatch_fd(int fd)
+{
+    for (int i = 0; i < watch_count; i++) {
+        if (watches[i].fd == fd) {
+            watches[i] = watches[--watch_count];
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Run every callback that is due, oldest deadline first
+ */
+static void run_due_callbacks(int64_t now_us)
+{
+    while (1) {
+        shim_pending_callback_t *due = NULL;
+        for (int i = 0; i < SHIM_MAX_CALLBACKS; i++) {
+            shim_pending_callback_t *cb = &callbacks[i];
+            if (cb->used && cb->when_us <= now_us &&
+                (due == NULL || cb->when_us < due->when_us ||
+                 (cb->when_us == due->when_us && cb->order < due->order))) {
+                due = cb;
+            }
+        }
+        if (due == NULL) {
+            return;
+        }
+        due->used = false;
+        shim_isr_enter();
+        due->callback(due->arg);
+        shim_isr_exit();
+    }
+}
+
+/**
+ * @brief Wake blocked tasks whose deadline has passed
+ */
+static void release_expired_tasks(int64_t now_us)
+{
+    for (TaskHandle_t task = task_list; task != NULL; task = task->next) {
+        if (task->state == TASK_BLOCKED && task->wake_time_us <= now_us) {
+            make_ready(task, true);
+        }
+    }
+}
+
+/**
+ * @brief Earliest task deadline or callback time
+ */
+static int64_t next_deadline(void)
+{
+    int64_t next = SHIM_NO_DEADLINE;
+    for (TaskHandle_t task = task_list; task != NULL; task = task->next) {
+        if (task->state == TASK_BLOCKED && task->wake_time_us < next) {
+            next = task->wake_time_us;
+        }
+    }
+    for (int i = 0; i < SHIM_MAX_CALLBACKS; i++) {
+        if (callbacks[i].used && callbacks[i].when_us < next) {
+            next = callbacks[i].when_us;
+        }
+    }
+    return next;
+}
+
+/**
+ * @brief Poll the watched descriptors and dispatch readable ones
+ *
+ * @param timeout_us How long to wait, negative to wait forever
+ */
+static void poll_watches(int64_t timeout_us)
+{
+    struct pollfd fds[SHIM_MAX_FDS];
+    for (int i = 0; i < watch_count; i++) {
+        fds[i] = (struct pollfd) { .fd = watches[i].fd, .events = POLLIN };
+    }
+
+    struct timespec timeout;
+    if (timeout_us >= 0) {
+        timeout.tv_sec = timeout_us / 1000000;
+        timeout.tv_nsec = (timeout_us % 1000000) * 1000;
+    }
+    int ready = ppoll(fds, watch_count, timeout_us >= 0 ? &timeout : NULL, NULL);
+    if (ready <= 0) {
+        return;
+    }
+
+    int count = watch_count;
+    for (int i = 0; i < count; i++) {
+        if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+            for (int j = 0; j < watch_count; j++) {
+                if (watches[j].fd == fds[i].fd) {
+                    shim_isr_enter();
+                    watches[j].handler(watches[j].fd, watches[j].arg);
+                    shim_isr_exit();
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Wait for the next event while no task is ready
+ *
+ * @return false if nothing can ever happen again
+ */
+static bool idle(void)
+{
+    int64_t next = next_deadline();
+
+    if (clock_mode == SHIM_CLOCK_VIRTUAL) {
+        if (watch_count > 0) {
+            poll_watches(next == SHIM_NO_DEADLINE ? -1 : 0);
+        } else if (next == SHIM_NO_DEADLINE) {
+            return false;
+        }
+        if (next != SHIM_NO_DEADLINE && next > virtual_now_us) {
+            virtual_now_us = next;
+        }
+        return true;
+    }
+
+    if (next == SHIM_NO_DEADLINE && watch_count == 0) {
+        return false;
+    }
+    int64_t timeout = next == SHIM_NO_DEADLINE ? -1 : next - shim_now_us();
+    if (timeout < 0 && next != SHIM_NO_DEADLINE) {
+        timeout = 0;
+    }
+    if (watch_count > 0) {
+        poll_watches(timeout);
+    } else if (timeout > 0) {
+        struct timespec ts = { .tv_sec = timeout / 1000000, .tv_nsec = (timeout % 1000000) * 1000 };
+        while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Highest-priority ready task, longest waiting first
+ */
+static TaskHandle_t pick_next_task(void)
+{
+    TaskHandle_t best = NULL;
+    for (TaskHandle_t task = task_list; task != NULL; task = task->next) {
+        if (task->state == TASK_READY &&
+            (best == NULL || task->priority > best->priority ||
+             (task->priority == best->priority && task->ready_order < best->ready_order))) {
+            best = task;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Free deleted tasks; only safe from the scheduler context
+ */
+static void reap_deleted_tasks(void)
+{
+    TaskHandle_t *link = &task_list;
+    while (*link != NULL) {
+        TaskHandle_t task = *link;
+        if (task->state == TASK_DELETED) {
+            *link = task->next;
+            free(task->stack);
+            free(task);
+        } else {
+            link = &task->next;
+        }
+    }
+}
+
+void shim_run(void)
+{
+    stop_requested = false;
+    while (!stop_requested) {
+        int64_t now = shim_now_us();
+        run_due_callbacks(now);
+        release_expired_tasks(now);
+
+        TaskHandle_t task = pick_next_task();
+        if (task != NULL) {
+            if (sleeping && !task->host_only) {
+                wakeup_count++;
+                task->wakeups++;
+                sleeping = false;
+            }
+            current_task = task;
+            swapcontext(&scheduler_context, &task->context);
+            current_task = NULL;
+            reap_deleted_tasks();
+            continue;
+        }
+
+        sleeping = true;
+        if (!idle()) {
+            ESP_LOGW(TAG, "All tasks blocked forever, stopping");
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Coroutine entry point
+ */
+static void task_entry(void)
+{
+    TaskHandle_t task = current_task;
+    task->function(task->parameter);
+
+    // FreeRTOS tasks must never return
+    ESP_LOGE(TAG, "Task %s returned from its function", task->name);
+    vTaskDelete(NULL);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *const pcName, const uint32_t usStackDepth,
+                       void *const pvParameters, UBaseType_t uxPriority, TaskHandle_t *const pxCreatedTask)
+{
+    TaskHandle_t task = calloc(1, sizeof(*task));
+    size_t stack_size = (size_t)usStackDepth * SHIM_STACK_SCALE;
+    if (stack_size < SHIM_STACK_MIN) {
+        stack_size = SHIM_STACK_MIN;
+    }
+    if (task == NULL || (task->stack = malloc(stack_size)) == NULL) {
+        free(task);
+        return pdFAIL;
+    }
+
+    task->function = pxTaskCode;
+    task->parameter = pvParameters;
+    strncpy(task->name, pcName != NULL ? pcName : "", sizeof(task->name) - 1);
+    task->priority = uxPriority;
+
+    getcontext(&task->context);
+    task->context.uc_stack.ss_sp = task->stack;
+    task->context.uc_stack.ss_size = stack_size;
+    task->context.uc_link = NULL;
+    makecontext(&task->context, task_entry, 0);
+
+    make_ready(task, false);
+    task->next = task_list;
+    task_list = task;
+
+    if (pxCreatedTask != NULL) {
+        *pxCreatedTask = task;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+    TaskHandle_t task = xTaskToDelete != NULL ? xTaskToDelete : current_task;
+    if (task == NULL) {
+        return;
+    }
+    task->state = TASK_DELETED;
+    if (task == current_task) {
+        switch_to_scheduler(task);
+        abort();  // Never resumed
+    }
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay)
+{
+    if (xTicksToDelay == 0) {
+        vTaskYield();
+        return;
+    }
+    shim_block(NULL, shim_ticks_to_deadline(xTicksToDelay));
+}
+
+void vTaskYield(void)
+{
+    TaskHandle_t task = current_task;
+    if (task != NULL && isr_nesting == 0) {
+        make_ready(task, false);
+        switch_to_scheduler(task);
+    }
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(shim_now_us() / SHIM_TICK_US);
+}
+
+TickType_t xTaskGetTickCountFromISR(void)
+{
+    return xTaskGetTickCount();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return current_task;
+}
+
+char *pcTaskGetName(TaskHandle_t xTaskToQuery)
+{
+    TaskHandle_t task = xTaskToQuery != NULL ? xTaskToQuery : current_task;
+    return task != NULL ? task->name : NULL;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+    TaskHandle_t task = current_task;
+    if (task == NULL) {
+        return 0;
+    }
+
+    int64_t deadline = shim_ticks_to_deadline(xTicksToWait);
+    while (task->notify_value == 0) {
+        if (!shim_block(&task->notify_value, deadline)) {
+            break;
+        }
+    }
+
+    uint32_t value = task->notify_value;
+    if (value != 0) {
+        task->notify_value = xClearCountOnExit ? 0 : value - 1;
+    }
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify)
+{
+    xTaskToNotify->notify_value++;
+    shim_wake(&xTaskToNotify->notify_value);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    xTaskNotifyGive(xTaskToNotify);
+    if (pxHigherPriorityTaskWoken != NULL && xTaskToNotify->state == TASK_READY) {
+        *pxHigherPriorityTaskWoken = pdTRUE;
+    }
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+    QueueHandle_t queue = calloc(1, sizeof(*queue));
+    if (queue == NULL) {
+        return NULL;
+    }
+    if (uxItemSize > 0) {
+        queue->storage = malloc((size_t)uxQueueLength * uxItemSize);
+        if (queue->storage == NULL) {
+            free(queue);
+            return NULL;
+        }
+    }
+    queue->length = uxQueueLength;
+    queue->item_size = uxItemSize;
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t xQueue)
+{
+    if (xQueue != NULL) {
+        free(xQueue->storage);
+        free(xQueue);
+    }
+}
+
+/**
+ * @brief Copy an item into the queue, blocking while it is full
+ */
+static BaseType_t queue_send(QueueHandle_t queue, const void *item, TickType_t ticks, bool to_front)
+{
+    int64_t deadline = shim_ticks_to_deadline(ticks);
+    while (queue->count >= queue->length) {
+        if (!shim_block(&queue->not_full, deadline)) {
+            return errQUEUE_FULL;
+        }
+    }
+
+    UBaseType_t slot;
+    if (to_front) {
+        queue->head = (queue->head + queue->length - 1) % queue->length;
+        slot = queue->head;
+    } else {
+        slot = (queue->head + queue->count) % queue->length;
+    }
+    if (queue->item_size > 0) {
+        memcpy(queue->storage + (size_t)slot * queue->item_size, item, queue->item_size);
+    }
+    queue->count++;
+    shim_wake(&queue->not_empty);
+    return pdPASS;
+}
+
+/**
+ * @brief Copy the oldest item out of the queue, blocking while it is empty
+ */
+static BaseType_t queue_receive(QueueHandle_t queue, void *buffer, TickType_t ticks, bool remove)
+{
+    int64_t deadline = shim_ticks_to_deadline(ticks);
+    while (queue->count == 0) {
+        if (!shim_block(&queue->not_empty, deadline)) {
+            return errQUEUE_EMPTY;
+        }
+    }
+
+    if (queue->item_size > 0 && buffer != NULL) {
+        memcpy(buffer, queue->storage + (size_t)queue->head * queue->item_size, queue->item_size);
+    }
+    if (remove) {
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+        shim_wake(&queue->not_full);
+    }
+    return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+    return queue_send(xQueue, pvItemToQueue, xTicksToWait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+    return queue_send(xQueue, pvItemToQueue, xTicksToWait, true);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t xQueue, const void *pvItemToQueue, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    BaseType_t ret = queue_send(xQueue, pvItemToQueue, 0, false);
+    if (ret == pdPASS && pxHigherPriorityTaskWoken != NULL) {
+        *pxHigherPriorityTaskWoken = pdTRUE;
+    }
+    return ret;
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t xQueue, const void *pvItemToQueue)
+{
+    xQueue->count = 0;
+    return queue_send(xQueue, pvItemToQueue, 0, false);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+    return queue_receive(xQueue, pvBuffer, xTicksToWait, true);
+}
+
+BaseType_t xQueueReceiveFromISR(QueueHandle_t xQueue, void *pvBuffer, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    BaseType_t ret = queue_receive(xQueue, pvBuffer, 0, true);
+    if (ret == pdPASS && pxHigherPriorityTaskWoken != NULL) {
+        *pxHigherPriorityTaskWoken = pdTRUE;
+    }
+    return ret;
+}
+
+BaseType_t xQueuePeek(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+    return queue_receive(xQueue, pvBuffer, xTicksToWait, false);
+}
+
+BaseType_t xQueueReset(QueueHandle_t xQueue)
+{
+    xQueue->count = 0;
+    xQueue->head = 0;
+    shim_wake(&xQueue->not_full);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue)
+{
+    return xQueue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue)
+{
+    return xQueue->length - xQueue->count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return xQueueCreate(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t mutex = xQueueCreate(1, 0);
+    if (mutex != NULL) {
+        mutex->count = 1;
+    }
+    return mutex;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount)
+{
+    SemaphoreHandle_t semaphore = xQueueCreate(uxMaxCount, 0);
+    if (semaphore != NULL) {
+        semaphore->count = uxInitialCount;
+    }
+    return semaphore;
+}
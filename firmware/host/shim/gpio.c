@@ -0,0 +1,341 @@
+/**
+ * @file gpio.c
+ * @brief GPIO shim: host-driven input levels and edge interrupts
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#include "shim.h"
+#include "driver/gpio.h"
+#include "hal/gpio_ll.h"
+#include "driver/gpio_filter.h"
+#include "esp_sleep.h"
+#include <stdbool.h>
+
+// Flex glitch filters on the ESP32-H2
+#define SHIM_GLITCH_FILTERS 8
+
+// Pin glitch filters remove pulses of up to two IO_MUX clock cycles
+#define SHIM_PIN_FILTER_NS  100
+
+typedef struct {
+    gpio_mode_t mode;
+    gpio_int_type_t intr_type;
+    bool intr_enabled;
+    bool wakeup_enabled;
+    int level;                  // After the glitch filter
+    int raw_level;              // As driven
+    uint32_t filter_us;         // Stable time the glitch filter needs, 0 without one
+    gpio_isr_t isr_handler;
+    void *isr_arg;
+} shim_gpio_t;
+
+struct gpio_glitch_filter_t {
+    bool used;
+    bool enabled;
+    gpio_num_t gpio_num;
+    uint32_t thres_ns;
+};
+
+static shim_gpio_t gpios[GPIO_NUM_MAX];
+static struct gpio_glitch_filter_t filters[SHIM_GLITCH_FILTERS];
+static bool isr_service_installed = false;
+
+static bool gpio_valid(gpio_num_t gpio_num)
+{
+    return gpio_num >= 0 && gpio_num < GPIO_NUM_MAX;
+}
+
+esp_err_t gpio_config(const gpio_config_t *pGPIOConfig)
+{
+    if (pGPIOConfig == NULL || pGPIOConfig->pin_bit_mask == 0 || (pGPIOConfig->pin_bit_mask >> GPIO_NUM_MAX) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < GPIO_NUM_MAX; i++) {
+        if (pGPIOConfig->pin_bit_mask & (1ULL << i)) {
+            shim_gpio_t *gpio = &gpios[i];
+            gpio->mode = pGPIOConfig->mode;
+            gpio->intr_type = pGPIOConfig->intr_type;
+            gpio->intr_enabled = pGPIOConfig->intr_type != GPIO_INTR_DISABLE;
+            // An undriven input settles to its pull
+            gpio->level = pGPIOConfig->pull_up_en == GPIO_PULLUP_ENABLE ? 1 : 0;
+            gpio->raw_level = gpio->level;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num)
+{
+    if (!gpio_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpios[gpio_num] = (shim_gpio_t) { .mode = GPIO_MODE_DISABLE };
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+    if (!gpio_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpios[gpio_num].mode = mode;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (!gpio_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpios[gpio_num].level = level ? 1 : 0;
+    gpios[gpio_num].raw_level = gpios[gpio_num].level;
+    shim_trace_event("gpio", "gpio=%d level=%d", gpio_num, gpios[gpio_num].level);
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    return gpio_valid(gpio_num) ? gpios[gpio_num].level : 0;
+}
+
+/**
+ * @brief Run a pin's ISR handler if its interrupt condition holds
+ */
+static void check_interrupt(shim_gpio_t *gpio, int previous)
+{
+    bool fire;
+    switch (gpio->intr_type) {
+        case GPIO_INTR_POSEDGE: fire = previous == 0 && gpio->level == 1; break;
+        case GPIO_INTR_NEGEDGE: fire = previous == 1 && gpio->level == 0; break;
+        case GPIO_INTR_ANYEDGE: fire = previous != gpio->level; break;
+        case GPIO_INTR_LOW_LEVEL: fire = gpio->level == 0; break;
+        case GPIO_INTR_HIGH_LEVEL: fire = gpio->level == 1; break;
+        default: fire = false; break;
+    }
+    if (fire && gpio->intr_enabled && isr_service_installed && gpio->isr_handler != NULL) {
+        shim_isr_enter();
+        gpio->isr_handler(gpio->isr_arg);
+        shim_isr_exit();
+    }
+}
+
+/**
+ * @brief Deferred interrupt for a level that is already present when armed
+ */
+static void pending_level_interrupt(void *arg)
+{
+    shim_gpio_t *gpio = arg;
+    check_interrupt(gpio, gpio->level);
+}
+
+/**
+ * @brief Change the interrupt type; a level that already holds fires right away
+ */
+static void set_intr_type(shim_gpio_t *gpio, gpio_int_type_t intr_type)
+{
+    gpio->intr_type = intr_type;
+    if ((intr_type == GPIO_INTR_LOW_LEVEL && gpio->level == 0) ||
+        (intr_type == GPIO_INTR_HIGH_LEVEL && gpio->level == 1)) {
+        shim_post_callback(shim_now_us(), pending_level_interrupt, gpio);
+    } else {
+        shim_cancel_callback(pending_level_interrupt, gpio);
+    }
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type)
+{
+    if (!gpio_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    set_intr_type(&gpios[gpio_num], intr_type);
+    return ESP_OK;
+}
+
+void shim_gpio_ll_set_intr_type(uint32_t gpio_num, gpio_int_type_t intr_type)
+{
+    if (gpio_valid((gpio_num_t)gpio_num)) {
+        set_intr_type(&gpios[gpio_num], intr_type);
+    }
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t gpio_num, gpio_int_type_t intr_type)
+{
+    if (!gpio_valid(gpio_num) || (intr_type != GPIO_INTR_LOW_LEVEL && intr_type != GPIO_INTR_HIGH_LEVEL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // As on the device, the wakeup level is also the pin's interrupt type
+    gpios[gpio_num].wakeup_enabled = true;
+    set_intr_type(&gpios[gpio_num], intr_type);
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_disable(gpio_num_t gpio_num)
+{
+    if (!gpio_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpios[gpio_num].wakeup_enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio_num)
+{
+    if (!gpio_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpios[gpio_num].intr_enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t gpio_num)
+{
+    if (!gpio_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpios[gpio_num].intr_enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+    (void)intr_alloc_flags;
+    if (isr_service_installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    isr_service_installed = true;
+    return ESP_OK;
+}
+
+void gpio_uninstall_isr_service(void)
+{
+    isr_service_installed = false;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args)
+{
+    if (!isr_service_installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!gpio_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpios[gpio_num].isr_handler = isr_handler;
+    gpios[gpio_num].isr_arg = args;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num)
+{
+    if (!gpio_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpios[gpio_num].isr_handler = NULL;
+    gpios[gpio_num].isr_arg = NULL;
+    return ESP_OK;
+}
+
+/**
+ * @brief Pass the driven level through once it has been stable long enough
+ */
+static void apply_input(void *arg)
+{
+    shim_gpio_t *gpio = arg;
+    if (gpio->raw_level == gpio->level) {
+        return;
+    }
+    int previous = gpio->level;
+    gpio->level = gpio->raw_level;
+    shim_cancel_callback(pending_level_interrupt, gpio);
+    check_interrupt(gpio, previous);
+}
+
+void shim_gpio_drive(int gpio_num, int level)
+{
+    if (!gpio_valid(gpio_num)) {
+        return;
+    }
+    shim_gpio_t *gpio = &gpios[gpio_num];
+    gpio->raw_level = level ? 1 : 0;
+    shim_trace_event("gpio", "gpio=%d level=%d", gpio_num, gpio->raw_level);
+    if (gpio->filter_us == 0) {
+        apply_input(gpio);
+    } else {
+        // A change that does not last the filter time never gets through
+        shim_cancel_callback(apply_input, gpio);
+        shim_post_callback(shim_now_us() + gpio->filter_us, apply_input, gpio);
+    }
+}
+
+/**
+ * @brief Claim a filter slot for a pin
+ */
+static esp_err_t new_filter(gpio_num_t gpio_num, uint32_t thres_ns, gpio_glitch_filter_handle_t *ret_filter)
+{
+    if (!gpio_valid(gpio_num) || ret_filter == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < SHIM_GLITCH_FILTERS; i++) {
+        if (!filters[i].used) {
+            filters[i] = (struct gpio_glitch_filter_t) {
+                .used = true,
+                .gpio_num = gpio_num,
+                .thres_ns = thres_ns,
+            };
+            *ret_filter = &filters[i];
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t gpio_new_pin_glitch_filter(const gpio_pin_glitch_filter_config_t *config, gpio_glitch_filter_handle_t *ret_filter)
+{
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return new_filter(config->gpio_num, SHIM_PIN_FILTER_NS, ret_filter);
+}
+
+esp_err_t gpio_new_flex_glitch_filter(const gpio_flex_glitch_filter_config_t *config, gpio_glitch_filter_handle_t *ret_filter)
+{
+    if (config == NULL || config->window_thres_ns == 0 || config->window_thres_ns > config->window_width_ns) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return new_filter(config->gpio_num, config->window_thres_ns, ret_filter);
+}
+
+esp_err_t gpio_del_glitch_filter(gpio_glitch_filter_handle_t filter)
+{
+    if (filter == NULL || !filter->used || filter->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    filter->used = false;
+    return ESP_OK;
+}
+
+esp_err_t gpio_glitch_filter_enable(gpio_glitch_filter_handle_t filter)
+{
+    if (filter == NULL || !filter->used || filter->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    filter->enabled = true;
+    gpios[filter->gpio_num].filter_us = (filter->thres_ns + 999) / 1000;
+    return ESP_OK;
+}
+
+esp_err_t gpio_glitch_filter_disable(gpio_glitch_filter_handle_t filter)
+{
+    if (filter == NULL || !filter->used || !filter->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    filter->enabled = false;
+    gpios[filter->gpio_num].filter_us = 0;
+    return ESP_OK;
+}
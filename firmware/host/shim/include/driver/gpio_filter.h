@@ -0,0 +1,46 @@
+/**
+ * @file gpio_filter.h
+ * @brief Host shim for the ESP-IDF GPIO glitch filters
+ *
+ * An enabled filter holds back a level change on its pin until the input
+ * has been stable for the filter threshold, rounded up to the shim's
+ * 1 us resolution, so shorter pulses never reach the ISR.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    GLITCH_FILTER_CLK_SRC_DEFAULT = 0,
+} glitch_filter_clock_source_t;
+
+typedef struct gpio_glitch_filter_t *gpio_glitch_filter_handle_t;
+
+typedef struct {
+    glitch_filter_clock_source_t clk_src;
+    gpio_num_t gpio_num;
+} gpio_pin_glitch_filter_config_t;
+
+typedef struct {
+    glitch_filter_clock_source_t clk_src;
+    gpio_num_t gpio_num;
+    uint32_t window_width_ns;
+    uint32_t window_thres_ns;
+} gpio_flex_glitch_filter_config_t;
+
+esp_err_t gpio_new_pin_glitch_filter(const gpio_pin_glitch_filter_config_t *config, gpio_glitch_filter_handle_t *ret_filter);
+esp_err_t gpio_new_flex_glitch_filter(const gpio_flex_glitch_filter_config_t *config, gpio_glitch_filter_handle_t *ret_filter);
+esp_err_t gpio_del_glitch_filter(gpio_glitch_filter_handle_t filter);
+esp_err_t gpio_glitch_filter_enable(gpio_glitch_filter_handle_t filter);
+esp_err_t gpio_glitch_filter_disable(gpio_glitch_filter_handle_t filter);
+
+#ifdef __cplusplus
+}
+#endif
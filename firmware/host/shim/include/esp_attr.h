@@ -0,0 +1,13 @@
+/**
+ * @file esp_attr.h
+ * @brief Host shim for the ESP-IDF memory placement attributes
+ */
+
+#pragma once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define NOINLINE_ATTR __attribute__((noinline))
+#define FORCE_INLINE_ATTR static inline __attribute__((always_inline))
@@ -0,0 +1,26 @@
+/**
+ * @file esp_cpu.h
+ * @brief Host shim for the ESP-IDF CPU utilities
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+/**
+ * @brief Host cycle counter
+ *
+ * Counts nanoseconds of the host monotonic clock, so cycle figures
+ * logged by the firmware read as nanoseconds on the host.
+ */
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void);
+
+#ifdef __cplusplus
+}
+#endif
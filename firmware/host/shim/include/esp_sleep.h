@@ -0,0 +1,21 @@
+/**
+ * @file esp_sleep.h
+ * @brief Host shim for ESP-IDF sleep wakeup sources
+ *
+ * The host never sleeps; wakeup sources are accepted and ignored.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t esp_sleep_enable_gpio_wakeup(void);
+esp_err_t esp_sleep_enable_uart_wakeup(int uart_num);
+
+#ifdef __cplusplus
+}
+#endif
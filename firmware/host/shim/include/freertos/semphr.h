@@ -0,0 +1,31 @@
+/**
+ * @file semphr.h
+ * @brief Host shim for the FreeRTOS semaphore API
+ *
+ * Semaphores are queues with zero-sized items, as in FreeRTOS itself.
+ */
+
+#pragma once
+
+#include "freertos/queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount);
+
+#define vSemaphoreDelete(xSemaphore)                                vQueueDelete(xSemaphore)
+#define xSemaphoreTake(xSemaphore, xBlockTime)                      xQueueReceive((xSemaphore), NULL, (xBlockTime))
+#define xSemaphoreTakeFromISR(xSemaphore, pxHigherPriorityTaskWoken) xQueueReceiveFromISR((xSemaphore), NULL, (pxHigherPriorityTaskWoken))
+#define xSemaphoreGive(xSemaphore)                                  xQueueSend((xSemaphore), NULL, 0)
+#define xSemaphoreGiveFromISR(xSemaphore, pxHigherPriorityTaskWoken) xQueueSendFromISR((xSemaphore), NULL, (pxHigherPriorityTaskWoken))
+#define uxSemaphoreGetCount(xSemaphore)                             uxQueueMessagesWaiting(xSemaphore)
+
+#ifdef __cplusplus
+}
+#endif
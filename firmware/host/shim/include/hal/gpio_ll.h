@@ -0,0 +1,38 @@
+/**
+ * @file gpio_ll.h
+ * @brief Host shim for the GPIO low-level (register) layer
+ *
+ * Only what the firmware calls from ISRs. On the device these are inline
+ * register writes; here they act on the same pin state as driver/gpio.h.
+ */
+
+#pragma once
+
+#include "driver/gpio.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    GPIO_PORT_0 = 0,
+    GPIO_PORT_MAX,
+} gpio_port_t;
+
+// The register block; never dereferenced on the host
+typedef struct gpio_dev_s gpio_dev_t;
+
+#define GPIO_LL_GET_HW(num) ((gpio_dev_t *)NULL)
+
+void shim_gpio_ll_set_intr_type(uint32_t gpio_num, gpio_int_type_t intr_type);
+
+static inline void gpio_ll_set_intr_type(gpio_dev_t *hw, uint32_t gpio_num, gpio_int_type_t intr_type)
+{
+    (void)hw;
+    shim_gpio_ll_set_intr_type(gpio_num, intr_type);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,19 @@
+/**
+ * @file nvs_flash.h
+ * @brief Host shim for NVS flash initialisation
+ */
+
+#pragma once
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,22 @@
+/**
+ * @file sdkconfig.h
+ * @brief Host stand-in for the generated ESP-IDF configuration header
+ *
+ * Mirrors the defaults of the project configuration. FocusBar options
+ * from Kconfig.projbuild can be overridden from the host CMake project.
+ */
+
+#pragma once
+
+#define CONFIG_IDF_TARGET "esp32h2"
+#define CONFIG_IDF_TARGET_ESP32H2 1
+#define CONFIG_FREERTOS_HZ 100
+#define CONFIG_LOG_DEFAULT_LEVEL 3
+
+#ifndef CONFIG_FOCUSBAR_RUN_BENCHMARKS
+#define CONFIG_FOCUSBAR_RUN_BENCHMARKS 0
+#endif
+
+#ifndef CONFIG_FOCUSBAR_BUTTON_GLITCH_FILTER
+#define CONFIG_FOCUSBAR_BUTTON_GLITCH_FILTER 1
+#endif
@@ -0,0 +1,240 @@
+/**
+ * @file shim.h
+ * @brief Host-side control of the ESP-IDF/FreeRTOS shims
+ *
+ * The shims run every FreeRTOS task as a coroutine on one host thread.
+ * A task keeps the CPU until it blocks; interrupt handlers (GPIO edges,
+ * RMT completion, host file descriptors) run between tasks. With the
+ * virtual clock, time only advances when every task is blocked and then
+ * jumps straight to the next deadline, so runs are deterministic and as
+ * fast as the host allows.
+ *
+ * Peripheral outputs are recorded: observers are called for every RMT
+ * transmission and LEDC output change, and the same events are written
+ * to the trace file when one is open.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHIM_NO_DEADLINE INT64_MAX
+
+struct tskTaskControlBlock;
+
+typedef enum {
+    SHIM_CLOCK_REAL,     // Host monotonic clock, idle time is slept
+    SHIM_CLOCK_VIRTUAL,  // Simulated clock, idle time is skipped
+} shim_clock_mode_t;
+
+typedef void (*shim_callback_t)(void *arg);
+typedef void (*shim_fd_handler_t)(int fd, void *arg);
+
+/**
+ * @brief Reset the shim clock to zero and select how it advances
+ *
+ * Must be called before any task is created.
+ */
+void shim_init(shim_clock_mode_t mode);
+
+/**
+ * @brief Run tasks until shim_stop() is called or nothing can ever run again
+ */
+void shim_run(void);
+
+/**
+ * @brief Ask shim_run() to return once the running task blocks
+ */
+void shim_stop(void);
+
+/**
+ * @brief Exclude a task from wakeup counting (NULL: the calling task)
+ *
+ * For host-side tasks such as simulator scripts and consoles, which have
+ * no counterpart on the device.
+ */
+void shim_mark_host_task(struct tskTaskControlBlock *task);
+
+/**
+ * @brief Times a firmware task ran after every task had been blocked
+ *
+ * On the device each of these is a wakeup from idle (light sleep when no
+ * power management lock is held).
+ */
+uint32_t shim_wakeup_count(void);
+
+/**
+ * @brief Print the wakeups of each live firmware task, i.e. the task that ran first
+ */
+void shim_wakeup_report(FILE *out);
+
+/**
+ * @brief Microseconds since shim_init()
+ */
+int64_t shim_now_us(void);
+
+/**
+ * @brief Run a callback in interrupt context once the clock reaches @p when_us
+ *
+ * @return false if the callback table is full
+ */
+bool shim_post_callback(int64_t when_us, shim_callback_t callback, void *arg);
+
+/**
+ * @brief Cancel all pending callbacks matching @p callback and @p arg
+ */
+void shim_cancel_callback(shim_callback_t callback, void *arg);
+
+/**
+ * @brief Call @p handler in interrupt context whenever @p fd becomes readable
+ */
+bool shim_watch_fd(int fd, shim_fd_handler_t handler, void *arg);
+
+/**
+ * @brief Stop watching @p fd
+ */
+void shim_unwatch_fd(int fd);
+
+/**
+ * @brief Block the calling task on @p object until shim_wake() or @p deadline_us
+ *
+ * Building block for the driver shims. Returns immediately with false
+ * outside task context or when the deadline has already passed.
+ *
+ * @return true if woken, false on timeout
+ */
+bool shim_block(const void *object, int64_t deadline_us);
+
+/**
+ * @brief Make every task blocked on @p object ready to run
+ */
+void shim_wake(const void *object);
+
+/**
+ * @brief Absolute deadline for a FreeRTOS tick timeout, SHIM_NO_DEADLINE for portMAX_DELAY
+ */
+int64_t shim_ticks_to_deadline(uint32_t ticks);
+
+/**
+ * @brief Bracket code that the firmware expects to run as an interrupt handler
+ */
+void shim_isr_enter(void);
+void shim_isr_exit(void);
+
+/**
+ * @brief Drive an input pin, running its ISR handler on a matching edge
+ */
+void shim_gpio_drive(int gpio_num, int level);
+
+typedef void (*shim_rmt_observer_t)(int gpio_num, const uint8_t *data, size_t length, void *arg);
+typedef void (*shim_ledc_observer_t)(int gpio_num, uint32_t freq_hz, uint32_t duty, uint32_t duty_resolution_bits, void *arg);
+
+/**
+ * @brief Observe every RMT transmission as it starts on the wire
+ */
+void shim_rmt_set_observer(shim_rmt_observer_t observer, void *arg);
+
+/**
+ * @brief Observe every change of an LEDC output (frequency or duty)
+ */
+void shim_ledc_set_observer(shim_ledc_observer_t observer, void *arg);
+
+/**
+ * @brief Connect a UART port to host file descriptors
+ *
+ * @param fd_in  Readable descriptor feeding the RX buffer, or -1
+ * @param fd_out Descriptor receiving uart_write_bytes() data, or -1 to discard
+ */
+void shim_uart_attach(int uart_num, int fd_in, int fd_out);
+
+/**
+ * @brief Deliver bytes to a UART's RX buffer as if they arrived on the wire
+ *
+ * @return Bytes accepted (fewer than @p length if the buffer is full)
+ */
+size_t shim_uart_receive(int uart_num, const void *data, size_t length);
+
+/**
+ * @brief Lose the input that wakes the chip from light sleep, as the device does
+ *
+ * Once enabled, while the firmware allows light sleep (shim_pm_asleep())
+ * and has enabled UART wakeup, received bytes are dropped until their
+ * rising edges reach the uart_set_wakeup_threshold() value. The chip then
+ * counts as awake for the 30 ms FreeRTOS idles before sleeping again.
+ */
+void shim_uart_emulate_sleep(int uart_num, bool enabled);
+
+/**
+ * @brief Keep NVS contents in @p path, loading it now and saving on every commit
+ *
+ * Without a file, NVS starts empty and lives in memory only.
+ */
+void shim_nvs_attach(const char *path);
+
+/**
+ * @brief Print how many NVS blob writes and commits the firmware made
+ */
+void shim_nvs_report(FILE *out);
+
+/**
+ * @brief Set the RTC time at boot, which gettimeofday() counts on from
+ *
+ * On the device the RTC timer keeps running through every reset except a
+ * power-on reset. Defaults to 0.
+ */
+void shim_set_rtc_us(int64_t rtc_us);
+
+/**
+ * @brief Set what esp_reset_reason() reports (an esp_reset_reason_t)
+ *
+ * Defaults to ESP_RST_POWERON.
+ */
+void shim_set_reset_reason(int reason);
+
+/**
+ * @brief Print how often each esp_pm lock was taken and how long it was held
+ *
+ * The last line is the total time no lock was held, i.e. the time the
+ * firmware would have let the chip enter light sleep.
+ */
+void shim_pm_report(FILE *out);
+
+/**
+ * @brief Total time no esp_pm lock was held, i.e. light sleep was allowed
+ */
+int64_t shim_pm_unlocked_us(void);
+
+/**
+ * @brief Check if the chip would be in light sleep now
+ *
+ * @return true if automatic light sleep is configured and no lock is held
+ */
+bool shim_pm_asleep(void);
+
+/**
+ * @brief Write peripheral events to @p path, one timestamped line each
+ *
+ * Lines read "<time_us> <event> <fields>", e.g.
+ * "1200000 rmt gpio=25 len=18 data=00ff00..." or
+ * "1200000 ledc gpio=22 freq=1047 duty=128/256".
+ *
+ * @return true if the file was opened
+ */
+bool shim_trace_open(const char *path);
+void shim_trace_close(void);
+
+/**
+ * @brief Append one line to the trace file, if open
+ */
+void shim_trace_event(const char *event, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+#ifdef __cplusplus
+}
+#endif
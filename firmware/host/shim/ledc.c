@@ -0,0 +1,257 @@
+/**
+ * @file ledc.c
+ * @brief LEDC shim: records every change of the PWM outputs
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#include "shim.h"
+#include "driver/ledc.h"
+#include <stdbool.h>
+
+typedef struct {
+    bool configured;
+    uint32_t freq_hz;
+    ledc_timer_bit_t duty_resolution;
+} shim_ledc_timer_t;
+
+typedef struct {
+    bool configured;
+    int gpio_num;
+    ledc_timer_t timer;
+    uint32_t duty;              // Value on the output
+    uint32_t pending_duty;      // Set by ledc_set_duty(), applied by ledc_update_duty()
+    // Hardware fade: set by ledc_set_fade_with_time(), run by ledc_fade_start()
+    uint32_t fade_target;
+    int fade_time_ms;
+    bool fading;
+    uint32_t fade_from;
+    int64_t fade_start_us;
+    int64_t fade_end_us;
+    ledc_cb_t fade_cb;
+    void *fade_cb_arg;
+} shim_ledc_channel_t;
+
+static shim_ledc_timer_t ledc_timers[LEDC_TIMER_MAX];
+static shim_ledc_channel_t ledc_channels[LEDC_CHANNEL_MAX];
+static bool fade_installed = false;
+static shim_ledc_observer_t ledc_observer = NULL;
+static void *ledc_observer_arg = NULL;
+
+void shim_ledc_set_observer(shim_ledc_observer_t observer, void *arg)
+{
+    ledc_observer = observer;
+    ledc_observer_arg = arg;
+}
+
+/**
+ * @brief Report the current output of a channel
+ */
+static void record_output(const shim_ledc_channel_t *channel)
+{
+    const shim_ledc_timer_t *timer = &ledc_timers[channel->timer];
+    if (ledc_observer != NULL) {
+        ledc_observer(channel->gpio_num, timer->freq_hz, channel->duty, timer->duty_resolution, ledc_observer_arg);
+    }
+    shim_trace_event("ledc", "gpio=%d freq=%u duty=%u/%u", channel->gpio_num, (unsigned)timer->freq_hz,
+                     (unsigned)channel->duty, 1u << timer->duty_resolution);
+}
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *timer_conf)
+{
+    if (timer_conf == NULL || timer_conf->timer_num >= LEDC_TIMER_MAX ||
+        timer_conf->duty_resolution >= LEDC_TIMER_BIT_MAX || timer_conf->freq_hz == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ledc_timers[timer_conf->timer_num] = (shim_ledc_timer_t) {
+        .configured = true,
+        .freq_hz = timer_conf->freq_hz,
+        .duty_resolution = timer_conf->duty_resolution,
+    };
+    return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *ledc_conf)
+{
+    if (ledc_conf == NULL || ledc_conf->channel >= LEDC_CHANNEL_MAX || ledc_conf->timer_sel >= LEDC_TIMER_MAX ||
+        !ledc_timers[ledc_conf->timer_sel].configured) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    shim_ledc_channel_t *channel = &ledc_channels[ledc_conf->channel];
+    *channel = (shim_ledc_channel_t) {
+        .configured = true,
+        .gpio_num = ledc_conf->gpio_num,
+        .timer = ledc_conf->timer_sel,
+        .duty = ledc_conf->duty,
+        .pending_duty = ledc_conf->duty,
+    };
+    record_output(channel);
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_freq(ledc_mode_t speed_mode, ledc_timer_t timer_num, uint32_t freq_hz)
+{
+    if (speed_mode >= LEDC_SPEED_MODE_MAX || timer_num >= LEDC_TIMER_MAX || freq_hz == 0 ||
+        !ledc_timers[timer_num].configured) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ledc_timers[timer_num].freq_hz = freq_hz;
+    for (int i = 0; i < LEDC_CHANNEL_MAX; i++) {
+        if (ledc_channels[i].configured && ledc_channels[i].timer == timer_num && ledc_channels[i].duty != 0) {
+            record_output(&ledc_channels[i]);
+        }
+    }
+    return ESP_OK;
+}
+
+uint32_t ledc_get_freq(ledc_mode_t speed_mode, ledc_timer_t timer_num)
+{
+    if (speed_mode >= LEDC_SPEED_MODE_MAX || timer_num >= LEDC_TIMER_MAX) {
+        return 0;
+    }
+    return ledc_timers[timer_num].freq_hz;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty)
+{
+    if (speed_mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX || !ledc_channels[channel].configured) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ledc_channels[channel].pending_duty = duty;
+    return ESP_OK;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+    if (speed_mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX) {
+        return 0;
+    }
+    return ledc_channels[channel].duty;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+    if (speed_mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX || !ledc_channels[channel].configured) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    shim_ledc_channel_t *ch = &ledc_channels[channel];
+    if (ch->duty != ch->pending_duty) {
+        ch->duty = ch->pending_duty;
+        record_output(ch);
+    }
+    return ESP_OK;
+}
+
+esp_err_t ledc_stop(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t idle_level)
+{
+    (void)idle_level;
+    if (speed_mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX || !ledc_channels[channel].configured) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ledc_channels[channel].pending_duty = 0;
+    return ledc_update_duty(speed_mode, channel);
+}
+
+esp_err_t ledc_fade_func_install(int intr_alloc_flags)
+{
+    (void)intr_alloc_flags;
+    if (fade_installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    fade_installed = true;
+    return ESP_OK;
+}
+
+esp_err_t ledc_cb_register(ledc_mode_t speed_mode, ledc_channel_t channel, ledc_cbs_t *cbs, void *user_arg)
+{
+    if (speed_mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX || cbs == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!fade_installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    ledc_channels[channel].fade_cb = cbs->fade_cb;
+    ledc_channels[channel].fade_cb_arg = user_arg;
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_fade_with_time(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t target_duty, int max_fade_time_ms)
+{
+    if (speed_mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX || !ledc_channels[channel].configured ||
+        max_fade_time_ms < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!fade_installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    ledc_channels[channel].fade_target = target_duty;
+    ledc_channels[channel].fade_time_ms = max_fade_time_ms;
+    return ESP_OK;
+}
+
+/**
+ * @brief Fade end interrupt: the channel has reached its target duty
+ */
+static void fade_end(void *arg)
+{
+    ledc_channel_t channel = (ledc_channel_t)(intptr_t)arg;
+    shim_ledc_channel_t *ch = &ledc_channels[channel];
+    ch->fading = false;
+    ch->duty = ch->fade_target;
+    ch->pending_duty = ch->duty;
+    record_output(ch);
+    if (ch->fade_cb != NULL) {
+        ledc_cb_param_t param = {
+            .event = LEDC_FADE_END_EVT,
+            .speed_mode = LEDC_LOW_SPEED_MODE,
+            .channel = channel,
+            .duty = ch->duty,
+        };
+        ch->fade_cb(&param, ch->fade_cb_arg);
+    }
+}
+
+esp_err_t ledc_fade_start(ledc_mode_t speed_mode, ledc_channel_t channel, ledc_fade_mode_t fade_mode)
+{
+    if (speed_mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX || !ledc_channels[channel].configured) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (fade_mode != LEDC_FADE_NO_WAIT) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (!fade_installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    shim_ledc_channel_t *ch = &ledc_channels[channel];
+    shim_cancel_callback(fade_end, (void *)(intptr_t)channel);
+    ch->fading = true;
+    ch->fade_from = ch->duty;
+    ch->fade_start_us = shim_now_us();
+    ch->fade_end_us = ch->fade_start_us + ch->fade_time_ms * 1000LL;
+    shim_trace_event("ledc_fade", "gpio=%d duty=%u->%u/%u in %d ms", ch->gpio_num, (unsigned)ch->fade_from,
+                     (unsigned)ch->fade_target, 1u << ledc_timers[ch->timer].duty_resolution, ch->fade_time_ms);
+    shim_post_callback(ch->fade_end_us, fade_end, (void *)(intptr_t)channel);
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_stop(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+    if (speed_mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX || !ledc_channels[channel].configured) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    shim_ledc_channel_t *ch = &ledc_channels[channel];
+    if (!ch->fading) {
+        return ESP_OK;
+    }
+    // The duty stays where the fade had got to, and no callback runs
+    shim_cancel_callback(fade_end, (void *)(intptr_t)channel);
+    ch->fading = false;
+    int64_t span_us = ch->fade_end_us - ch->fade_start_us;
+    int64_t done_us = shim_now_us() - ch->fade_start_us;
+    int64_t delta = (int64_t)ch->fade_target - (int64_t)ch->fade_from;
+    ch->pending_duty = span_us > 0 ? (uint32_t)(ch->fade_from + delta * done_us / span_us) : ch->fade_target;
+    ch->duty = ch->pending_duty;
+    record_output(ch);
+    return ESP_OK;
+}
@@ -0,0 +1,260 @@
+/**
+ * @file nvs.c
+ * @brief NVS shim: in-memory blob store, optionally saved to a file
+ *
+ * The backing file holds one "<namespace> <key> <hex value>" line per
+ * entry and is rewritten on every commit, which is enough to carry NVS
+ * contents from one simulated boot to the next.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#include "shim.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "esp_log.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+static const char *TAG = "shim_nvs";
+
+#define SHIM_NVS_NAME_MAX   16      // Including the terminator, as NVS_KEY_NAME_MAX_SIZE
+#define SHIM_NVS_BLOB_MAX   256
+#define SHIM_NVS_ENTRIES    32
+#define SHIM_NVS_HANDLES    8
+
+typedef struct {
+    bool used;
+    char namespace_name[SHIM_NVS_NAME_MAX];
+    char key[SHIM_NVS_NAME_MAX];
+    size_t length;
+    uint8_t value[SHIM_NVS_BLOB_MAX];
+} shim_nvs_entry_t;
+
+typedef struct {
+    bool used;
+    char namespace_name[SHIM_NVS_NAME_MAX];
+    bool writable;
+} shim_nvs_handle_t;
+
+static shim_nvs_entry_t entries[SHIM_NVS_ENTRIES];
+static shim_nvs_handle_t handles[SHIM_NVS_HANDLES];
+static const char *backing_path = NULL;
+static uint32_t blob_writes = 0;
+static uint64_t bytes_written = 0;
+static uint32_t commits = 0;
+
+/**
+ * @brief Rewrite the backing file with every entry
+ */
+static void save_entries(void)
+{
+    if (backing_path == NULL) {
+        return;
+    }
+    FILE *file = fopen(backing_path, "w");
+    if (file == NULL) {
+        ESP_LOGE(TAG, "Cannot write %s", backing_path);
+        return;
+    }
+    for (int i = 0; i < SHIM_NVS_ENTRIES; i++) {
+        if (!entries[i].used) {
+            continue;
+        }
+        fprintf(file, "%s %s ", entries[i].namespace_name, entries[i].key);
+        for (size_t j = 0; j < entries[i].length; j++) {
+            fprintf(file, "%02x", entries[i].value[j]);
+        }
+        fputc('\n', file);
+    }
+    fclose(file);
+}
+
+/**
+ * @brief Load entries from the backing file, if it exists
+ */
+static void load_entries(void)
+{
+    FILE *file = fopen(backing_path, "r");
+    if (file == NULL) {
+        return;
+    }
+    char namespace_name[SHIM_NVS_NAME_MAX];
+    char key[SHIM_NVS_NAME_MAX];
+    char hex[SHIM_NVS_BLOB_MAX * 2 + 1];
+    int slot = 0;
+    while (slot < SHIM_NVS_ENTRIES && fscanf(file, "%15s %15s %512s", namespace_name, key, hex) == 3) {
+        shim_nvs_entry_t *entry = &entries[slot++];
+        entry->used = true;
+        strcpy(entry->namespace_name, namespace_name);
+        strcpy(entry->key, key);
+        entry->length = strlen(hex) / 2;
+        for (size_t j = 0; j < entry->length; j++) {
+            unsigned byte;
+            sscanf(&hex[j * 2], "%2x", &byte);
+            entry->value[j] = (uint8_t)byte;
+        }
+    }
+    fclose(file);
+}
+
+void shim_nvs_attach(const char *path)
+{
+    memset(entries, 0, sizeof(entries));
+    backing_path = path;
+    if (path != NULL) {
+        load_entries();
+    }
+}
+
+void shim_nvs_report(FILE *out)
+{
+    fprintf(out, "NVS: %" PRIu32 " blob writes (%" PRIu64 " bytes), %" PRIu32 " commits\n",
+            blob_writes, bytes_written, commits);
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    memset(entries, 0, sizeof(entries));
+    save_entries();
+    return ESP_OK;
+}
+
+static shim_nvs_handle_t *get_handle(nvs_handle_t handle)
+{
+    if (handle == 0 || handle > SHIM_NVS_HANDLES || !handles[handle - 1].used) {
+        return NULL;
+    }
+    return &handles[handle - 1];
+}
+
+static shim_nvs_entry_t *find_entry(const shim_nvs_handle_t *open, const char *key)
+{
+    for (int i = 0; i < SHIM_NVS_ENTRIES; i++) {
+        if (entries[i].used && strcmp(entries[i].namespace_name, open->namespace_name) == 0 &&
+            strcmp(entries[i].key, key) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (namespace_name == NULL || out_handle == NULL || strlen(namespace_name) >= SHIM_NVS_NAME_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < SHIM_NVS_HANDLES; i++) {
+        if (!handles[i].used) {
+            handles[i].used = true;
+            handles[i].writable = open_mode == NVS_READWRITE;
+            strcpy(handles[i].namespace_name, namespace_name);
+            *out_handle = (nvs_handle_t)(i + 1);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    shim_nvs_handle_t *open = get_handle(handle);
+    if (open != NULL) {
+        open->used = false;
+    }
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    shim_nvs_handle_t *open = get_handle(handle);
+    if (open == NULL) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (key == NULL || length == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    shim_nvs_entry_t *entry = find_entry(open, key);
+    if (entry == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out_value == NULL) {
+        *length = entry->length;
+        return ESP_OK;
+    }
+    if (*length < entry->length) {
+        *length = entry->length;
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out_value, entry->value, entry->length);
+    *length = entry->length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    shim_nvs_handle_t *open = get_handle(handle);
+    if (open == NULL) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (!open->writable) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    if (key == NULL || value == NULL || strlen(key) >= SHIM_NVS_NAME_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (length > SHIM_NVS_BLOB_MAX) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+
+    shim_nvs_entry_t *entry = find_entry(open, key);
+    for (int i = 0; entry == NULL && i < SHIM_NVS_ENTRIES; i++) {
+        if (!entries[i].used) {
+            entry = &entries[i];
+            entry->used = true;
+            strcpy(entry->namespace_name, open->namespace_name);
+            strcpy(entry->key, key);
+        }
+    }
+    if (entry == NULL) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    memcpy(entry->value, value, length);
+    entry->length = length;
+    blob_writes++;
+    bytes_written += length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    shim_nvs_handle_t *open = get_handle(handle);
+    if (open == NULL) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (!open->writable) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    shim_nvs_entry_t *entry = find_entry(open, key);
+    if (entry == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    entry->used = false;
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    if (get_handle(handle) == NULL) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    commits++;
+    save_entries();
+    return ESP_OK;
+}
@@ -0,0 +1,249 @@
+/**
+ * @file rmt.c
+ * @brief RMT TX shim: records payloads and models wire time
+ *
+ * A transmission starts when the channel goes idle (queued behind the
+ * previous one like the driver's transaction queue) and its done
+ * callback runs once the bytes encoder would have clocked out every bit.
+ * Like the driver, an enabled channel holds a power management lock.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#include "shim.h"
+#include "driver/rmt_tx.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "shim_rmt";
+
+#define RMT_TRACE_MAX_BYTES 64
+
+struct rmt_channel_t {
+    int gpio_num;
+    uint32_t resolution_hz;
+    size_t queue_depth;
+    bool enabled;
+    esp_pm_lock_handle_t pm_lock;   // Held while enabled, as in the driver
+    rmt_tx_event_callbacks_t callbacks;
+    void *user_data;
+    size_t in_flight;               // Transactions queued or on the wire
+    int64_t busy_until_us;          // When the last queued transaction leaves the wire
+};
+
+typedef struct {
+    rmt_encoder_t base;
+    rmt_bytes_encoder_config_t config;
+} shim_bytes_encoder_t;
+
+static shim_rmt_observer_t rmt_observer = NULL;
+static void *rmt_observer_arg = NULL;
+
+void shim_rmt_set_observer(shim_rmt_observer_t observer, void *arg)
+{
+    rmt_observer = observer;
+    rmt_observer_arg = arg;
+}
+
+static size_t bytes_encoder_encode(rmt_encoder_t *encoder, rmt_channel_handle_t tx_channel, const void *primary_data,
+                                   size_t data_size, rmt_encode_state_t *ret_state)
+{
+    (void)encoder;
+    (void)tx_channel;
+    (void)primary_data;
+    *ret_state = RMT_ENCODING_COMPLETE;
+    return data_size * 8;
+}
+
+static esp_err_t bytes_encoder_reset(rmt_encoder_t *encoder)
+{
+    (void)encoder;
+    return ESP_OK;
+}
+
+static esp_err_t bytes_encoder_del(rmt_encoder_t *encoder)
+{
+    free(encoder);
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t *config, rmt_channel_handle_t *ret_chan)
+{
+    if (config == NULL || ret_chan == NULL || config->resolution_hz == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    rmt_channel_handle_t channel = calloc(1, sizeof(*channel));
+    if (channel == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    channel->gpio_num = config->gpio_num;
+    channel->resolution_hz = config->resolution_hz;
+    channel->queue_depth = config->trans_queue_depth > 0 ? config->trans_queue_depth : 1;
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "rmt_tx", &channel->pm_lock);
+    *ret_chan = channel;
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_channel(rmt_channel_handle_t channel)
+{
+    if (channel == NULL || channel->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    free(channel);
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_bytes_encoder(const rmt_bytes_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    if (config == NULL || ret_encoder == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    shim_bytes_encoder_t *encoder = calloc(1, sizeof(*encoder));
+    if (encoder == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    encoder->base.encode = bytes_encoder_encode;
+    encoder->base.reset = bytes_encoder_reset;
+    encoder->base.del = bytes_encoder_del;
+    encoder->config = *config;
+    *ret_encoder = &encoder->base;
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_encoder(rmt_encoder_handle_t encoder)
+{
+    return encoder != NULL ? encoder->del(encoder) : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t rmt_enable(rmt_channel_handle_t channel)
+{
+    if (channel == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (channel->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_pm_lock_acquire(channel->pm_lock);
+    channel->enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_disable(rmt_channel_handle_t channel)
+{
+    if (channel == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!channel->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_pm_lock_release(channel->pm_lock);
+    channel->enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t rmt_tx_register_event_callbacks(rmt_channel_handle_t tx_channel, const rmt_tx_event_callbacks_t *cbs, void *user_data)
+{
+    if (tx_channel == NULL || cbs == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (tx_channel->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    tx_channel->callbacks = *cbs;
+    tx_channel->user_data = user_data;
+    return ESP_OK;
+}
+
+/**
+ * @brief Time the bytes encoder needs to clock out @p payload
+ */
+static int64_t wire_time_us(const struct rmt_channel_t *channel, rmt_encoder_handle_t encoder, const uint8_t *payload, size_t length)
+{
+    if (encoder->encode != bytes_encoder_encode) {
+        // Custom encoders: assume the WS2812 bit period of 1.25 us
+        return (int64_t)length * 8 * 5 / 4;
+    }
+    const rmt_bytes_encoder_config_t *config = &((const shim_bytes_encoder_t *)encoder)->config;
+    uint64_t ones = 0;
+    for (size_t i = 0; i < length; i++) {
+        ones += __builtin_popcount(payload[i]);
+    }
+    uint64_t zeros = (uint64_t)length * 8 - ones;
+    uint64_t ticks = ones * (config->bit1.duration0 + config->bit1.duration1) +
+                     zeros * (config->bit0.duration0 + config->bit0.duration1);
+    return (int64_t)((ticks * 1000000 + channel->resolution_hz - 1) / channel->resolution_hz);
+}
+
+/**
+ * @brief End of a transaction on the wire, runs in interrupt context
+ */
+static void transmit_done(void *arg)
+{
+    rmt_channel_handle_t channel = arg;
+    channel->in_flight--;
+    if (channel->callbacks.on_trans_done != NULL) {
+        rmt_tx_done_event_data_t edata = { .num_symbols = 0 };
+        channel->callbacks.on_trans_done(channel, &edata, channel->user_data);
+    }
+    shim_wake(channel);
+}
+
+esp_err_t rmt_transmit(rmt_channel_handle_t tx_channel, rmt_encoder_handle_t encoder, const void *payload,
+                       size_t payload_bytes, const rmt_transmit_config_t *config)
+{
+    if (tx_channel == NULL || encoder == NULL || payload == NULL || config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!tx_channel->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // The driver blocks on a full transaction queue unless asked not to
+    while (tx_channel->in_flight >= tx_channel->queue_depth) {
+        if (config->flags.queue_nonblocking || !shim_block(tx_channel, SHIM_NO_DEADLINE)) {
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+
+    const uint8_t *bytes = payload;
+    int64_t now = shim_now_us();
+    int64_t start = tx_channel->busy_until_us > now ? tx_channel->busy_until_us : now;
+    tx_channel->busy_until_us = start + wire_time_us(tx_channel, encoder, bytes, payload_bytes);
+    tx_channel->in_flight++;
+    if (!shim_post_callback(tx_channel->busy_until_us, transmit_done, tx_channel)) {
+        tx_channel->in_flight--;
+        return ESP_FAIL;
+    }
+
+    if (rmt_observer != NULL) {
+        rmt_observer(tx_channel->gpio_num, bytes, payload_bytes, rmt_observer_arg);
+    }
+    char hex[RMT_TRACE_MAX_BYTES * 2 + 1];
+    size_t shown = payload_bytes < RMT_TRACE_MAX_BYTES ? payload_bytes : RMT_TRACE_MAX_BYTES;
+    for (size_t i = 0; i < shown; i++) {
+        static const char digits[] = "0123456789abcdef";
+        hex[i * 2] = digits[bytes[i] >> 4];
+        hex[i * 2 + 1] = digits[bytes[i] & 0x0F];
+    }
+    hex[shown * 2] = '\0';
+    shim_trace_event("rmt", "gpio=%d len=%zu data=%s", tx_channel->gpio_num, payload_bytes, hex);
+    return ESP_OK;
+}
+
+esp_err_t rmt_tx_wait_all_done(rmt_channel_handle_t tx_channel, int timeout_ms)
+{
+    if (tx_channel == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int64_t deadline = timeout_ms < 0 ? SHIM_NO_DEADLINE : shim_now_us() + (int64_t)timeout_ms * 1000;
+    while (tx_channel->in_flight > 0) {
+        if (!shim_block(tx_channel, deadline)) {
+            ESP_LOGD(TAG, "Wait for transmission timed out");
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+    return ESP_OK;
+}
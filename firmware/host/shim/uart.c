@@ -0,0 +1,341 @@
+/**
+ * @file uart.c
+ * @brief UART shim backed by host file descriptors
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#include "shim.h"
+#include "driver/uart.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+static const char *TAG = "shim_uart";
+
+// After a wakeup, FreeRTOS idles this long before light sleep again
+// (CONFIG_FREERTOS_IDLE_TIME_BEFORE_SLEEP, 3 ticks at 100 Hz)
+#define SHIM_UART_WAKE_US 30000
+
+typedef struct {
+    bool installed;
+    uint8_t *rx_buffer;         // Ring buffer filled from fd_in
+    size_t rx_size;
+    size_t rx_head;
+    size_t rx_count;
+    QueueHandle_t event_queue;
+    int baud_rate;
+    int fd_in;
+    int fd_out;
+    int wakeup_threshold;       // RX rising edges that wake the chip
+    bool wakeup_enabled;
+    bool emulate_sleep;         // Drop the bytes that wake the chip
+    int wakeup_edges;           // Edges seen towards the next wakeup
+    int64_t awake_until_us;     // End of the idle time after a wakeup
+} shim_uart_t;
+
+static shim_uart_t uarts[UART_NUM_MAX] = {
+    { .fd_in = -1, .fd_out = -1 },
+    { .fd_in = -1, .fd_out = -1 },
+};
+
+static bool uart_valid(uart_port_t uart_num)
+{
+    return uart_num >= 0 && uart_num < UART_NUM_MAX;
+}
+
+/**
+ * @brief Queue a driver event if the application asked for an event queue
+ */
+static void post_event(shim_uart_t *uart, uart_event_type_t type, size_t size)
+{
+    if (uart->event_queue != NULL) {
+        uart_event_t event = { .type = type, .size = size, .timeout_flag = false };
+        xQueueSendFromISR(uart->event_queue, &event, NULL);
+    }
+}
+
+/**
+ * @brief Rising edges on the RX line for one 8N1 character
+ */
+static int rising_edges(uint8_t byte)
+{
+    int edges = 0;
+    int previous = 0;       // Start bit
+    for (int bit = 0; bit < 8; bit++) {
+        int level = (byte >> bit) & 1;
+        edges += level && !previous;
+        previous = level;
+    }
+    return edges + !previous;   // Stop bit
+}
+
+/**
+ * @brief Consume the bytes that wake a sleeping chip
+ *
+ * @return Number of leading bytes lost
+ */
+static size_t wakeup_loss(shim_uart_t *uart, const uint8_t *data, size_t length)
+{
+    if (!uart->emulate_sleep || !uart->wakeup_enabled || !shim_pm_asleep()
+        || shim_now_us() < uart->awake_until_us) {
+        uart->wakeup_edges = 0;
+        return 0;
+    }
+    size_t lost = 0;
+    while (lost < length && uart->wakeup_edges < uart->wakeup_threshold) {
+        uart->wakeup_edges += rising_edges(data[lost++]);
+    }
+    if (uart->wakeup_edges >= uart->wakeup_threshold) {
+        uart->wakeup_edges = 0;
+        uart->awake_until_us = shim_now_us() + SHIM_UART_WAKE_US;
+    }
+    ESP_LOGD(TAG, "%zu bytes lost waking from light sleep", lost);
+    return lost;
+}
+
+/**
+ * @brief Append received bytes to the ring buffer and wake readers
+ */
+static void receive_bytes(shim_uart_t *uart, const uint8_t *data, size_t length)
+{
+    size_t lost = wakeup_loss(uart, data, length);
+    data += lost;
+    length -= lost;
+    if (length == 0) {
+        return;
+    }
+    for (size_t i = 0; i < length; i++) {
+        uart->rx_buffer[(uart->rx_head + uart->rx_count) % uart->rx_size] = data[i];
+        uart->rx_count++;
+    }
+    post_event(uart, UART_DATA, length);
+    shim_wake(uart);
+}
+
+/**
+ * @brief RX interrupt: move readable host bytes into the ring buffer
+ */
+static void uart_rx_ready(int fd, void *arg)
+{
+    shim_uart_t *uart = arg;
+    if (!uart->installed) {
+        return;
+    }
+
+    size_t space = uart->rx_size - uart->rx_count;
+    if (space == 0) {
+        post_event(uart, UART_BUFFER_FULL, 0);
+        return;
+    }
+
+    uint8_t chunk[256];
+    ssize_t got = read(fd, chunk, space < sizeof(chunk) ? space : sizeof(chunk));
+    if (got <= 0) {
+        if (got == 0 || (errno != EAGAIN && errno != EINTR)) {
+            shim_unwatch_fd(fd);
+        }
+        return;
+    }
+    receive_bytes(uart, chunk, (size_t)got);
+}
+
+size_t shim_uart_receive(int uart_num, const void *data, size_t length)
+{
+    if (!uart_valid(uart_num) || !uarts[uart_num].installed) {
+        return 0;
+    }
+    shim_uart_t *uart = &uarts[uart_num];
+    size_t space = uart->rx_size - uart->rx_count;
+    if (length > space) {
+        post_event(uart, UART_BUFFER_FULL, 0);
+        length = space;
+    }
+    receive_bytes(uart, data, length);
+    return length;
+}
+
+void shim_uart_attach(int uart_num, int fd_in, int fd_out)
+{
+    if (!uart_valid(uart_num)) {
+        return;
+    }
+    shim_uart_t *uart = &uarts[uart_num];
+    if (uart->fd_in >= 0) {
+        shim_unwatch_fd(uart->fd_in);
+    }
+    uart->fd_in = fd_in;
+    uart->fd_out = fd_out;
+    if (fd_in >= 0) {
+        shim_watch_fd(fd_in, uart_rx_ready, uart);
+    }
+}
+
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size, int queue_size,
+                              QueueHandle_t *uart_queue, int intr_alloc_flags)
+{
+    (void)tx_buffer_size;
+    (void)intr_alloc_flags;
+    if (!uart_valid(uart_num) || rx_buffer_size <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    shim_uart_t *uart = &uarts[uart_num];
+    if (uart->installed) {
+        ESP_LOGE(TAG, "UART driver already installed");
+        return ESP_FAIL;
+    }
+
+    uart->rx_buffer = malloc(rx_buffer_size);
+    if (uart->rx_buffer == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    uart->rx_size = rx_buffer_size;
+    uart->rx_head = 0;
+    uart->rx_count = 0;
+    uart->event_queue = NULL;
+    if (queue_size > 0 && uart_queue != NULL) {
+        uart->event_queue = xQueueCreate(queue_size, sizeof(uart_event_t));
+        if (uart->event_queue == NULL) {
+            free(uart->rx_buffer);
+            return ESP_ERR_NO_MEM;
+        }
+        *uart_queue = uart->event_queue;
+    }
+    uart->installed = true;
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_delete(uart_port_t uart_num)
+{
+    if (!uart_valid(uart_num) || !uarts[uart_num].installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    shim_uart_t *uart = &uarts[uart_num];
+    free(uart->rx_buffer);
+    uart->rx_buffer = NULL;
+    if (uart->event_queue != NULL) {
+        vQueueDelete(uart->event_queue);
+        uart->event_queue = NULL;
+    }
+    uart->installed = false;
+    return ESP_OK;
+}
+
+bool uart_is_driver_installed(uart_port_t uart_num)
+{
+    return uart_valid(uart_num) && uarts[uart_num].installed;
+}
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config)
+{
+    if (!uart_valid(uart_num) || uart_config == NULL || uart_config->baud_rate <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uarts[uart_num].baud_rate = uart_config->baud_rate;
+    return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num)
+{
+    (void)tx_io_num;
+    (void)rx_io_num;
+    (void)rts_io_num;
+    (void)cts_io_num;
+    return uart_valid(uart_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size)
+{
+    if (!uart_valid(uart_num) || !uarts[uart_num].installed || src == NULL) {
+        return -1;
+    }
+    int fd = uarts[uart_num].fd_out;
+    const uint8_t *bytes = src;
+    size_t written = 0;
+    while (fd >= 0 && written < size) {
+        ssize_t ret = write(fd, bytes + written, size - written);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        written += ret;
+    }
+    return (int)size;
+}
+
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+    if (!uart_valid(uart_num) || !uarts[uart_num].installed || buf == NULL) {
+        return -1;
+    }
+    shim_uart_t *uart = &uarts[uart_num];
+    uint8_t *out = buf;
+    uint32_t copied = 0;
+    int64_t deadline = shim_ticks_to_deadline(ticks_to_wait);
+
+    while (1) {
+        while (copied < length && uart->rx_count > 0) {
+            out[copied++] = uart->rx_buffer[uart->rx_head];
+            uart->rx_head = (uart->rx_head + 1) % uart->rx_size;
+            uart->rx_count--;
+        }
+        if (copied == length || !shim_block(uart, deadline)) {
+            return (int)copied;
+        }
+    }
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t *size)
+{
+    if (!uart_valid(uart_num) || !uarts[uart_num].installed || size == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *size = uarts[uart_num].rx_count;
+    return ESP_OK;
+}
+
+esp_err_t uart_flush_input(uart_port_t uart_num)
+{
+    if (!uart_valid(uart_num) || !uarts[uart_num].installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uarts[uart_num].rx_head = 0;
+    uarts[uart_num].rx_count = 0;
+    return ESP_OK;
+}
+
+esp_err_t uart_wait_tx_done(uart_port_t uart_num, TickType_t ticks_to_wait)
+{
+    (void)ticks_to_wait;
+    return uart_valid(uart_num) && uarts[uart_num].installed ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t uart_set_wakeup_threshold(uart_port_t uart_num, int wakeup_threshold)
+{
+    if (!uart_valid(uart_num) || wakeup_threshold <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uarts[uart_num].wakeup_threshold = wakeup_threshold;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_uart_wakeup(int uart_num)
+{
+    if (!uart_valid(uart_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uarts[uart_num].wakeup_enabled = true;
+    return ESP_OK;
+}
+
+void shim_uart_emulate_sleep(int uart_num, bool enabled)
+{
+    if (uart_valid(uart_num)) {
+        uarts[uart_num].emulate_sleep = enabled;
+    }
+}
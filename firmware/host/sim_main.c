@@ -0,0 +1,423 @@
+/**
+ * @file sim_main.c
+ * @brief Deterministic FocusBar simulator on a virtual clock
+ *
+ * Runs the unmodified firmware (app_main, the LED render task, the
+ * button task and the piezo) on the shim scheduler with the virtual
+ * clock: whenever every task is blocked, time jumps to the next
+ * deadline. A simulator task plays scripted button presses through the
+ * GPIO interrupt path and stops the run once the session is back to
+ * idle. Every WS2812 frame, piezo change, button edge and timer state
+ * change is written to the trace file with its simulated timestamp.
+ *
+ * After the run, wakeups from idle and the time power management locks
+ * were held give an estimate of the chip's energy over the run. The
+ * currents are assumptions (see SIM_ACTIVE_MA and friends), not
+ * measurements, and the LEDs and piezo themselves are not included.
+ *
+ * Usage: focusbar_sim [--trace FILE] [--press SEC:BUTTON[:MS]]... [--until SEC]
+ *                     [--active-ma MA] [--sleep-ua UA] [--wakeup-us US]
+ *                     [--nvs FILE] [--rtc SEC] [--reset-reason REASON]
+ *                     [--bounce COUNT:US]
+ *
+ * Without --press, button 4 is pressed at 1 s, which runs a full
+ * TIMER_DURATION_60MIN session through its grace period and alert.
+ *
+ * --nvs keeps NVS in a file, so a second run can boot from what the first
+ * one left behind. --rtc sets the RTC time at boot and --reset-reason the
+ * cause of the boot (poweron, sw, panic, int_wdt, task_wdt, wdt, deepsleep
+ * or brownout); together they simulate a reset in the middle of a session,
+ * e.g. a first run with --until 600 and a second one with --rtc 605
+ * --reset-reason brownout. Boots after anything but a power-on reset get
+ * no default press, as the firmware is expected to resume on its own.
+ *
+ * Presses may overlap: --press 1:0:300 --press 1.1:4 holds buttons 0
+ * and 4 together, a chord.
+ *
+ * --bounce makes every button edge bounce COUNT times, one change every
+ * US microseconds, before it settles.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#include "shim.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "button.h"
+#include "led.h"
+#include "timer.h"
+#include "latency.h"
+#include "esp_system.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SIM_MAX_PRESSES         32
+#define SIM_DEFAULT_PRESS_MS    100
+#define SIM_DEFAULT_BUTTON      4       // TIMER_DURATION_60MIN
+#define SIM_DEFAULT_PRESS_AT_US 1000000
+#define SIM_POLL_MS             10      // One tick: every state change is seen
+#define SIM_SETTLE_US           2000000 // Keep running after the session ends
+#define SIM_LIMIT_US            (24LL * 3600 * 1000000)
+
+// Energy model defaults: planning figures for the ESP32-H2, not measured
+#define SIM_SUPPLY_V            3.3
+#define SIM_ACTIVE_MA           12.0    // Awake: any PM lock held, or handling a wakeup
+#define SIM_SLEEP_UA            100.0   // Light sleep
+#define SIM_WAKEUP_US           1000.0  // Awake time per wakeup: sleep exit, work, sleep entry
+
+typedef struct {
+    int64_t at_us;
+    int button;
+    uint32_t hold_ms;
+} sim_press_t;
+
+// One button edge of the script; presses may overlap, e.g. for chords
+typedef struct {
+    int64_t at_us;
+    int button;
+    int level;
+} sim_edge_t;
+
+static const uint8_t button_gpios[NUM_BUTTONS] = {
+    BUTTON_SW0_GPIO, BUTTON_SW1_GPIO, BUTTON_SW2_GPIO, BUTTON_SW3_GPIO, BUTTON_SW4_GPIO
+};
+
+static sim_press_t presses[SIM_MAX_PRESSES];
+static int press_count = 0;
+static sim_edge_t edges[2 * SIM_MAX_PRESSES];
+static int edge_count = 0;
+static int64_t until_us = 0;            // 0: stop when the session is over
+static double active_ma = SIM_ACTIVE_MA;
+static double sleep_ua = SIM_SLEEP_UA;
+static double wakeup_us = SIM_WAKEUP_US;
+
+// Contact bounce after each button edge
+typedef struct {
+    int gpio;
+    int level;          // Level the edge settles at
+    int remaining;      // Level changes still to come
+} sim_bounce_t;
+
+static int bounce_count = 0;
+static int64_t bounce_interval_us = 0;
+static sim_bounce_t bounce;
+
+static uint32_t frames_sent = 0;
+static uint32_t notes_played = 0;
+static uint32_t state_changes = 0;
+static uint32_t last_duty = 0;
+
+void app_main(void);
+
+/**
+ * @brief Task wrapper matching how ESP-IDF starts app_main()
+ */
+static void main_task(void *pvParameters)
+{
+    app_main();
+    vTaskDelete(NULL);
+}
+
+static void count_frame(int gpio_num, const uint8_t *data, size_t length, void *arg)
+{
+    frames_sent++;
+}
+
+static void count_note(int gpio_num, uint32_t freq_hz, uint32_t duty, uint32_t duty_resolution_bits, void *arg)
+{
+    if (duty != 0 && last_duty == 0) {
+        notes_played++;
+    }
+    last_duty = duty;
+}
+
+/**
+ * @brief Next level change of a bouncing edge
+ */
+static void bounce_step(void *arg)
+{
+    sim_bounce_t *edge = arg;
+    edge->remaining--;
+    // Odd counts go back to the old level, the last change lands on the new one
+    shim_gpio_drive(edge->gpio, edge->remaining % 2 ? !edge->level : edge->level);
+    if (edge->remaining > 0) {
+        shim_post_callback(shim_now_us() + bounce_interval_us, bounce_step, edge);
+    }
+}
+
+/**
+ * @brief Drive a button pin, bouncing if --bounce asks for it
+ */
+static void drive_button(int button, int level)
+{
+    shim_trace_event("button", "%d %s", button, level ? "down" : "up");
+    shim_cancel_callback(bounce_step, &bounce);
+    shim_gpio_drive(button_gpios[button], level);
+    if (bounce_count > 0) {
+        bounce = (sim_bounce_t) {
+            .gpio = button_gpios[button],
+            .level = level,
+            .remaining = 2 * bounce_count,
+        };
+        shim_post_callback(shim_now_us() + bounce_interval_us, bounce_step, &bounce);
+    }
+}
+
+/**
+ * @brief Sleep until an absolute simulated time
+ */
+static void delay_until_us(int64_t at_us)
+{
+    int64_t now = shim_now_us();
+    if (at_us > now) {
+        vTaskDelay(pdMS_TO_TICKS((at_us - now + 999) / 1000));
+    }
+}
+
+/**
+ * @brief Follow the timer state, recording every change
+ *
+ * @return true once a session has started and returned to idle
+ */
+static bool track_state(timer_state_t *last_state, bool *session_started)
+{
+    timer_state_t state = timer_get_state();
+    if (state != *last_state) {
+        shim_trace_event("state", "%d -> %d", *last_state, state);
+        state_changes++;
+        *last_state = state;
+    }
+    if (state != TIMER_STATE_IDLE) {
+        *session_started = true;
+    }
+    return *session_started && state == TIMER_STATE_IDLE;
+}
+
+/**
+ * @brief Plays the scripted presses and ends the run
+ */
+static void sim_task(void *pvParameters)
+{
+    timer_state_t last_state = TIMER_STATE_IDLE;
+    bool session_started = false;
+    int64_t stop_at = until_us > 0 ? until_us : SIM_LIMIT_US;
+
+    // The simulator's own polling is not a device wakeup
+    shim_mark_host_task(NULL);
+
+    for (int i = 0; i < edge_count; i++) {
+        const sim_edge_t *edge = &edges[i];
+        while (shim_now_us() + SIM_POLL_MS * 1000 <= edge->at_us) {
+            vTaskDelay(pdMS_TO_TICKS(SIM_POLL_MS));
+            track_state(&last_state, &session_started);
+        }
+        delay_until_us(edge->at_us);
+        drive_button(edge->button, edge->level);
+    }
+
+    while (shim_now_us() < stop_at) {
+        vTaskDelay(pdMS_TO_TICKS(SIM_POLL_MS));
+        if (track_state(&last_state, &session_started) && until_us == 0 &&
+            stop_at == SIM_LIMIT_US) {
+            stop_at = shim_now_us() + SIM_SETTLE_US;
+        }
+    }
+
+    shim_stop();
+    vTaskDelete(NULL);
+}
+
+static int compare_edges(const void *a, const void *b)
+{
+    const sim_edge_t *ea = a;
+    const sim_edge_t *eb = b;
+    if (ea->at_us != eb->at_us) {
+        return (ea->at_us > eb->at_us) - (ea->at_us < eb->at_us);
+    }
+    return ea->level - eb->level;       // Releases first
+}
+
+static int usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [--trace FILE] [--press SEC:BUTTON[:MS]]... [--until SEC]\n"
+                    "       [--active-ma MA] [--sleep-ua UA] [--wakeup-us US]\n"
+                    "       [--nvs FILE] [--rtc SEC] [--reset-reason REASON]\n"
+                    "       [--bounce COUNT:US]\n", name);
+    return 2;
+}
+
+/**
+ * @brief Look up a --reset-reason name
+ *
+ * @return The esp_reset_reason_t, or -1 if the name is unknown
+ */
+static int parse_reset_reason(const char *name)
+{
+    static const struct {
+        const char *name;
+        esp_reset_reason_t reason;
+    } reasons[] = {
+        { "poweron", ESP_RST_POWERON },
+        { "sw", ESP_RST_SW },
+        { "panic", ESP_RST_PANIC },
+        { "int_wdt", ESP_RST_INT_WDT },
+        { "task_wdt", ESP_RST_TASK_WDT },
+        { "wdt", ESP_RST_WDT },
+        { "deepsleep", ESP_RST_DEEPSLEEP },
+        { "brownout", ESP_RST_BROWNOUT },
+    };
+    for (size_t i = 0; i < sizeof(reasons) / sizeof(reasons[0]); i++) {
+        if (strcmp(name, reasons[i].name) == 0) {
+            return reasons[i].reason;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Print wakeups and the estimated chip energy for the run
+ *
+ * The chip is counted awake while any PM lock is held plus a fixed time
+ * per wakeup, and in light sleep for the rest.
+ */
+static void report_energy(double sim_s)
+{
+    uint32_t wakeups = shim_wakeup_count();
+    double unlocked_s = shim_pm_unlocked_us() / 1e6;
+    double awake_s = sim_s - unlocked_s + wakeups * wakeup_us / 1e6;
+    if (awake_s > sim_s) {
+        awake_s = sim_s;
+    }
+    double asleep_s = sim_s - awake_s;
+    double energy_mj = SIM_SUPPLY_V * (active_ma * awake_s + sleep_ua / 1000.0 * asleep_s);
+
+    printf("Wakeups: %u (%.1f per minute)\n", wakeups, sim_s > 0.0 ? wakeups * 60.0 / sim_s : 0.0);
+    printf("Estimated chip energy: %.1f mJ, average %.3f mA (awake %.3f s, light sleep %.3f s; "
+           "assuming %.1f mA awake, %.0f uA asleep, %.0f us per wakeup)\n",
+           energy_mj, sim_s > 0.0 ? energy_mj / SIM_SUPPLY_V / sim_s : 0.0, awake_s, asleep_s,
+           active_ma, sleep_ua, wakeup_us);
+}
+
+int main(int argc, char **argv)
+{
+    const char *trace_path = "focusbar_sim.trace";
+    const char *nvs_path = NULL;
+    int64_t rtc_us = 0;
+    int reset_reason = ESP_RST_POWERON;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--press") == 0 && i + 1 < argc && press_count < SIM_MAX_PRESSES) {
+            double at_s;
+            int button;
+            unsigned hold_ms = SIM_DEFAULT_PRESS_MS;
+            if (sscanf(argv[++i], "%lf:%d:%u", &at_s, &button, &hold_ms) < 2 ||
+                at_s < 0.0 || button < 0 || button >= NUM_BUTTONS || hold_ms == 0) {
+                return usage(argv[0]);
+            }
+            presses[press_count++] = (sim_press_t) {
+                .at_us = (int64_t)(at_s * 1000000.0),
+                .button = button,
+                .hold_ms = hold_ms,
+            };
+        } else if (strcmp(argv[i], "--until") == 0 && i + 1 < argc) {
+            until_us = (int64_t)(atof(argv[++i]) * 1000000.0);
+        } else if (strcmp(argv[i], "--active-ma") == 0 && i + 1 < argc) {
+            active_ma = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--sleep-ua") == 0 && i + 1 < argc) {
+            sleep_ua = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--wakeup-us") == 0 && i + 1 < argc) {
+            wakeup_us = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--bounce") == 0 && i + 1 < argc) {
+            unsigned interval_us;
+            if (sscanf(argv[++i], "%d:%u", &bounce_count, &interval_us) != 2 ||
+                bounce_count < 0 || interval_us == 0) {
+                return usage(argv[0]);
+            }
+            bounce_interval_us = interval_us;
+        } else if (strcmp(argv[i], "--nvs") == 0 && i + 1 < argc) {
+            nvs_path = argv[++i];
+        } else if (strcmp(argv[i], "--rtc") == 0 && i + 1 < argc) {
+            rtc_us = (int64_t)(atof(argv[++i]) * 1000000.0);
+        } else if (strcmp(argv[i], "--reset-reason") == 0 && i + 1 < argc) {
+            reset_reason = parse_reset_reason(argv[++i]);
+            if (reset_reason < 0) {
+                return usage(argv[0]);
+            }
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (press_count == 0 && reset_reason == ESP_RST_POWERON) {
+        presses[press_count++] = (sim_press_t) {
+            .at_us = SIM_DEFAULT_PRESS_AT_US,
+            .button = SIM_DEFAULT_BUTTON,
+            .hold_ms = SIM_DEFAULT_PRESS_MS,
+        };
+    }
+    for (int i = 0; i < press_count; i++) {
+        edges[edge_count++] = (sim_edge_t) { presses[i].at_us, presses[i].button, 1 };
+        edges[edge_count++] = (sim_edge_t) {
+            presses[i].at_us + presses[i].hold_ms * 1000LL, presses[i].button, 0
+        };
+    }
+    qsort(edges, edge_count, sizeof(edges[0]), compare_edges);
+
+    shim_init(SHIM_CLOCK_VIRTUAL);
+    shim_nvs_attach(nvs_path);
+    shim_set_rtc_us(rtc_us);
+    shim_set_reset_reason(reset_reason);
+    if (!shim_trace_open(trace_path)) {
+        return 1;
+    }
+    shim_rmt_set_observer(count_frame, NULL);
+    shim_ledc_set_observer(count_note, NULL);
+
+    xTaskCreate(main_task, "main", 3584, NULL, 1, NULL);
+    xTaskCreate(sim_task, "sim", 4096, NULL, tskIDLE_PRIORITY, NULL);
+
+    struct timespec wall_start, wall_end;
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+    shim_run();
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    shim_trace_close();
+
+    double wall_s = (wall_end.tv_sec - wall_start.tv_sec) + (wall_end.tv_nsec - wall_start.tv_nsec) / 1e9;
+    double sim_s = shim_now_us() / 1e6;
+    printf("Simulated %.3f s in %.3f s wall (%.0fx)\n", sim_s, wall_s, wall_s > 0.0 ? sim_s / wall_s : 0.0);
+    printf("WS2812 frames: %u, piezo notes: %u, state changes: %u\n", frames_sent, notes_played, state_changes);
+    led_progress_stats_t progress;
+    led_get_progress_stats(&progress);
+    if (progress.frames > 0) {
+        printf("Progress error (displayed vs. true): %.3f%% avg, %.3f%% max over %" PRIu32 " frames\n",
+               100.0 * progress.total_error / progress.frames / 65536.0,
+               100.0 * progress.max_error / 65536.0, progress.frames);
+    }
+    button_stats_t buttons;
+    button_get_stats(&buttons);
+    printf("Button ISRs: %" PRIu32 " for %" PRIu32 " presses (%.1f per press), %" PRIu32 " bursts queued\n",
+           buttons.isr_calls, buttons.presses,
+           buttons.presses > 0 ? (double)buttons.isr_calls / buttons.presses : 0.0, buttons.bursts);
+    printf("Speculative taps retracted: %" PRIu32 "\n", buttons.retracted);
+    latency_stats_t latency;
+    latency_get_stats(&latency);
+    for (int stage = 0; stage < LATENCY_NUM_STAGES; stage++) {
+        const latency_histogram_t *histogram = &latency.stages[stage];
+        if (histogram->count > 0) {
+            printf("Input latency %-17s %" PRIu32 " samples, %" PRIu32 " us avg, %" PRIu32 "..%" PRIu32 " us\n",
+                   latency_stage_name(stage), histogram->count,
+                   (uint32_t)(histogram->total_us / histogram->count), histogram->min_us, histogram->max_us);
+        }
+    }
+    shim_nvs_report(stdout);
+    shim_pm_report(stdout);
+    shim_wakeup_report(stdout);
+    report_energy(sim_s);
+    printf("Trace written to %s\n", trace_path);
+    return 0;
+}
@@ -0,0 +1,130 @@
+/**
+ * @file led_stream_test.c
+ * @brief Host test: rejected LED stream frames leave the strip alone
+ *
+ * Runs led_stream.c against stand-ins for the LED task's direct frame
+ * API, which record what would have been transmitted. The shim clock
+ * does not advance here, so each case restarts the stream to get a free
+ * frame slot.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#include "led.h"
+#include "led_stream.h"
+#include "shim.h"
+#include <stdio.h>
+#include <string.h>
+
+static ws2812_pixel_t wire_buffer[NUM_LEDS];    // Handed out by led_begin_direct_frame()
+static ws2812_pixel_t transmitted[NUM_LEDS];    // Last frame led_end_direct_frame() sent
+static int frames_transmitted = 0;
+static int failures = 0;
+
+void led_pause(bool paused)
+{
+    (void)paused;
+}
+
+ws2812_pixel_t *led_begin_direct_frame(void)
+{
+    return wire_buffer;
+}
+
+void led_end_direct_frame(void)
+{
+    memcpy(transmitted, wire_buffer, sizeof(transmitted));
+    frames_transmitted++;
+}
+
+#define CHECK(condition, name) check((condition), (name), #condition)
+
+/**
+ * @brief Record a failed expectation
+ */
+static void check(bool ok, const char *name, const char *condition)
+{
+    if (!ok) {
+        fprintf(stderr, "FAIL %s: %s\n", name, condition);
+        failures++;
+    }
+}
+
+// Keyframe: all pixels red (G, R, B)
+static const uint8_t keyframe[] = { LED_STREAM_KEYFRAME, LED_STREAM_OP_FILL | 9, 0x00, 0xFF, 0x00 };
+
+// Delta on it: first two pixels blue
+static const uint8_t good_delta[] = { 0x00, LED_STREAM_OP_FILL | 1, 0x00, 0x00, 0xFF };
+
+// Deltas that paint the first two pixels blue and then go wrong
+static const struct {
+    const char *name;
+    uint8_t data[16];
+    size_t length;
+} bad_deltas[] = {
+    { "truncated literal", { 0x00, LED_STREAM_OP_FILL | 1, 0x00, 0x00, 0xFF,
+                             LED_STREAM_OP_LITERAL | 1, 0x10, 0x20, 0x30, 0x40 }, 10 },
+    { "truncated fill", { 0x00, LED_STREAM_OP_FILL | 1, 0x00, 0x00, 0xFF,
+                          LED_STREAM_OP_FILL | 0, 0x10 }, 7 },
+    { "fill past the strip", { 0x00, LED_STREAM_OP_FILL | 1, 0x00, 0x00, 0xFF,
+                               LED_STREAM_OP_SKIP | 7, LED_STREAM_OP_FILL | 1, 0x10, 0x20, 0x30 }, 10 },
+    { "skip past the strip", { 0x00, LED_STREAM_OP_FILL | 1, 0x00, 0x00, 0xFF,
+                               LED_STREAM_OP_SKIP | NUM_LEDS }, 6 },
+};
+
+/**
+ * @brief Check that the last transmitted frame is the keyframe
+ */
+static bool showing_keyframe(void)
+{
+    for (int i = 0; i < NUM_LEDS; i++) {
+        if (transmitted[i].g != 0x00 || transmitted[i].r != 0xFF || transmitted[i].b != 0x00) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(void)
+{
+    shim_init(SHIM_CLOCK_VIRTUAL);
+
+    for (size_t i = 0; i < sizeof(bad_deltas) / sizeof(bad_deltas[0]); i++) {
+        const char *name = bad_deltas[i].name;
+
+        // Rejected while the keyframe waits for its slot: the keyframe is shown
+        led_stream_start();
+        memset(transmitted, 0, sizeof(transmitted));
+        CHECK(led_stream_receive(0, keyframe, sizeof(keyframe)), name);
+        CHECK(!led_stream_receive(1, bad_deltas[i].data, bad_deltas[i].length), name);
+        led_stream_poll();
+        CHECK(showing_keyframe(), name);
+
+        // Rejected after the keyframe was shown: nothing is sent, and the
+        // next delta waits for a keyframe
+        led_stream_start();
+        CHECK(led_stream_receive(0, keyframe, sizeof(keyframe)), name);
+        led_stream_poll();
+        int sent = frames_transmitted;
+        CHECK(!led_stream_receive(1, bad_deltas[i].data, bad_deltas[i].length), name);
+        CHECK(!led_stream_receive(1, good_delta, sizeof(good_delta)), name);
+        led_stream_poll();
+        CHECK(frames_transmitted == sent && showing_keyframe(), name);
+
+        // A keyframe resynchronizes, and deltas apply on top of it again
+        led_stream_start();
+        CHECK(led_stream_receive(0, keyframe, sizeof(keyframe)), name);
+        CHECK(led_stream_receive(1, good_delta, sizeof(good_delta)), name);
+        led_stream_poll();
+        CHECK(transmitted[1].b == 0xFF && transmitted[2].r == 0xFF, name);
+    }
+    led_stream_stop();
+
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("led_stream_test: all checks passed\n");
+    return 0;
+}
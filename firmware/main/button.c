@@ -2,8 +2,9 @@
  * @file button.c
  * @brief Button control for Pomodoro timer
  * 
- * This file implements button functionality for 5 buttons with short
- * and long press detection. Buttons are on GPIO 10, 5, 4, 14, and 13.
+ * This file implements button functionality for 5 buttons with tap, long
+ * press, auto-repeat, double tap and chord recognition. Buttons are on
+ * GPIO 10, 5, 4, 14, and 13.
  * 
  * @author StuckAtPrototype, LLC
  * @version 2.0
@@ -11,11 +12,19 @@
 
 #include "button.h"
 #include "driver/gpio.h"
+#include "driver/gpio_filter.h"
+#include "hal/gpio_ll.h"
+#include "esp_sleep.h"
 #include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_timer.h"
+#include "systime.h"
+#include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include <stdbool.h>
+#include <inttypes.h>
 
 static const char *TAG = "button";
 
@@ -23,169 +32,409 @@ static const char *TAG = "button";
 #define BUTTON_GPIO_PINS {BUTTON_SW0_GPIO, BUTTON_SW1_GPIO, BUTTON_SW2_GPIO, BUTTON_SW3_GPIO, BUTTON_SW4_GPIO}
 static const uint8_t button_gpios[NUM_BUTTONS] = BUTTON_GPIO_PINS;
 
-// Debounce timing (in milliseconds)
-#define DEBOUNCE_MS 50
+// Debounce window (in milliseconds): a burst of edges is settled this long
+// after its first edge. Tactile switches bounce for under 5 ms.
+#define DEBOUNCE_MS 10
 
 // Long press threshold (in milliseconds)
 #define LONG_PRESS_MS 500
 
-// GPIO interrupt queue
+// Auto-repeat interval while a button is held past the long press
+#define REPEAT_MS 200
+
+// A second press this soon after a tap's release makes a double tap
+#define DOUBLE_TAP_MS 300
+
+// Sequences timed per gesture by the benchmark
+#define BENCHMARK_GESTURES 1000
+
+// Flex glitch filter: a level must hold this long to reach the GPIO matrix
+#define GLITCH_FILTER_WINDOW_NS 1000
+
+// Queue of button indices with a new burst of edges
 static QueueHandle_t gpio_evt_queue = NULL;
 
+// Gesture recognizer states, per button
+typedef enum {
+    GESTURE_IDLE = 0,
+    GESTURE_DOWN,             // Pressed: tap, hold or chord still possible
+    GESTURE_HELD,             // Long press sent, repeating
+    GESTURE_TAPPED,           // Tap sent on release, double tap window open
+    GESTURE_DOUBLE,           // Double tap sent, waiting for the release
+    GESTURE_CHORDED,          // Chord sent, waiting for the release
+    GESTURE_NUM_STATES
+} gesture_state_t;
+
+// Recognizer inputs: debounced edges, the state's deadline, and another
+// button going down while this one is down
+typedef enum {
+    GESTURE_IN_PRESS = 0,
+    GESTURE_IN_RELEASE,
+    GESTURE_IN_TIMEOUT,
+    GESTURE_IN_CHORD,
+    GESTURE_NUM_INPUTS
+} gesture_input_t;
+
+typedef enum {
+    GESTURE_ACT_NONE = 0,
+    GESTURE_ACT_TAP,
+    GESTURE_ACT_LONG,
+    GESTURE_ACT_REPEAT,
+    GESTURE_ACT_DOUBLE,       // Retract the tap, then send the double tap
+    GESTURE_ACT_CHORD,
+} gesture_action_t;
+
+// How a transition sets the state's deadline, counted from the input
+typedef enum {
+    GESTURE_TIMER_KEEP = 0,
+    GESTURE_TIMER_NONE,
+    GESTURE_TIMER_LONG,
+    GESTURE_TIMER_REPEAT,
+    GESTURE_TIMER_DOUBLE_TAP,
+} gesture_timer_t;
+
+typedef struct {
+    uint8_t next;             // gesture_state_t
+    uint8_t action;           // gesture_action_t
+    uint8_t timer;            // gesture_timer_t
+} gesture_transition_t;
+
+#define T(next, action, timer) { GESTURE_##next, GESTURE_ACT_##action, GESTURE_TIMER_##timer }
+
+// Transition table. A tap is sent on release, as soon as it is known not
+// to be a hold; if a second press then lands inside the double tap window
+// the tap is retracted. Every timeout sets a new deadline or clears it.
+static const gesture_transition_t gesture_table[GESTURE_NUM_STATES][GESTURE_NUM_INPUTS] = {
+    //                    PRESS                       RELEASE                     TIMEOUT                     CHORD
+    [GESTURE_IDLE]    = { T(DOWN, NONE, LONG),        T(IDLE, NONE, NONE),        T(IDLE, NONE, NONE),        T(IDLE, NONE, KEEP) },
+    [GESTURE_DOWN]    = { T(DOWN, NONE, KEEP),        T(TAPPED, TAP, DOUBLE_TAP), T(HELD, LONG, REPEAT),      T(CHORDED, CHORD, NONE) },
+    [GESTURE_HELD]    = { T(HELD, NONE, KEEP),        T(IDLE, NONE, NONE),        T(HELD, REPEAT, REPEAT),    T(HELD, NONE, KEEP) },
+    [GESTURE_TAPPED]  = { T(DOUBLE, DOUBLE, NONE),    T(TAPPED, NONE, KEEP),      T(IDLE, NONE, NONE),        T(TAPPED, NONE, KEEP) },
+    [GESTURE_DOUBLE]  = { T(DOUBLE, NONE, KEEP),      T(IDLE, NONE, NONE),        T(DOUBLE, NONE, NONE),      T(DOUBLE, NONE, KEEP) },
+    [GESTURE_CHORDED] = { T(CHORDED, NONE, KEEP),     T(IDLE, NONE, NONE),        T(CHORDED, NONE, NONE),     T(CHORDED, NONE, KEEP) },
+};
+
+#undef T
+
+static const char *const gesture_names[] = {
+    [BUTTON_PRESS_SHORT] = "tap",
+    [BUTTON_PRESS_LONG] = "long press",
+    [BUTTON_PRESS_REPEAT] = "repeat",
+    [BUTTON_PRESS_DOUBLE] = "double tap",
+    [BUTTON_PRESS_CHORD] = "chord",
+    [BUTTON_PRESS_RETRACT] = "tap retracted",
+};
+
+typedef struct {
+    gesture_state_t state;
+    int64_t deadline_us;      // Next GESTURE_IN_TIMEOUT, or SYSTIME_NEVER
+} gesture_t;
+
 // Button state tracking
 typedef struct {
     uint8_t gpio;
-    bool pressed;
-    TickType_t press_start_time;
-    bool event_sent;  // Track if we've already sent an event for this press
+    bool pressed;             // Debounced state
+    int64_t settle_us;        // End of the debounce window, or SYSTIME_NEVER
+    gesture_t gesture;
 } button_state_t;
 
 static button_state_t button_states[NUM_BUTTONS] = {0};
 
+// Edges the ISR saw in the current burst, per button
+typedef struct {
+    bool busy;                // Burst queued and not yet settled by the task
+    uint8_t first_level;
+    uint8_t last_level;
+    uint32_t edges;
+    int64_t first_us;         // systime_now_us() timebase
+    int64_t last_us;
+} button_edges_t;
+
+static button_edges_t isr_edges[NUM_BUTTONS] = {0};
+static portMUX_TYPE isr_edges_lock = portMUX_INITIALIZER_UNLOCKED;
+static button_stats_t button_stats = {0};
+
 // Event callback
 static button_event_callback_t event_callback = NULL;
 
 /**
  * @brief GPIO interrupt handler
  * 
- * This ISR is called when a GPIO interrupt occurs.
- * It sends the GPIO number and level to the queue for processing.
+ * This ISR is called for every level change of a button pin, bounces
+ * included. It timestamps the change, so debounce and press timing do
+ * not depend on when the button task gets to run, and coalesces edges per
+ * pin: only the first edge of a burst is queued, and the rest are folded
+ * into isr_edges until the button task settles the burst.
  */
-typedef struct {
-    uint32_t gpio_num;
-    uint32_t level;
-} gpio_event_t;
-
 static void IRAM_ATTR gpio_isr_handler(void* arg)
 {
-    uint32_t gpio_num = (uint32_t) arg;
+    uint8_t button_idx = (uint8_t)(uintptr_t) arg;
+    uint32_t gpio_num = button_states[button_idx].gpio;
     uint32_t level = gpio_get_level(gpio_num);
+    int64_t now_us = esp_timer_get_time();      // What systime_now_us() returns, callable from IRAM
     
-    gpio_event_t event = {
-        .gpio_num = gpio_num,
-        .level = level
-    };
+    // Only level interrupts can wake the chip from light sleep. Arming the
+    // opposite level after every change makes them behave like edges. It
+    // has to happen before returning, or the level that raised this
+    // interrupt raises it again at once. gpio_wakeup_enable() is not
+    // ISR-safe (it takes the driver's lock and may log), so the pin's
+    // interrupt type is written directly; wakeup itself stays enabled
+    // from button_init().
+    gpio_ll_set_intr_type(GPIO_LL_GET_HW(GPIO_PORT_0), gpio_num, level ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+    
+    portENTER_CRITICAL_ISR(&isr_edges_lock);
+    button_edges_t *edges = &isr_edges[button_idx];
+    bool first = !edges->busy;
+    if (first) {
+        edges->busy = true;
+        edges->first_level = level;
+        edges->first_us = now_us;
+        edges->edges = 0;
+    }
+    edges->last_level = level;
+    edges->last_us = now_us;
+    edges->edges++;
+    button_stats.isr_calls++;
+    portEXIT_CRITICAL_ISR(&isr_edges_lock);
     
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    xQueueSendFromISR(gpio_evt_queue, &event, &xHigherPriorityTaskWoken);
-    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    if (first) {
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        xQueueSendFromISR(gpio_evt_queue, &button_idx, &xHigherPriorityTaskWoken);
+        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    }
+}
+
+/**
+ * @brief Hand a gesture to the registered callback
+ */
+static void dispatch(button_press_type_t type, int button_idx, int chord_idx, int64_t event_us)
+{
+    if (type == BUTTON_PRESS_CHORD) {
+        ESP_LOGI(TAG, "Buttons %d+%d chord", button_idx, chord_idx);
+    } else {
+        ESP_LOGI(TAG, "Button %d %s", button_idx, gesture_names[type]);
+    }
+    if (event_callback != NULL) {
+        button_event_t event = {
+            .type = type,
+            .button_id = button_idx,
+            .chord_id = chord_idx,
+            .event_us = event_us,
+        };
+        event_callback(&event);
+    }
+}
+
+/**
+ * @brief Run one input through a button's transition table
+ * 
+ * @param at_us Time of the input; a timeout is stepped at its deadline
+ * @return Action the transition asks for
+ */
+static gesture_action_t gesture_step(gesture_t *gesture, gesture_input_t input, int64_t at_us)
+{
+    const gesture_transition_t *transition = &gesture_table[gesture->state][input];
+    gesture->state = transition->next;
+    switch (transition->timer) {
+        case GESTURE_TIMER_KEEP:
+            break;
+        case GESTURE_TIMER_NONE:
+            gesture->deadline_us = SYSTIME_NEVER;
+            break;
+        case GESTURE_TIMER_LONG:
+            gesture->deadline_us = at_us + LONG_PRESS_MS * SYSTIME_US_PER_MS;
+            break;
+        case GESTURE_TIMER_REPEAT:
+            gesture->deadline_us = at_us + REPEAT_MS * SYSTIME_US_PER_MS;
+            break;
+        case GESTURE_TIMER_DOUBLE_TAP:
+            gesture->deadline_us = at_us + DOUBLE_TAP_MS * SYSTIME_US_PER_MS;
+            break;
+    }
+    return transition->action;
 }
 
 /**
- * @brief Find button index by GPIO number
+ * @brief Carry out what a single button's transition asked for
+ */
+static void gesture_act(int button_idx, gesture_action_t action, int64_t at_us)
+{
+    switch (action) {
+        case GESTURE_ACT_NONE:
+        case GESTURE_ACT_CHORD:     // Dispatched once per chord by gesture_press()
+            break;
+        case GESTURE_ACT_TAP:
+            dispatch(BUTTON_PRESS_SHORT, button_idx, button_idx, at_us);
+            break;
+        case GESTURE_ACT_LONG:
+            dispatch(BUTTON_PRESS_LONG, button_idx, button_idx, at_us);
+            break;
+        case GESTURE_ACT_REPEAT:
+            dispatch(BUTTON_PRESS_REPEAT, button_idx, button_idx, at_us);
+            break;
+        case GESTURE_ACT_DOUBLE:
+            // The first tap went out speculatively on its release
+            button_stats.retracted++;
+            dispatch(BUTTON_PRESS_RETRACT, button_idx, button_idx, at_us);
+            dispatch(BUTTON_PRESS_DOUBLE, button_idx, button_idx, at_us);
+            break;
+    }
+}
+
+/**
+ * @brief Step every gesture timeout due at or before a time
  * 
- * @param gpio GPIO number
- * @return Button index (0-4) or -1 if not found
+ * Called before each input, so a timeout the task got to late is still
+ * ordered before the edge that followed it.
  */
-static int find_button_index(uint8_t gpio)
+static void advance_gestures(int64_t until_us)
 {
     for (int i = 0; i < NUM_BUTTONS; i++) {
-        if (button_gpios[i] == gpio) {
-            return i;
+        gesture_t *gesture = &button_states[i].gesture;
+        while (gesture->deadline_us <= until_us) {
+            int64_t at_us = gesture->deadline_us;
+            gesture_act(i, gesture_step(gesture, GESTURE_IN_TIMEOUT, at_us), at_us);
         }
     }
-    return -1;
 }
 
 /**
- * @brief Button task to handle debouncing and press detection
+ * @brief Feed a debounced press to the recognizer
  * 
- * This task processes button presses with debouncing and detects
- * short vs long presses.
+ * A press while another button is down and not yet held turns both into
+ * a chord.
  */
-static void button_task(void *pvParameters)
+static void gesture_press(int button_idx, int64_t edge_us)
 {
-    gpio_event_t event;
-    TickType_t last_debounce_time[NUM_BUTTONS] = {0};
-    
-    ESP_LOGI(TAG, "Button task started");
+    gesture_t *gesture = &button_states[button_idx].gesture;
+    gesture_act(button_idx, gesture_step(gesture, GESTURE_IN_PRESS, edge_us), edge_us);
+    if (gesture->state != GESTURE_DOWN) {
+        return;
+    }
     
-    while (1) {
-        // Wait for GPIO event from ISR
-        if (xQueueReceive(gpio_evt_queue, &event, portMAX_DELAY)) {
-            int button_idx = find_button_index(event.gpio_num);
-            if (button_idx < 0) {
-                continue;  // Unknown GPIO, ignore
-            }
-            
-            TickType_t current_time = xTaskGetTickCount();
-            button_state_t *btn = &button_states[button_idx];
-            
-            // Debounce: only process if enough time has passed since last event
-            if (current_time - last_debounce_time[button_idx] > pdMS_TO_TICKS(DEBOUNCE_MS)) {
-                last_debounce_time[button_idx] = current_time;
-                
-                if (event.level == 1) {
-                    // Button pressed (rising edge)
-                    btn->pressed = true;
-                    btn->press_start_time = current_time;
-                    btn->event_sent = false;
-                    ESP_LOGD(TAG, "Button %d pressed", button_idx);
-                } else {
-                    // Button released (falling edge)
-                    if (btn->pressed) {
-                        TickType_t press_duration = current_time - btn->press_start_time;
-                        uint32_t press_duration_ms = (press_duration * 1000) / configTICK_RATE_HZ;
-                        
-                        // Determine if it was a short or long press
-                        button_press_type_t press_type = (press_duration_ms >= LONG_PRESS_MS) ? 
-                                                          BUTTON_PRESS_LONG : BUTTON_PRESS_SHORT;
-                        
-                        // Only send event if we haven't already sent a long press event
-                        if (!btn->event_sent) {
-                            ESP_LOGI(TAG, "Button %d %s press (%lu ms)", 
-                                    button_idx, 
-                                    press_type == BUTTON_PRESS_LONG ? "long" : "short",
-                                    press_duration_ms);
-                            
-                            if (event_callback != NULL) {
-                                event_callback(button_idx, press_type);
-                            }
-                        }
-                        
-                        btn->pressed = false;
-                        btn->event_sent = false;
-                    }
-                }
-            }
+    for (int i = 0; i < NUM_BUTTONS; i++) {
+        gesture_t *other = &button_states[i].gesture;
+        if (i != button_idx && other->state == GESTURE_DOWN) {
+            gesture_step(other, GESTURE_IN_CHORD, edge_us);
+            gesture_step(gesture, GESTURE_IN_CHORD, edge_us);
+            dispatch(BUTTON_PRESS_CHORD, i, button_idx, edge_us);
+            return;
         }
     }
 }
 
 /**
- * @brief Check for long presses (called periodically)
+ * @brief Apply a debounced press or release
  * 
- * This function checks if any button has been held long enough
- * to trigger a long press event.
+ * @param edge_us Time of the edge (systime_now_us() timebase)
  */
-static void button_long_press_check_task(void *pvParameters)
+static void set_pressed(int button_idx, bool pressed, int64_t edge_us)
 {
-    ESP_LOGI(TAG, "Button long press check task started");
+    button_state_t *btn = &button_states[button_idx];
     
-    while (1) {
-        vTaskDelay(pdMS_TO_TICKS(50));  // Check every 50ms
+    advance_gestures(edge_us);
+    btn->pressed = pressed;
+    if (pressed) {
+        ESP_LOGD(TAG, "Button %d pressed", button_idx);
+        gesture_press(button_idx, edge_us);
+    } else {
+        ESP_LOGD(TAG, "Button %d released", button_idx);
+        button_stats.presses++;
+        gesture_act(button_idx, gesture_step(&btn->gesture, GESTURE_IN_RELEASE, edge_us), edge_us);
+    }
+}
+
+/**
+ * @brief Start of a burst of edges: act on its first edge right away
+ */
+static void handle_burst(uint8_t button_idx)
+{
+    if (button_idx >= NUM_BUTTONS) {
+        return;  // Unknown button, ignore
+    }
+    
+    portENTER_CRITICAL(&isr_edges_lock);
+    button_edges_t edges = isr_edges[button_idx];
+    portEXIT_CRITICAL(&isr_edges_lock);
+    
+    button_state_t *btn = &button_states[button_idx];
+    btn->settle_us = edges.first_us + DEBOUNCE_MS * SYSTIME_US_PER_MS;
+    button_stats.bursts++;
+    if (edges.first_level != btn->pressed) {
+        set_pressed(button_idx, edges.first_level, edges.first_us);
+    }
+}
+
+/**
+ * @brief End the debounce window of every burst that is due
+ * 
+ * Once the contacts have settled, the pin level is compared with the
+ * debounced state. A change the first edge did not cover, such as a
+ * release inside the window, is applied with the time of the burst's
+ * last edge.
+ */
+static void settle_bursts(int64_t now_us)
+{
+    for (int i = 0; i < NUM_BUTTONS; i++) {
+        button_state_t *btn = &button_states[i];
+        if (btn->settle_us == SYSTIME_NEVER || now_us < btn->settle_us) {
+            continue;
+        }
         
-        TickType_t current_time = xTaskGetTickCount();
+        portENTER_CRITICAL(&isr_edges_lock);
+        button_edges_t edges = isr_edges[i];
+        isr_edges[i].busy = false;      // The next edge starts a new burst
+        portEXIT_CRITICAL(&isr_edges_lock);
         
-        for (int i = 0; i < NUM_BUTTONS; i++) {
-            button_state_t *btn = &button_states[i];
-            
-            if (btn->pressed && !btn->event_sent) {
-                TickType_t press_duration = current_time - btn->press_start_time;
-                uint32_t press_duration_ms = (press_duration * 1000) / configTICK_RATE_HZ;
-                
-                // If button has been held for long press threshold, send long press event
-                if (press_duration_ms >= LONG_PRESS_MS) {
-                    ESP_LOGI(TAG, "Button %d long press detected (%lu ms)", i, press_duration_ms);
-                    
-                    if (event_callback != NULL) {
-                        event_callback(i, BUTTON_PRESS_LONG);
-                    }
-                    
-                    btn->event_sent = true;  // Mark that we've sent the long press event
-                }
-            }
+        btn->settle_us = SYSTIME_NEVER;
+        ESP_LOGD(TAG, "Button %d settled after %" PRIu32 " edges", i, edges.edges);
+        
+        bool level = gpio_get_level(btn->gpio) != 0;
+        if (level != btn->pressed) {
+            set_pressed(i, level, edges.last_us);
+        }
+    }
+}
+
+/**
+ * @brief Earliest time the button task has work without a new edge
+ * 
+ * @return The earliest debounce window end or gesture deadline
+ *         (systime_now_us() timebase), or SYSTIME_NEVER
+ */
+static int64_t next_button_deadline_us(void)
+{
+    int64_t deadline_us = SYSTIME_NEVER;
+    for (int i = 0; i < NUM_BUTTONS; i++) {
+        const button_state_t *btn = &button_states[i];
+        deadline_us = systime_earlier(deadline_us, btn->settle_us);
+        deadline_us = systime_earlier(deadline_us, btn->gesture.deadline_us);
+    }
+    return deadline_us;
+}
+
+/**
+ * @brief Button task to handle debouncing and press detection
+ * 
+ * This task processes bursts of button edges with debouncing and runs
+ * them through the gesture recognizer. It owns all button state, and it
+ * waits for the next burst no longer than until the earliest debounce
+ * window end or gesture deadline, so it only runs when there is work to do.
+ */
+static void button_task(void *pvParameters)
+{
+    uint8_t button_idx;
+    
+    ESP_LOGI(TAG, "Button task started");
+    
+    while (1) {
+        // Wait for a burst from the ISR or the next deadline
+        if (xQueueReceive(gpio_evt_queue, &button_idx, systime_ticks_until(next_button_deadline_us()))) {
+            handle_burst(button_idx);
         }
+        int64_t now_us = systime_now_us();
+        settle_bursts(now_us);
+        advance_gestures(now_us);
     }
 }
 
@@ -193,14 +442,15 @@ static void button_long_press_check_task(void *pvParameters)
  * @brief Initialize button functionality
  * 
  * This function configures all 5 buttons as inputs with pull-down resistors
- * and sets up interrupts for both rising and falling edges.
+ * and sets up interrupts for both rising and falling edges. The interrupts
+ * are level-triggered so a press also wakes the chip from light sleep.
  */
 void button_init(void)
 {
     ESP_LOGI(TAG, "Initializing %d buttons", NUM_BUTTONS);
     
-    // Create queue for GPIO events
-    gpio_evt_queue = xQueueCreate(20, sizeof(gpio_event_t));
+    // Create queue for GPIO events; the ISR queues at most one per button
+    gpio_evt_queue = xQueueCreate(NUM_BUTTONS, sizeof(uint8_t));
     if (gpio_evt_queue == NULL) {
         ESP_LOGE(TAG, "Failed to create GPIO event queue");
         return;
@@ -210,8 +460,9 @@ void button_init(void)
     for (int i = 0; i < NUM_BUTTONS; i++) {
         button_states[i].gpio = button_gpios[i];
         button_states[i].pressed = false;
-        button_states[i].press_start_time = 0;
-        button_states[i].event_sent = false;
+        button_states[i].settle_us = SYSTIME_NEVER;
+        button_states[i].gesture.state = GESTURE_IDLE;
+        button_states[i].gesture.deadline_us = SYSTIME_NEVER;
     }
     
     // Configure all button GPIOs
@@ -221,7 +472,7 @@ void button_init(void)
     }
     
     gpio_config_t io_conf = {
-        .intr_type = GPIO_INTR_ANYEDGE,      // Interrupt on both rising and falling edges
+        .intr_type = GPIO_INTR_HIGH_LEVEL,   // Level interrupt, flipped on every change by the ISR
         .mode = GPIO_MODE_INPUT,              // Input mode
         .pin_bit_mask = pin_bit_mask,
         .pull_down_en = GPIO_PULLDOWN_ENABLE, // Enable pull-down (button normally LOW)
@@ -234,6 +485,27 @@ void button_init(void)
         return;
     }
     
+#if CONFIG_FOCUSBAR_BUTTON_GLITCH_FILTER
+    // Filter sub-microsecond spikes in hardware; contact bounce is longer
+    // and is coalesced by the ISR instead
+    for (int i = 0; i < NUM_BUTTONS; i++) {
+        gpio_flex_glitch_filter_config_t filter_config = {
+            .clk_src = GLITCH_FILTER_CLK_SRC_DEFAULT,
+            .gpio_num = button_gpios[i],
+            .window_width_ns = GLITCH_FILTER_WINDOW_NS,
+            .window_thres_ns = GLITCH_FILTER_WINDOW_NS,
+        };
+        gpio_glitch_filter_handle_t filter;
+        ret = gpio_new_flex_glitch_filter(&filter_config, &filter);
+        if (ret == ESP_OK) {
+            ret = gpio_glitch_filter_enable(filter);
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "No glitch filter on GPIO %d: %s", button_gpios[i], esp_err_to_name(ret));
+        }
+    }
+#endif
+    
     // Install GPIO ISR service
     ret = gpio_install_isr_service(0);
     if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
@@ -244,25 +516,31 @@ void button_init(void)
     
     // Hook ISR handler for each GPIO
     for (int i = 0; i < NUM_BUTTONS; i++) {
-        ret = gpio_isr_handler_add(button_gpios[i], gpio_isr_handler, (void*)(uintptr_t)button_gpios[i]);
+        ret = gpio_isr_handler_add(button_gpios[i], gpio_isr_handler, (void*)(uintptr_t)i);
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "Failed to add ISR handler for GPIO %d: %s", button_gpios[i], esp_err_to_name(ret));
             return;
         }
+        
+        // Wake from light sleep on press; the ISR re-arms for the release
+        ret = gpio_wakeup_enable(button_gpios[i], GPIO_INTR_HIGH_LEVEL);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to enable wakeup for GPIO %d: %s", button_gpios[i], esp_err_to_name(ret));
+            return;
+        }
         ESP_LOGI(TAG, "Button %d configured on GPIO %d", i, button_gpios[i]);
     }
     
-    // Create button task
-    BaseType_t task_ret = xTaskCreate(button_task, "button_task", 4096, NULL, 5, NULL);
-    if (task_ret != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create button task");
+    ret = esp_sleep_enable_gpio_wakeup();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to enable GPIO wakeup: %s", esp_err_to_name(ret));
         return;
     }
     
-    // Create long press check task
-    task_ret = xTaskCreate(button_long_press_check_task, "button_long_check", 2048, NULL, 5, NULL);
+    // Create button task
+    BaseType_t task_ret = xTaskCreate(button_task, "button_task", 4096, NULL, 5, NULL);
     if (task_ret != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create button long press check task");
+        ESP_LOGE(TAG, "Failed to create button task");
         return;
     }
     
@@ -274,3 +552,67 @@ void button_register_callback(button_event_callback_t callback)
     event_callback = callback;
     ESP_LOGI(TAG, "Button event callback registered");
 }
+
+void button_get_stats(button_stats_t *stats)
+{
+    portENTER_CRITICAL(&isr_edges_lock);
+    *stats = button_stats;
+    portEXIT_CRITICAL(&isr_edges_lock);
+}
+
+void button_gesture_benchmark(void)
+{
+    // One scripted sequence per gesture; the last input is the deciding one
+    static const struct {
+        const char *name;
+        gesture_input_t inputs[4];
+        int count;
+    } scripts[] = {
+        { "tap",    { GESTURE_IN_PRESS, GESTURE_IN_RELEASE }, 2 },
+        { "long",   { GESTURE_IN_PRESS, GESTURE_IN_TIMEOUT }, 2 },
+        { "repeat", { GESTURE_IN_PRESS, GESTURE_IN_TIMEOUT, GESTURE_IN_TIMEOUT }, 3 },
+        { "double", { GESTURE_IN_PRESS, GESTURE_IN_RELEASE, GESTURE_IN_PRESS }, 3 },
+        { "chord",  { GESTURE_IN_PRESS, GESTURE_IN_CHORD }, 2 },
+    };
+    volatile uint32_t sink = 0;
+    
+    for (size_t s = 0; s < sizeof(scripts) / sizeof(scripts[0]); s++) {
+        uint32_t decide_cycles = 0;
+        for (uint32_t run = 0; run < BENCHMARK_GESTURES; run++) {
+            gesture_t gesture = { .state = GESTURE_IDLE, .deadline_us = SYSTIME_NEVER };
+            int64_t at_us = 0;
+            int last = scripts[s].count - 1;
+            for (int i = 0; i < last; i++) {
+                sink = gesture_step(&gesture, scripts[s].inputs[i], at_us);
+                at_us = gesture.deadline_us != SYSTIME_NEVER ? gesture.deadline_us : at_us + 1000;
+            }
+            uint32_t start = esp_cpu_get_cycle_count();
+            sink = gesture_step(&gesture, scripts[s].inputs[last], at_us);
+            decide_cycles += esp_cpu_get_cycle_count() - start;
+        }
+        ESP_LOGI(TAG, "Gesture decision, %s: %" PRIu32 " cycles after the deciding input",
+                 scripts[s].name, decide_cycles / BENCHMARK_GESTURES);
+    }
+    (void)sink;
+    
+    // Tap latency, run through the table: when the tap comes out, and when
+    // it becomes final (no double tap possible), both from the release. A
+    // recognizer that held taps back until they are final would send them
+    // at the second time.
+    gesture_t gesture = { .state = GESTURE_IDLE, .deadline_us = SYSTIME_NEVER };
+    int64_t release_us = (LONG_PRESS_MS / 2) * SYSTIME_US_PER_MS;
+    int64_t tap_us = SYSTIME_NEVER;
+    gesture_step(&gesture, GESTURE_IN_PRESS, 0);
+    if (gesture_step(&gesture, GESTURE_IN_RELEASE, release_us) == GESTURE_ACT_TAP) {
+        tap_us = release_us;
+    }
+    int64_t final_us = release_us;
+    while (gesture.state != GESTURE_IDLE && gesture.deadline_us != SYSTIME_NEVER) {
+        final_us = gesture.deadline_us;
+        if (gesture_step(&gesture, GESTURE_IN_TIMEOUT, final_us) == GESTURE_ACT_TAP && tap_us == SYSTIME_NEVER) {
+            tap_us = final_us;
+        }
+    }
+    ESP_LOGI(TAG, "Tap sent %" PRId64 " us after the release, final %" PRId64 " us after it",
+             tap_us - release_us, final_us - release_us);
+}
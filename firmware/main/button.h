@@ -3,7 +3,8 @@
  * @brief Button control header for Pomodoro timer
  * 
  * This header file defines the interface for button functionality with
- * 5 buttons supporting short and long press detection.
+ * 5 buttons supporting taps, long presses with auto-repeat, double taps
+ * and two-button chords.
  * 
  * @author StuckAtPrototype, LLC
  * @version 2.0
@@ -34,21 +35,55 @@ extern "C" {
 #define BUTTON_SW4 4
 #define NUM_BUTTONS 5
 
-// Button press types
+// Button gestures
 typedef enum {
-    BUTTON_PRESS_SHORT = 0,
-    BUTTON_PRESS_LONG = 1
+    BUTTON_PRESS_SHORT = 0,     // Tap, sent on release
+    BUTTON_PRESS_LONG = 1,      // Held for 500 ms
+    BUTTON_PRESS_REPEAT,        // Still held, every 200 ms after the long press
+    BUTTON_PRESS_DOUBLE,        // Pressed again within 300 ms of a tap's release
+    BUTTON_PRESS_CHORD,         // Pressed while another button is down
+    BUTTON_PRESS_RETRACT,       // The tap just sent was the start of a double tap
 } button_press_type_t;
 
-// Button event callback type
-typedef void (*button_event_callback_t)(uint8_t button_id, button_press_type_t press_type);
+// Button event
+typedef struct {
+    button_press_type_t type;
+    uint8_t button_id;          // Button index (0-4); for a chord, the one pressed first
+    uint8_t chord_id;           // For a chord, the button pressed second; else button_id
+    int64_t event_us;           // When the gesture was recognized (systime_now_us() timebase)
+} button_event_t;
+
+// Button input statistics
+typedef struct {
+    uint32_t isr_calls;     // GPIO interrupts, bounces included
+    uint32_t bursts;        // Bursts of edges queued to the button task
+    uint32_t presses;       // Completed presses (press and release)
+    uint32_t retracted;     // Taps retracted because a double tap followed
+} button_stats_t;
+
+/**
+ * @brief Button event callback type
+ * 
+ * A tap is sent speculatively as soon as the button is released, so it
+ * costs no latency over a plain short press. If the button is pressed
+ * again within the double tap window, BUTTON_PRESS_RETRACT asks the
+ * receiver to undo that tap and BUTTON_PRESS_DOUBLE follows right away.
+ * A chord is recognized while both buttons are down, before either is
+ * released, so its buttons never send taps.
+ * 
+ * event_us is the deciding edge as timestamped by the GPIO ISR, or the
+ * deadline of a long press or repeat.
+ * 
+ * @param event Gesture, valid for the duration of the call
+ */
+typedef void (*button_event_callback_t)(const button_event_t *event);
 
 /**
  * @brief Initialize button functionality
  * 
  * This function configures all 5 buttons as inputs with pull-down resistors
  * and sets up interrupts for both rising and falling edges to detect
- * short and long presses.
+ * button gestures. A press also wakes the chip from light sleep.
  */
 void button_init(void);
 
@@ -59,6 +94,22 @@ void button_init(void);
  */
 void button_register_callback(button_event_callback_t callback);
 
+/**
+ * @brief Get button input statistics
+ * 
+ * @param stats Filled with the counts since boot
+ */
+void button_get_stats(button_stats_t *stats);
+
+/**
+ * @brief Benchmark the gesture recognizer
+ * 
+ * Runs a scripted input sequence for every gesture through the
+ * transition table and logs the cycles spent on the input that decides
+ * it. Uses its own recognizer state, so it can run at any time.
+ */
+void button_gesture_benchmark(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,134 @@
+/**
+ * @file journal.c
+ * @brief Focus session journal in NVS
+ *
+ * This file implements the session journal. The record holds the timer
+ * state, the session duration and the session start on the RTC clock, so
+ * it stays valid across resets without being rewritten while the session
+ * runs. Each boot converts between the RTC clock and systime through its
+ * boot epoch, the RTC time at which systime_now_us() was 0.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#include "journal.h"
+#include "systime.h"
+#include "nvs.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include <inttypes.h>
+#include <string.h>
+
+static const char *TAG = "journal";
+
+#define JOURNAL_NAMESPACE   "focusbar"
+#define JOURNAL_KEY         "session"
+#define JOURNAL_VERSION     1
+
+// Journal record as stored in NVS
+typedef struct {
+    uint8_t version;
+    uint8_t state;              // timer_state_t at the last transition
+    uint16_t duration_minutes;  // Session duration, 0 when idle
+    uint32_t reserved;
+    int64_t start_rtc_us;       // Session start on the RTC clock
+} journal_record_t;
+
+_Static_assert(sizeof(journal_record_t) == 16, "journal record layout changed");
+
+static nvs_handle_t journal_handle = 0;
+static bool journal_open = false;
+static int64_t boot_epoch_us = 0;       // RTC time at which systime_now_us() was 0
+static journal_record_t journaled = { .version = JOURNAL_VERSION, .state = TIMER_STATE_IDLE };
+
+/**
+ * @brief Write a record to NVS and keep it as the journaled one
+ */
+static void write_record(const journal_record_t *record)
+{
+    int64_t write_start_us = systime_now_us();
+    esp_err_t ret = nvs_set_blob(journal_handle, JOURNAL_KEY, record, sizeof(*record));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(journal_handle);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write journal: %s", esp_err_to_name(ret));
+        return;
+    }
+    journaled = *record;
+    ESP_LOGI(TAG, "Journaled state %d in %" PRId64 " us", record->state, systime_now_us() - write_start_us);
+}
+
+bool journal_init(void)
+{
+    esp_err_t ret = nvs_open(JOURNAL_NAMESPACE, NVS_READWRITE, &journal_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS namespace: %s", esp_err_to_name(ret));
+        return false;
+    }
+    journal_open = true;
+    boot_epoch_us = systime_rtc_us() - systime_now_us();
+    return true;
+}
+
+bool journal_restore(void)
+{
+    if (!journal_open) {
+        return false;
+    }
+
+    journal_record_t record;
+    size_t length = sizeof(record);
+    esp_err_t ret = nvs_get_blob(journal_handle, JOURNAL_KEY, &record, &length);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        return false;
+    }
+    if (ret != ESP_OK || length != sizeof(record) || record.version != JOURNAL_VERSION) {
+        ESP_LOGW(TAG, "Discarding unreadable journal (%s)", esp_err_to_name(ret));
+        nvs_erase_key(journal_handle, JOURNAL_KEY);
+        nvs_commit(journal_handle);
+        return false;
+    }
+    journaled = record;
+    if (record.state == TIMER_STATE_IDLE) {
+        return false;
+    }
+
+    // After a power-on reset the RTC clock starts over, so the time the
+    // device spent off is unknown
+    esp_reset_reason_t reason = esp_reset_reason();
+    int64_t start_us = record.start_rtc_us - boot_epoch_us;
+    if (reason == ESP_RST_POWERON || start_us > systime_now_us()) {
+        ESP_LOGW(TAG, "Dropping journaled session (reset reason %d)", reason);
+        journal_record();
+        return false;
+    }
+
+    timer_state_t state = timer_resume(start_us, record.duration_minutes);
+    journal_record();
+    return state != TIMER_STATE_IDLE;
+}
+
+void journal_record(void)
+{
+    if (!journal_open) {
+        return;
+    }
+
+    timer_snapshot_t timer;
+    timer_get_snapshot(&timer);
+    journal_record_t record = { .version = JOURNAL_VERSION, .state = timer.state };
+    if (timer.state == TIMER_STATE_RUNNING) {
+        record.duration_minutes = (uint16_t)(timer.duration_us / (60 * SYSTIME_US_PER_SEC));
+        record.start_rtc_us = boot_epoch_us + timer.start_us;
+    } else if (timer.state != TIMER_STATE_IDLE) {
+        // Later states keep the start of the session that led to them
+        record.duration_minutes = journaled.duration_minutes;
+        record.start_rtc_us = journaled.start_rtc_us;
+    }
+
+    if (memcmp(&record, &journaled, sizeof(record)) != 0) {
+        write_record(&record);
+    }
+}
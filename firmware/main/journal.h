@@ -0,0 +1,60 @@
+/**
+ * @file journal.h
+ * @brief Focus session journal in NVS
+ *
+ * This header file defines the interface for keeping the running focus
+ * session in NVS so that a reset (brownout, watchdog, crash) does not lose
+ * it. The journal is written only when the timer changes state, never
+ * while a session is simply counting down.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdbool.h>
+#include "timer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Open the journal
+ *
+ * Call once after nvs_flash_init().
+ *
+ * @return true on success, false if NVS cannot be opened (the journal is
+ *         then disabled)
+ */
+bool journal_init(void);
+
+/**
+ * @brief Resume the session recorded before the last reset, if any
+ *
+ * The session's start time is carried over through the RTC clock, which
+ * keeps counting through every reset except power-on; after a power-on
+ * reset the journal cannot tell how long the device was off and the
+ * session is dropped. Call after timer_init().
+ *
+ * @return true if a session was resumed (see timer_get_state())
+ */
+bool journal_restore(void);
+
+/**
+ * @brief Record the timer state
+ *
+ * Cheap to call on every main loop pass: NVS is written only when the
+ * record changes, that is on a state transition or a new session. The
+ * state and run are read together (timer_get_snapshot()), so a start or
+ * stop from another task never yields a mixed record.
+ */
+void journal_record(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JOURNAL_H
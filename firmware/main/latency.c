@@ -0,0 +1,142 @@
+/**
+ * @file latency.c
+ * @brief End-to-end button input latency histograms
+ *
+ * This file implements the press latency measurement. One press is in
+ * flight at a time: the button callback starts it, the main loop marks
+ * when its LED state is set, and the LED task completes it with the
+ * first frame rendered after that. A press that is still waiting for its
+ * frame when the next one arrives changed nothing visible and is only
+ * counted.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#include "latency.h"
+#include "systime.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+
+static portMUX_TYPE latency_lock = portMUX_INITIALIZER_UNLOCKED;
+static latency_stats_t latency_stats = {0};
+
+// Press in flight
+static uint32_t press_id = 0;           // 0: no press yet
+static int64_t press_event_us = 0;
+static int64_t press_stage_us = 0;     // Start of the stage in progress
+static bool press_handled = false;
+static bool press_applied = false;
+static bool press_done = false;
+
+static const char *const stage_names[LATENCY_NUM_STAGES] = {
+    "edge->callback",
+    "callback->handled",
+    "handled->frame",
+    "edge->frame",
+};
+
+/**
+ * @brief Add one latency to a histogram
+ */
+static void record(latency_histogram_t *histogram, int64_t latency_us)
+{
+    uint32_t us = latency_us < 0 ? 0 : latency_us > UINT32_MAX ? UINT32_MAX : (uint32_t)latency_us;
+    int bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+    if (bucket >= LATENCY_BUCKETS) {
+        bucket = LATENCY_BUCKETS - 1;
+    }
+
+    if (histogram->count == 0 || us < histogram->min_us) {
+        histogram->min_us = us;
+    }
+    if (us > histogram->max_us) {
+        histogram->max_us = us;
+    }
+    histogram->count++;
+    histogram->total_us += us;
+    histogram->buckets[bucket]++;
+}
+
+void latency_press(int64_t event_us)
+{
+    int64_t now_us = systime_now_us();
+
+    portENTER_CRITICAL(&latency_lock);
+    if (press_id != 0 && !press_done) {
+        latency_stats.no_frame++;
+    }
+    press_id = press_id + 1 != 0 ? press_id + 1 : 1;
+    press_event_us = event_us;
+    press_stage_us = now_us;
+    press_handled = false;
+    press_applied = false;
+    press_done = false;
+    record(&latency_stats.stages[LATENCY_EDGE_TO_CALLBACK], now_us - event_us);
+    portEXIT_CRITICAL(&latency_lock);
+}
+
+void latency_handled(void)
+{
+    int64_t now_us = systime_now_us();
+
+    portENTER_CRITICAL(&latency_lock);
+    if (press_id != 0 && !press_handled) {
+        record(&latency_stats.stages[LATENCY_CALLBACK_TO_HANDLED], now_us - press_stage_us);
+        press_stage_us = now_us;
+        press_handled = true;
+    }
+    portEXIT_CRITICAL(&latency_lock);
+}
+
+void latency_applied(void)
+{
+    portENTER_CRITICAL(&latency_lock);
+    if (press_handled) {
+        press_applied = true;
+    }
+    portEXIT_CRITICAL(&latency_lock);
+}
+
+uint32_t latency_frame_begin(void)
+{
+    portENTER_CRITICAL(&latency_lock);
+    uint32_t token = press_applied && !press_done ? press_id : 0;
+    portEXIT_CRITICAL(&latency_lock);
+    return token;
+}
+
+void latency_frame_sent(uint32_t token)
+{
+    if (token == 0) {
+        return;
+    }
+    int64_t now_us = systime_now_us();
+
+    portENTER_CRITICAL(&latency_lock);
+    if (token == press_id && !press_done) {
+        record(&latency_stats.stages[LATENCY_HANDLED_TO_FRAME], now_us - press_stage_us);
+        record(&latency_stats.stages[LATENCY_EDGE_TO_FRAME], now_us - press_event_us);
+        press_done = true;
+    }
+    portEXIT_CRITICAL(&latency_lock);
+}
+
+void latency_get_stats(latency_stats_t *stats)
+{
+    portENTER_CRITICAL(&latency_lock);
+    *stats = latency_stats;
+    portEXIT_CRITICAL(&latency_lock);
+}
+
+void latency_reset(void)
+{
+    portENTER_CRITICAL(&latency_lock);
+    memset(&latency_stats, 0, sizeof(latency_stats));
+    portEXIT_CRITICAL(&latency_lock);
+}
+
+const char *latency_stage_name(latency_stage_t stage)
+{
+    return stage < LATENCY_NUM_STAGES ? stage_names[stage] : "?";
+}
@@ -0,0 +1,105 @@
+/**
+ * @file latency.h
+ * @brief End-to-end button input latency histograms
+ *
+ * This header file defines the interface for measuring how long a button
+ * press takes to show on the LEDs. Each press is timed from the moment
+ * it was recognized (the ISR timestamp of the edge that decided the
+ * gesture, or the long press deadline) through the button callback and timer_handle_button()
+ * to the first WS2812 frame handed to RMT after the new state was
+ * applied. The frame then takes another 300 us on the wire for 10 LEDs.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Histogram bucket i counts latencies of 2^(i-1) to 2^i - 1 us (bucket 0: 0 us)
+#define LATENCY_BUCKETS 24
+
+// Measured intervals
+typedef enum {
+    LATENCY_EDGE_TO_CALLBACK = 0,   // Button recognized -> callback entered
+    LATENCY_CALLBACK_TO_HANDLED,    // Callback entered -> timer_handle_button() returned
+    LATENCY_HANDLED_TO_FRAME,       // timer_handle_button() returned -> first frame to RMT
+    LATENCY_EDGE_TO_FRAME,          // End to end
+    LATENCY_NUM_STAGES
+} latency_stage_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t buckets[LATENCY_BUCKETS];
+} latency_histogram_t;
+
+typedef struct {
+    latency_histogram_t stages[LATENCY_NUM_STAGES];
+    uint32_t no_frame;              // Presses that changed nothing on the LEDs
+} latency_stats_t;
+
+/**
+ * @brief Start timing a press (button callback entry)
+ *
+ * @param event_us When the press was recognized (systime_now_us() timebase)
+ */
+void latency_press(int64_t event_us);
+
+/**
+ * @brief Mark that timer_handle_button() returned for the current press
+ */
+void latency_handled(void);
+
+/**
+ * @brief Mark that the LED state for the current press has been set
+ *
+ * Frames rendered from now on reflect the press.
+ */
+void latency_applied(void);
+
+/**
+ * @brief Called by the LED task when it starts rendering a frame
+ *
+ * @return Token to pass to latency_frame_sent()
+ */
+uint32_t latency_frame_begin(void);
+
+/**
+ * @brief Called by the LED task once a frame was handed to RMT
+ *
+ * Completes the current press if the frame was rendered after
+ * latency_applied().
+ *
+ * @param token Value latency_frame_begin() returned for this frame
+ */
+void latency_frame_sent(uint32_t token);
+
+/**
+ * @brief Get a copy of the histograms
+ */
+void latency_get_stats(latency_stats_t *stats);
+
+/**
+ * @brief Clear the histograms
+ */
+void latency_reset(void);
+
+/**
+ * @brief Name of a stage for reports
+ */
+const char *latency_stage_name(latency_stage_t stage);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LATENCY_H
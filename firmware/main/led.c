@@ -13,221 +13,514 @@
 #include "esp_log.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
-#include "led_color_lib.h"
-#include <math.h>
+#include "esp_cpu.h"
+#include "systime.h"
+#include "latency.h"
+#include "led_tables.h"
+#include <inttypes.h>
 
 static const char *TAG = "led";
 
 // Mutex to protect LED updates
 static SemaphoreHandle_t led_mutex = NULL;
 
-// LED state structure for WS2812 driver
-static struct led_state led_state = {0};
+// LED task handle, notified whenever the scene changes
+static TaskHandle_t led_task_handle = NULL;
 
-// Individual LED colors (GRB format)
-static uint32_t led_colors[NUM_LEDS] = {0};
+// Owner of the WS2812 strip: led_task, or a caller of led_begin_direct_frame()
+static SemaphoreHandle_t wire_mutex = NULL;
+static volatile bool led_paused = false;   // led_task leaves the strip alone
 
-// Global intensity
-static float target_intensity = 1.0f;
-static float current_intensity = 1.0f;
+// Individual LED colors (wire order)
+static ws2812_pixel_t led_colors[NUM_LEDS] = {0};
 
-// Progress bar state
-static float target_progress = 0.0f;  // Target progress (0.0 to 1.0)
-static float current_progress = 0.0f;  // Current progress (smoothly transitioning)
-static uint32_t progress_color = LED_COLOR_GREEN;  // Color for progress bar
+// Fixed-point formats used by the renderer (the CPU has no FPU)
+// Q16.16: 1.0 == 65536, used for intensity, progress and brightness
+#define Q16_ONE  65536
+#define Q16_HALF (Q16_ONE / 2)
+
+// Global intensity (Q16.16)
+static int32_t target_intensity = Q16_ONE;
+static int32_t current_intensity = Q16_ONE;
+
+// Progress bar state (Q16.16)
+static int32_t target_progress = 0;  // Target progress (0.0 to 1.0)
+static int32_t current_progress = 0;  // Current progress (smoothly transitioning)
+static ws2812_pixel_t progress_color = {0};  // Color for progress bar
+
+// Progress ramp: progress computed from the time of each frame (led_set_progress_ramp)
+static bool ramp_active = false;
+static int64_t ramp_start_us = 0;
+static int64_t ramp_duration_us = 0;
 
 // Pulsing/Solid state
 static bool pulsing_enabled = false;
 static bool solid_mode = false; 
 static bool pending_solid_mode = false; // Pending switch to solid mode after windback
-static uint32_t pending_solid_color = LED_COLOR_OFF;
+static ws2812_pixel_t pending_solid_color = {0};
 static bool pending_start_transition = false; // Pending switch to progress mode after windback
-static uint32_t pending_start_color = LED_COLOR_OFF;
-static float pending_start_progress = 0.0f;
-static uint32_t pulsing_color = LED_COLOR_OFF;
-static uint32_t pulse_time_ms = 0;
-#define PULSE_MS 4000  // Pulse period 
+static ws2812_pixel_t pending_start_color = {0};
+static int32_t pending_start_progress = 0;
+static bool pending_start_ramp = false;      // Follow the ramp once the windback is done
+static ws2812_pixel_t pulsing_color = {0};
+static led_waveform_t pulse_waveform = LED_PULSE_DEFAULT_WAVEFORM;
+static uint32_t pulse_phase = 0;       // Position within the pulse period (2^32 == one period)
+static uint32_t pulse_phase_step = 0;  // Phase advance per frame
+#define LED_FRAME_MS 10  // Frame period while animating
+
+// Smooth transition speed (same as timer), as Q16.16 fractions per frame
+#define TRANSITION_SPEED 1311  // 0.02
+#define INTENSITY_SPEED 3277   // 0.05, slower speed for smooth brightness fades
+
+// Windback is considered complete below this progress (0.01)
+#define WINDBACK_DONE_PROGRESS 655
+
+// Temporal dithering state: fractional output carried per LED channel (G, R, B)
+static uint8_t dither_residue[NUM_LEDS][3] = {0};
+
+// Render cost statistics
+#define LED_STATS_LOG_INTERVAL 1000  // Frames between render cost log lines
+static led_render_stats_t render_stats = {0};
+static led_progress_stats_t progress_stats = {0};
 
-// Smooth transition speed (same as timer)
-#define TRANSITION_SPEED 0.02f
-#define INTENSITY_SPEED 0.05f // Slower speed for smooth brightness fades
+/**
+ * @brief Convert a float in 0.0..1.0 to Q16.16, clamping out-of-range input
+ */
+static int32_t float_to_q16(float value) {
+    if (value <= 0.0f) return 0;
+    if (value >= 1.0f) return Q16_ONE;
+    return (int32_t)(value * Q16_ONE + 0.5f);
+}
 
 /**
- * @brief Get pulsing color with intensity
+ * @brief Move a Q16.16 value towards its target by a fixed fraction
+ * 
+ * Snaps to the target once the step rounds to zero so the value settles.
  * 
- * @param red Red component (0-255)
- * @param green Green component (0-255)
- * @param blue Blue component (0-255)
- * @return 24-bit GRB color value with pulsing brightness
+ * @param current Current value (Q16.16)
+ * @param target Target value (Q16.16)
+ * @param speed Fraction of the remaining distance to cover (Q16.16)
+ * @return New value (Q16.16)
  */
-static uint32_t get_pulsing_color_with_intensity(uint8_t red, uint8_t green, uint8_t blue) {
-    // Calculate the phase of the pulse (0 to 2π) using modulo to wrap around
-    float phase = ((pulse_time_ms % PULSE_MS) / (float)PULSE_MS) * 2 * M_PI;
+static int32_t ease_q16(int32_t current, int32_t target, int32_t speed) {
+    int32_t step = ((target - current) * speed) / Q16_ONE;
+    if (step == 0) {
+        return target;
+    }
+    return current + step;
+}
 
-    // Use a sine wave to create a smooth pulse (range: 0 to 1.0 for full brightness)
-    float pulse_brightness = (sinf(phase) + 1.0f) / 2.0f;  // Range: 0.0 to 1.0
+/**
+ * @brief Progress of the ramp at a point in time (Q16.16, clamped to 0..1.0)
+ */
+static int32_t ramp_progress_q16(int64_t now_us) {
+    int64_t elapsed_us = now_us - ramp_start_us;
+    if (elapsed_us <= 0) return 0;
+    if (elapsed_us >= ramp_duration_us) return Q16_ONE;
+    return (int32_t)((elapsed_us * Q16_ONE) / ramp_duration_us);
+}
 
-    // Apply the pulse brightness to the specified color
-    float r = pulse_brightness * red;
-    float g = pulse_brightness * green;
-    float b = pulse_brightness * blue;
+/**
+ * @brief Convert a packed API color (0x00GGRRBB) to a wire-order pixel
+ */
+static ws2812_pixel_t pixel_from_grb(uint32_t color) {
+    ws2812_pixel_t pixel = {
+        .g = (color >> 16) & 0xFF,
+        .r = (color >> 8) & 0xFF,
+        .b = color & 0xFF,
+    };
+    return pixel;
+}
+
+static bool pixel_equal(ws2812_pixel_t a, ws2812_pixel_t b) {
+    return a.g == b.g && a.r == b.r && a.b == b.b;
+}
 
-    // Convert to GRB format for WS2812 LEDs
-    return ((uint32_t)(g + 0.5f) << 16) | ((uint32_t)(r + 0.5f) << 8) | (uint32_t)(b + 0.5f);
+/**
+ * @brief Map a Q16.16 intensity onto linear luminance
+ * 
+ * Interpolates the generated 256-entry lightness table (CIE L* by default),
+ * so intensity steps are spaced evenly in perceived brightness.
+ * 
+ * @param intensity Intensity (Q16.16, 0 to 1.0)
+ * @return Luminance (Q16.16, 0 to 65535)
+ */
+static uint32_t intensity_to_luminance(int32_t intensity) {
+    uint32_t position = (uint32_t)intensity * (LED_LUT_SIZE - 1);  // Table position (Q16.16)
+    uint32_t index = position >> 16;
+    if (index >= LED_LUT_SIZE - 1) {
+        return led_lut_lightness[LED_LUT_SIZE - 1];
+    }
+    
+    int32_t value = led_lut_lightness[index];
+    int32_t next = led_lut_lightness[index + 1];
+    int32_t frac = (position >> 8) & 0xFF;
+    return (uint32_t)(value + ((next - value) * frac) / 256);
+}
+
+/**
+ * @brief Compute one output channel
+ * 
+ * White balance is applied to the base color, then the luminance. While an
+ * animation runs, the 8 fractional bits left over are carried to the next
+ * frame (temporal dithering), so slow fades at the low end step through
+ * sub-LSB levels instead of jumping between a few coarse ones. Settled
+ * frames are rounded, so they stay identical and are skipped by the driver.
+ * 
+ * @param value Base channel value (0-255)
+ * @param white_balance White balance table for this channel
+ * @param luminance Linear brightness (Q16.16, 0 to 65535)
+ * @param residue Fractional part carried between frames (dithering state)
+ * @param dither true to dither, false to round
+ * @return Output channel value (0-255)
+ */
+static uint8_t output_channel(uint8_t value, const uint8_t *white_balance, uint32_t luminance,
+                              uint8_t *residue, bool dither) {
+    // Q8.8 output level, at most 255 * 65535 >> 8 = 65279
+    uint32_t level = ((uint32_t)white_balance[value] * luminance) >> 8;
+    
+    if (!dither) {
+        *residue = 0;
+        return (uint8_t)((level + 0x80) >> 8);
+    }
+    
+    level += *residue;
+    *residue = level & 0xFF;
+    return (uint8_t)(level >> 8);
+}
+
+/**
+ * @brief Find when the progress ramp next changes a byte of the settled frame
+ * 
+ * Settled frames are rounded, so each output channel is a step function of
+ * the lit length. For every LED and channel this solves for the brightness
+ * at which the output reaches its next value, takes the earliest one and
+ * maps it back through the ramp to a point in time. Between now and then
+ * every frame would be identical to the one just sent.
+ * 
+ * @param luminance Settled luminance of the frame just rendered (Q16.16)
+ * @return Time of the next change (us), or SYSTIME_NEVER
+ */
+static int64_t ramp_next_change_us(uint32_t luminance) {
+    if (luminance == 0) {
+        return SYSTIME_NEVER;
+    }
+    
+    const uint8_t base[3] = { progress_color.g, progress_color.r, progress_color.b };
+    int32_t num_leds_lit = current_progress * NUM_LEDS;
+    int64_t next_lit = INT64_MAX;  // Lit length (Q16.16 LEDs) of the next change
+    
+    for (int i = 0; i < NUM_LEDS; i++) {
+        int32_t led_brightness = num_leds_lit - i * Q16_ONE;
+        if (led_brightness >= Q16_ONE) {
+            continue;  // Fully lit, stays as it is
+        }
+        if (led_brightness < 0) led_brightness = 0;
+        if (i == 0 && led_brightness < Q16_HALF) led_brightness = Q16_HALF;
+        uint32_t led_luminance = (luminance * (uint32_t)led_brightness) >> 16;
+        
+        for (int c = 0; c < 3; c++) {
+            uint32_t white_balanced = led_lut_white_balance[c][base[c]];
+            if (white_balanced == 0) {
+                continue;
+            }
+            uint32_t output = ((white_balanced * led_luminance >> 8) + 0x80) >> 8;
+            if (output >= 255) {
+                continue;
+            }
+            // Luminance, then brightness at which the rounded output goes up by one
+            uint32_t level = (output + 1) * 256 - 0x80;
+            uint32_t min_luminance = (level * 256 + white_balanced - 1) / white_balanced;
+            if (min_luminance > luminance) {
+                continue;
+            }
+            int64_t min_brightness = (((int64_t)min_luminance << 16) + luminance - 1) / luminance;
+            if (min_brightness > Q16_ONE) {
+                continue;
+            }
+            int64_t lit = (int64_t)i * Q16_ONE + min_brightness;
+            if (lit < next_lit) {
+                next_lit = lit;
+            }
+        }
+    }
+    
+    if (next_lit == INT64_MAX) {
+        return SYSTIME_NEVER;
+    }
+    
+    // Smallest progress lighting that length, then the first ramp time reaching it
+    int64_t progress = (next_lit + NUM_LEDS - 1) / NUM_LEDS;
+    return ramp_start_us + (progress * ramp_duration_us + Q16_ONE - 1) / Q16_ONE;
 }
 
 /**
- * @brief Extract RGB components from GRB color
+ * @brief Render one frame into a WS2812 wire buffer
+ * 
+ * Advances all transitions by one frame and writes the output color of
+ * every LED straight into the frame buffer, using integer-only arithmetic.
+ * Must be called with led_mutex held.
+ * 
+ * @param frame Wire buffer of NUM_LEDS pixels to fill
+ * @param now_us Time of the frame, used by the progress ramp
+ * @param next_change_us Set to when a settled scene changes next by itself
+ *                       (progress ramp), or SYSTIME_NEVER
  * 
- * @param grb_color Color in GRB format
- * @param r Pointer to store red component
- * @param g Pointer to store green component
- * @param b Pointer to store blue component
+ * @return true if an animation is still in progress, false once the scene
+ *         has settled and further frames would be identical until
+ *         @p next_change_us
  */
-static void extract_rgb_from_grb(uint32_t grb_color, uint8_t *r, uint8_t *g, uint8_t *b) {
-    *g = (grb_color >> 16) & 0xFF;
-    *r = (grb_color >> 8) & 0xFF;
-    *b = grb_color & 0xFF;
+static bool led_render_frame(ws2812_pixel_t *frame, int64_t now_us, int64_t *next_change_us)
+{
+    // Read pulsing/solid state
+    bool is_pulsing = pulsing_enabled;
+    bool is_solid = solid_mode;
+    ws2812_pixel_t pulse_color = pulsing_color;
+    
+    // Update progress bar with smooth transition (only if not pulsing and not solid)
+    if (!is_pulsing && !is_solid) {
+        if (ramp_active) {
+            // The ramp moves far less than an easing step per frame: follow it exactly
+            target_progress = ramp_progress_q16(now_us);
+            current_progress = target_progress;
+        } else {
+            current_progress = ease_q16(current_progress, target_progress, TRANSITION_SPEED);
+        }
+        
+        // Check if windback is complete and we need to switch to solid mode
+        if (pending_solid_mode && current_progress <= WINDBACK_DONE_PROGRESS) {
+            solid_mode = true;
+            // Apply pending color to all LEDs
+            for (int k = 0; k < NUM_LEDS; k++) {
+                led_colors[k] = pending_solid_color;
+            }
+            pending_solid_mode = false;
+            
+            // Force intensity to 0 so it fades in to the target (e.g. 0.3)
+            current_intensity = 0;
+        }
+        
+        // Check if start transition windback is complete
+        if (pending_start_transition && current_progress <= WINDBACK_DONE_PROGRESS) {
+            progress_color = pending_start_color;
+            target_progress = pending_start_progress;
+            ramp_active = pending_start_ramp;
+            pending_start_transition = false;
+            // Reset current progress to ensure it starts from 0 for the new color
+            current_progress = 0; 
+        }
+    } else if (is_pulsing) {
+        // When pulsing, ensure progress is at 1.0
+        current_progress = Q16_ONE;
+    }
+    
+    // Displayed vs. true progress while a ramp is set (the windback shows none of it)
+    if (!is_pulsing && !is_solid && (ramp_active || (pending_start_transition && pending_start_ramp))) {
+        int32_t error = ramp_progress_q16(now_us) - (ramp_active ? current_progress : 0);
+        if (error < 0) error = -error;
+        progress_stats.frames++;
+        progress_stats.total_error += (uint32_t)error;
+        if ((uint32_t)error > progress_stats.max_error) {
+            progress_stats.max_error = (uint32_t)error;
+        }
+    }
+    
+    // Advance the pulse phase once per loop iteration
+    if (is_pulsing) {
+        pulse_phase += pulse_phase_step;
+    } else {
+        pulse_phase = 0; // Restart the pulse when not pulsing
+    }
+    
+    // Smooth intensity transition
+    current_intensity = ease_q16(current_intensity, target_intensity, INTENSITY_SPEED);
+    
+    // Settled once every transition has reached its target and nothing pulses
+    bool progress_settled = solid_mode || current_progress == target_progress;
+    bool animating = pulsing_enabled || pending_solid_mode || pending_start_transition ||
+                     !progress_settled || current_intensity != target_intensity;
+    
+    // Perceptual brightness correction via the lightness lookup table
+    uint32_t luminance = intensity_to_luminance(current_intensity);
+    
+    // Calculate how many LEDs should be on with smooth transitions (Q16.16)
+    int32_t num_leds_lit = current_progress * NUM_LEDS;
+    
+    // The pulse brightness is the same for every LED
+    if (is_pulsing) {
+        uint32_t pulse_brightness = led_waveform_sample(pulse_waveform, pulse_phase);
+        luminance = (luminance * pulse_brightness) >> 16;
+    }
+    
+    // Apply intensity and write the wire buffer
+    for (int i = 0; i < NUM_LEDS; i++) {
+        ws2812_pixel_t color = led_colors[i];
+        uint32_t led_luminance = luminance;
+        
+        if (is_solid) {
+            // Solid mode: Use the set color directly (do not mask with progress)
+            // Just apply intensity below
+        } else if (is_pulsing) {
+            // If pulsing is enabled, pulse all LEDs regardless of progress
+            color = pulse_color;
+        } else {
+            // Progress bar mode
+            // Brightness for this LED (0.0 to 1.0) is the part of the lit
+            // length that falls on it: fully on, partially on (smooth fade-in) or off
+            int32_t led_brightness = num_leds_lit - i * Q16_ONE;
+            if (led_brightness < 0) led_brightness = 0;
+            if (led_brightness > Q16_ONE) led_brightness = Q16_ONE;
+            
+            // Special case: First LED (i == 0) should turn on to at least 50% immediately when timer starts
+            // Check target_progress to ensure immediate feedback even if current_progress is still 0
+            if (i == 0 && (target_progress > 0 || ramp_active) && led_brightness < Q16_HALF) {
+                led_brightness = Q16_HALF;
+            }
+            
+            // Apply brightness to progress color
+            color = progress_color;
+            led_luminance = (luminance * (uint32_t)led_brightness) >> 16;
+        }
+        
+        // Apply white balance and intensity
+        uint8_t *residue = dither_residue[i];
+        frame[i].g = output_channel(color.g, led_lut_white_balance[0], led_luminance, &residue[0], animating);
+        frame[i].r = output_channel(color.r, led_lut_white_balance[1], led_luminance, &residue[1], animating);
+        frame[i].b = output_channel(color.b, led_lut_white_balance[2], led_luminance, &residue[2], animating);
+    }
+    
+    *next_change_us = SYSTIME_NEVER;
+    if (ramp_active && !animating && !is_pulsing && !is_solid) {
+        *next_change_us = ramp_next_change_us(luminance);
+    }
+    
+    return animating;
+}
+
+/**
+ * @brief Wake the LED task after a scene change
+ */
+static void led_wake_task(void)
+{
+    if (led_task_handle != NULL) {
+        xTaskNotifyGive(led_task_handle);
+    }
 }
 
 /**
  * @brief LED control task
  * 
- * This task continuously updates the WS2812 LEDs with the current state.
+ * This task updates the WS2812 LEDs at 100Hz while an animation is in
+ * progress. Once the scene has settled it blocks until a led_set_* call
+ * changes something and notifies it or, while a progress ramp runs, until
+ * the ramp next changes an output byte. The pixels hold their color in
+ * between, so nothing needs to be refreshed.
  */
 static void led_task(void *pvParameters)
 {
+    int64_t last_frame_us = 0;
+    bool last_frame_paced = false;  // Previous iteration ended with a 10ms delay
+    
     while (1) {
-        // Take mutex to safely read LED state
-        if (led_mutex != NULL && xSemaphoreTake(led_mutex, pdMS_TO_TICKS(20)) == pdTRUE) {
-            // Read pulsing/solid state
-            bool is_pulsing = pulsing_enabled;
-            bool is_solid = solid_mode;
-            uint32_t pulse_color = pulsing_color;
-            
-            // Update progress bar with smooth transition (only if not pulsing and not solid)
-            if (!is_pulsing && !is_solid) {
-                float progress_diff = target_progress - current_progress;
-                current_progress += progress_diff * TRANSITION_SPEED;
-                
-                // Clamp progress
-                if (current_progress < 0.0f) current_progress = 0.0f;
-                if (current_progress > 1.0f) current_progress = 1.0f;
-                
-                // Check if windback is complete and we need to switch to solid mode
-                if (pending_solid_mode && current_progress <= 0.01f) {
-                    solid_mode = true;
-                    // Apply pending color to all LEDs
-                    for (int k = 0; k < NUM_LEDS; k++) {
-                        led_colors[k] = pending_solid_color;
-                    }
-                    pending_solid_mode = false;
-                    
-                    // Force intensity to 0 so it fades in to the target (e.g. 0.3)
-                    current_intensity = 0.0f;
-                }
-                
-                // Check if start transition windback is complete
-                if (pending_start_transition && current_progress <= 0.01f) {
-                    progress_color = pending_start_color;
-                    target_progress = pending_start_progress;
-                    pending_start_transition = false;
-                    // Reset current progress to ensure it starts from 0 for the new color
-                    current_progress = 0.0f; 
-                }
-            } else if (is_pulsing) {
-                // When pulsing, ensure progress is at 1.0
-                current_progress = 1.0f;
+        bool animating = true;
+        int64_t next_change_us = SYSTIME_NEVER;
+        
+        // Frame period statistics only cover back-to-back animated frames
+        int64_t now_us = systime_now_us();
+        if (last_frame_paced) {
+            uint32_t period_us = (uint32_t)(now_us - last_frame_us);
+            render_stats.periods++;
+            render_stats.total_period_us += period_us;
+            if (render_stats.min_period_us == 0 || period_us < render_stats.min_period_us) {
+                render_stats.min_period_us = period_us;
             }
-            
-            // Increment pulse time once per loop iteration
-            if (is_pulsing) {
-                pulse_time_ms += 10;
-            } else {
-                pulse_time_ms = 0; // Reset pulse time when not pulsing
+            if (period_us > render_stats.max_period_us) {
+                render_stats.max_period_us = period_us;
             }
-            
-            // Smooth intensity transition
-            float intensity_diff = target_intensity - current_intensity;
-            if (fabs(intensity_diff) > 0.0001f) {
-                current_intensity += intensity_diff * INTENSITY_SPEED;
-            } else {
-                current_intensity = target_intensity;
+        }
+        last_frame_us = now_us;
+        
+        // Take the strip, unless led_pause() handed it to someone else
+        if (wire_mutex != NULL) {
+            xSemaphoreTake(wire_mutex, portMAX_DELAY);
+        }
+        if (led_paused) {
+            if (wire_mutex != NULL) {
+                xSemaphoreGive(wire_mutex);
             }
+            last_frame_paced = false;
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        
+        // Claim a wire buffer, then take mutex to safely read LED state
+        ws2812_pixel_t *frame = ws2812_begin_frame();
+        if (frame == NULL) {
+            ESP_LOGW(TAG, "No free WS2812 buffer - skipping update");
+        } else if (led_mutex != NULL && xSemaphoreTake(led_mutex, pdMS_TO_TICKS(20)) == pdTRUE) {
+            uint32_t latency_token = latency_frame_begin();
+            uint32_t start_cycles = esp_cpu_get_cycle_count();
+            animating = led_render_frame(frame, now_us, &next_change_us);
+            uint32_t cycles = esp_cpu_get_cycle_count() - start_cycles;
             
-            // Calculate how many LEDs should be on with smooth transitions
-            float num_leds_float = current_progress * NUM_LEDS;
-            
-            // Apply intensity and update LED state
-            for (int i = 0; i < NUM_LEDS; i++) {
-                uint32_t color = led_colors[i];
-                
-                if (is_solid) {
-                    // Solid mode: Use the set color directly (do not mask with progress)
-                    // Just apply intensity below
-                } else if (is_pulsing) {
-                    // If pulsing is enabled, pulse all LEDs regardless of progress
-                    uint8_t r, g, b;
-                    extract_rgb_from_grb(pulse_color, &r, &g, &b);
-                    color = get_pulsing_color_with_intensity(r, g, b);
-                } else {
-                    // Progress bar mode
-                    // Calculate brightness for this LED (0.0 to 1.0) based on progress
-                    float led_brightness = 0.0f;
-                    float led_position = (float)(i + 1);  // Position of this LED (1 to NUM_LEDS)
-                    
-                    if (num_leds_float >= led_position) {
-                        // LED is fully on
-                        led_brightness = 1.0f;
-                    } else if (num_leds_float > (led_position - 1.0f)) {
-                        // LED is partially on (smooth fade-in)
-                        led_brightness = num_leds_float - (led_position - 1.0f);
-                        // Clamp to valid range
-                        if (led_brightness < 0.0f) led_brightness = 0.0f;
-                        if (led_brightness > 1.0f) led_brightness = 1.0f;
-                    } else {
-                        // LED is off
-                        led_brightness = 0.0f;
-                    }
-                    
-                    // Special case: First LED (i == 0) should turn on to at least 50% immediately when timer starts
-                    // Check target_progress to ensure immediate feedback even if current_progress is still 0
-                    if (i == 0 && target_progress > 0.0f && led_brightness < 0.5f) {
-                        led_brightness = 0.5f;
-                    }
-                    
-                    // Apply brightness to progress color
-                    if (led_brightness > 0.0f) {
-                        uint8_t r, g, b;
-                        extract_rgb_from_grb(progress_color, &r, &g, &b);
-                        r = (uint8_t)(r * led_brightness);
-                        g = (uint8_t)(g * led_brightness);
-                        b = (uint8_t)(b * led_brightness);
-                        color = ((uint32_t)g << 16) | ((uint32_t)r << 8) | (uint32_t)b;
-                    } else {
-                        // LED off
-                        color = LED_COLOR_OFF;
-                    }
-                }
-                
-                // Apply intensity (Gamma correction: square the intensity for smoother perceived fade)
-                float gamma_corrected_intensity = current_intensity * current_intensity;
-                color = apply_color_intensity(color, gamma_corrected_intensity);
-                
-                // Store in LED state
-                led_state.leds[i] = color;
+            render_stats.frames++;
+            render_stats.last_cycles = cycles;
+            render_stats.total_cycles += cycles;
+            if (cycles > render_stats.max_cycles) {
+                render_stats.max_cycles = cycles;
             }
             
             xSemaphoreGive(led_mutex);
             
-            // Update WS2812 LEDs
-            ws2812_write_leds(led_state);
+            // Queue the frame on the WS2812 strip; it is transmitted while we sleep
+            ws2812_stats_t tx_stats;
+            ws2812_get_stats(&tx_stats);
+            uint32_t frames_sent = tx_stats.frames_sent;
+            ws2812_end_frame();
+            ws2812_get_stats(&tx_stats);
+            if (tx_stats.frames_sent != frames_sent) {
+                latency_frame_sent(latency_token);
+            }
+            
+            if (render_stats.frames % LED_STATS_LOG_INTERVAL == 0) {
+                ESP_LOGD(TAG, "Render: %" PRIu32 " cycles/frame avg, %" PRIu32 " max over %" PRIu32 " frames; %" PRIu32 " sent, %" PRIu32 " skipped",
+                         (uint32_t)(render_stats.total_cycles / render_stats.frames),
+                         render_stats.max_cycles, render_stats.frames,
+                         tx_stats.frames_sent, tx_stats.frames_skipped);
+                if (progress_stats.frames > 0) {
+                    ESP_LOGD(TAG, "Progress error: %" PRIu32 " avg, %" PRIu32 " max (1/65536 of the bar) over %" PRIu32 " frames",
+                             (uint32_t)(progress_stats.total_error / progress_stats.frames),
+                             progress_stats.max_error, progress_stats.frames);
+                }
+                if (render_stats.periods > 0) {
+                    ESP_LOGD(TAG, "Frame period: %" PRIu32 " us avg, %" PRIu32 "..%" PRIu32 " us (jitter %" PRIu32 " us)",
+                             (uint32_t)(render_stats.total_period_us / render_stats.periods),
+                             render_stats.min_period_us, render_stats.max_period_us,
+                             render_stats.max_period_us - render_stats.min_period_us);
+                }
+            }
         } else {
             ESP_LOGW(TAG, "Failed to take LED mutex - skipping update");
         }
 
-        // Task delay for 20ms (50Hz update rate) - sufficient for smooth animations
-        vTaskDelay(pdMS_TO_TICKS(10));
+        if (!animating) {
+            // Nothing left to animate: let go of the RMT channel so the chip can
+            // light sleep
+            ws2812_idle();
+        }
+        if (wire_mutex != NULL) {
+            xSemaphoreGive(wire_mutex);
+        }
+
+        last_frame_paced = animating;
+        if (animating) {
+            // Task delay for 10ms (100Hz update rate) - sufficient for smooth animations.
+            // Notifications received meanwhile stay pending and are consumed below.
+            vTaskDelay(pdMS_TO_TICKS(LED_FRAME_MS));
+        } else {
+            // Sleep until the scene changes
+            ulTaskNotifyTake(pdTRUE, systime_ticks_until(next_change_us));
+        }
     }
 }
 
@@ -243,23 +536,29 @@ void led_init(void) {
     if (led_mutex == NULL) {
         ESP_LOGE(TAG, "Failed to create LED mutex - system will be unstable");
     }
+    wire_mutex = xSemaphoreCreateMutex();
+    if (wire_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create LED wire mutex - direct frames are unavailable");
+    }
 
     // Initialize LED state
     for (int i = 0; i < NUM_LEDS; i++) {
-        led_colors[i] = LED_COLOR_OFF;
-        led_state.leds[i] = LED_COLOR_OFF;
+        led_colors[i] = pixel_from_grb(LED_COLOR_OFF);
     }
     
-    target_intensity = 1.0f;
-    current_intensity = 1.0f;
-    target_progress = 0.0f;
-    current_progress = 0.0f;
-    progress_color = LED_COLOR_GREEN;
+    target_intensity = Q16_ONE;
+    current_intensity = Q16_ONE;
+    target_progress = 0;
+    current_progress = 0;
+    ramp_active = false;
+    progress_color = pixel_from_grb(LED_COLOR_GREEN);
     pulsing_enabled = false;
-    pulse_time_ms = 0;
+    pulse_waveform = LED_PULSE_DEFAULT_WAVEFORM;
+    pulse_phase = 0;
+    pulse_phase_step = led_waveform_phase_step(LED_PULSE_DEFAULT_PERIOD_MS, LED_FRAME_MS);
 
     // Create LED control task
-    BaseType_t ret = xTaskCreate(led_task, "led_task", 4096, NULL, 10, NULL);
+    BaseType_t ret = xTaskCreate(led_task, "led_task", 4096, NULL, 10, &led_task_handle);
     if (ret != pdPASS) {
         ESP_LOGE(TAG, "Failed to create LED task");
     }
@@ -268,6 +567,9 @@ void led_init(void) {
 }
 
 void led_set_color(uint32_t color) {
+    ws2812_pixel_t pixel = pixel_from_grb(color);
+    bool changed = true;
+    
     if (led_mutex != NULL && xSemaphoreTake(led_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
         // If we are in progress mode, always trigger the windback/fade-in sequence
         // even if progress is 0, to ensure the intensity fade-in happens.
@@ -277,17 +579,21 @@ void led_set_color(uint32_t color) {
                 progress_color = pulsing_color;
             }
             
-            target_progress = 0.0f;
+            target_progress = 0;
+            ramp_active = false;
             pending_solid_mode = true;
-            pending_solid_color = color;
+            pending_solid_color = pixel;
             pulsing_enabled = false;
         } else {
             // Already in solid mode, just update color immediately (no fade reset)
+            changed = false;
             for (int i = 0; i < NUM_LEDS; i++) {
-                led_colors[i] = color;
+                changed |= !pixel_equal(led_colors[i], pixel);
+                led_colors[i] = pixel;
             }
             solid_mode = true;
-            target_progress = 0.0f;
+            target_progress = 0;
+            ramp_active = false;
             pulsing_enabled = false;
             pending_solid_mode = false;
         }
@@ -298,20 +604,26 @@ void led_set_color(uint32_t color) {
             if (pulsing_enabled) {
                 progress_color = pulsing_color;
             }
-            target_progress = 0.0f;
+            target_progress = 0;
+            ramp_active = false;
             pending_solid_mode = true;
-            pending_solid_color = color;
+            pending_solid_color = pixel;
             pulsing_enabled = false;
         } else {
             for (int i = 0; i < NUM_LEDS; i++) {
-                led_colors[i] = color;
+                led_colors[i] = pixel;
             }
             solid_mode = true;
-            target_progress = 0.0f;
+            target_progress = 0;
+            ramp_active = false;
             pulsing_enabled = false;
             pending_solid_mode = false;
         }
     }
+    
+    if (changed) {
+        led_wake_task();
+    }
 }
 
 void led_set_led_color(uint8_t led_index, uint32_t color) {
@@ -319,133 +631,270 @@ void led_set_led_color(uint8_t led_index, uint32_t color) {
         return;
     }
     
+    ws2812_pixel_t pixel = pixel_from_grb(color);
+    bool changed = true;
+    
     if (led_mutex != NULL && xSemaphoreTake(led_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        led_colors[led_index] = color;
+        changed = !solid_mode || pulsing_enabled || !pixel_equal(led_colors[led_index], pixel);
+        led_colors[led_index] = pixel;
         // Enable solid mode
         solid_mode = true;
-        target_progress = 0.0f;
+        target_progress = 0;
+        ramp_active = false;
         pulsing_enabled = false;
         xSemaphoreGive(led_mutex);
     } else if (led_mutex == NULL) {
-        led_colors[led_index] = color;
+        led_colors[led_index] = pixel;
         solid_mode = true;
-        target_progress = 0.0f;
+        target_progress = 0;
+        ramp_active = false;
         pulsing_enabled = false;
     }
+    
+    if (changed) {
+        led_wake_task();
+    }
 }
 
 void led_set_intensity(float intensity) {
     // Clamp intensity to valid range
-    if (intensity < 0.0f) intensity = 0.0f;
-    if (intensity > 1.0f) intensity = 1.0f;
+    int32_t intensity_q16 = float_to_q16(intensity);
+    bool changed = true;
     
     if (led_mutex != NULL && xSemaphoreTake(led_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        target_intensity = intensity;
+        changed = (target_intensity != intensity_q16);
+        target_intensity = intensity_q16;
         xSemaphoreGive(led_mutex);
     } else if (led_mutex == NULL) {
-        target_intensity = intensity;
+        target_intensity = intensity_q16;
+    }
+    
+    if (changed) {
+        led_wake_task();
+    }
+}
+
+/**
+ * @brief Apply a new progress bar target, fixed or ramped
+ * 
+ * Must be called with led_mutex held (or without a mutex).
+ * 
+ * @return true if the scene changed
+ */
+static bool apply_progress(int32_t progress_q16, ws2812_pixel_t pixel, bool ramp,
+                           int64_t start_us, int64_t duration_us) {
+    bool changed = true;
+    
+    if (solid_mode) {
+        // We are transitioning FROM solid mode TO progress mode.
+        // Trigger a windback of the current solid color first.
+        solid_mode = false;
+        current_progress = Q16_ONE; // Start windback from full
+        progress_color = led_colors[0]; // Use the current solid color
+        target_progress = 0; // Target empty
+        ramp_active = false;
+        
+        pending_start_transition = true;
+        pending_start_color = pixel; // The new color (Green)
+        pending_start_progress = progress_q16; // The initial target
+        pending_start_ramp = ramp;
+    } else if (pending_start_transition) {
+        // Update the pending target so we jump to the correct spot when windback finishes
+        pending_start_progress = progress_q16;
+        pending_start_ramp = ramp;
+    } else {
+        // Normal operation
+        changed = ramp_active != ramp || !pixel_equal(progress_color, pixel) ||
+                  pulsing_enabled || pending_solid_mode;
+        if (ramp) {
+            changed |= ramp_start_us != start_us || ramp_duration_us != duration_us;
+        } else {
+            changed |= target_progress != progress_q16;
+            target_progress = progress_q16;
+        }
+        ramp_active = ramp;
+        progress_color = pixel;
     }
+    
+    if (ramp) {
+        ramp_start_us = start_us;
+        ramp_duration_us = duration_us;
+    }
+    pulsing_enabled = false;
+    pending_solid_mode = false; // Cancel any pending solid switch
+    return changed;
 }
 
 void led_set_progress(float progress, uint32_t color) {
     // Clamp progress to valid range
-    if (progress < 0.0f) progress = 0.0f;
-    if (progress > 1.0f) progress = 1.0f;
+    int32_t progress_q16 = float_to_q16(progress);
+    ws2812_pixel_t pixel = pixel_from_grb(color);
+    bool changed = true;
     
     if (led_mutex != NULL && xSemaphoreTake(led_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        if (solid_mode) {
-            // We are transitioning FROM solid mode TO progress mode.
-            // Trigger a windback of the current solid color first.
-            solid_mode = false;
-            current_progress = 1.0f; // Start windback from full
-            progress_color = led_colors[0]; // Use the current solid color
-            target_progress = 0.0f; // Target empty
-            
-            pending_start_transition = true;
-            pending_start_color = color; // The new color (Green)
-            pending_start_progress = progress; // The initial target
-        } else if (pending_start_transition) {
-            // Update the pending target so we jump to the correct spot when windback finishes
-            pending_start_progress = progress;
-        } else {
-            // Normal operation
-            target_progress = progress;
-            progress_color = color;
-        }
-        
-        pulsing_enabled = false;
-        pending_solid_mode = false; // Cancel any pending solid switch
+        changed = apply_progress(progress_q16, pixel, false, 0, 0);
         xSemaphoreGive(led_mutex);
     } else if (led_mutex == NULL) {
-        if (solid_mode) {
-            solid_mode = false;
-            current_progress = 1.0f;
-            progress_color = led_colors[0];
-            target_progress = 0.0f;
-            pending_start_transition = true;
-            pending_start_color = color;
-            pending_start_progress = progress;
-        } else if (pending_start_transition) {
-            pending_start_progress = progress;
-        } else {
-            target_progress = progress;
-            progress_color = color;
-        }
-        pulsing_enabled = false;
-        pending_solid_mode = false;
+        apply_progress(progress_q16, pixel, false, 0, 0);
+    }
+    
+    if (changed) {
+        led_wake_task();
+    }
+}
+
+void led_set_progress_ramp(int64_t start_us, int64_t duration_us, uint32_t color) {
+    if (duration_us <= 0) {
+        led_set_progress(1.0f, color);
+        return;
+    }
+    ws2812_pixel_t pixel = pixel_from_grb(color);
+    bool changed = true;
+    
+    if (led_mutex != NULL && xSemaphoreTake(led_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        changed = apply_progress(0, pixel, true, start_us, duration_us);
+        xSemaphoreGive(led_mutex);
+    } else if (led_mutex == NULL) {
+        apply_progress(0, pixel, true, start_us, duration_us);
+    }
+    
+    if (changed) {
+        led_wake_task();
     }
 }
 
 void led_set_pulsing(uint32_t color, bool enabled) {
+    ws2812_pixel_t pixel = pixel_from_grb(color);
+    bool changed = true;
+    
     if (led_mutex != NULL && xSemaphoreTake(led_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        changed = solid_mode || pulsing_enabled != enabled || !pixel_equal(pulsing_color, pixel);
         pulsing_enabled = enabled;
-        pulsing_color = color;
+        pulsing_color = pixel;
         solid_mode = false;
         if (enabled) {
             // Set progress to full immediately when pulsing (no transition delay)
-            target_progress = 1.0f;
-            current_progress = 1.0f;  // Immediately set to full so all LEDs pulse
+            target_progress = Q16_ONE;
+            ramp_active = false;
+            current_progress = Q16_ONE;  // Immediately set to full so all LEDs pulse
         }
         xSemaphoreGive(led_mutex);
     } else if (led_mutex == NULL) {
         pulsing_enabled = enabled;
-        pulsing_color = color;
+        pulsing_color = pixel;
         solid_mode = false;
         if (enabled) {
-            target_progress = 1.0f;
-            current_progress = 1.0f;  // Immediately set to full so all LEDs pulse
+            target_progress = Q16_ONE;
+            ramp_active = false;
+            current_progress = Q16_ONE;  // Immediately set to full so all LEDs pulse
         }
     }
+    
+    if (changed) {
+        led_wake_task();
+    }
+}
+
+void led_set_pulse_waveform(led_waveform_t waveform, uint32_t period_ms) {
+    if (waveform >= LED_WAVEFORM_COUNT) {
+        waveform = LED_PULSE_DEFAULT_WAVEFORM;
+    }
+    uint32_t phase_step = led_waveform_phase_step(period_ms, LED_FRAME_MS);
+    
+    if (led_mutex != NULL && xSemaphoreTake(led_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        pulse_waveform = waveform;
+        pulse_phase_step = phase_step;
+        xSemaphoreGive(led_mutex);
+    } else if (led_mutex == NULL) {
+        pulse_waveform = waveform;
+        pulse_phase_step = phase_step;
+    }
+    
+    // Only visible while pulsing, which keeps the task awake anyway
 }
 
 void led_clear_all(void) {
     if (led_mutex != NULL && xSemaphoreTake(led_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
         for (int i = 0; i < NUM_LEDS; i++) {
-            led_colors[i] = LED_COLOR_OFF;
+            led_colors[i] = pixel_from_grb(LED_COLOR_OFF);
         }
         solid_mode = true;
-        target_progress = 0.0f;
-        current_progress = 0.0f;
+        target_progress = 0;
+        ramp_active = false;
+        current_progress = 0;
         pulsing_enabled = false;
         xSemaphoreGive(led_mutex);
     } else if (led_mutex == NULL) {
         for (int i = 0; i < NUM_LEDS; i++) {
-            led_colors[i] = LED_COLOR_OFF;
+            led_colors[i] = pixel_from_grb(LED_COLOR_OFF);
         }
         solid_mode = true;
-        target_progress = 0.0f;
-        current_progress = 0.0f;
+        target_progress = 0;
+        ramp_active = false;
+        current_progress = 0;
         pulsing_enabled = false;
     }
+    
+    led_wake_task();
 }
 
 float led_get_intensity(void) {
     float intensity = 0.0f;
     if (led_mutex != NULL && xSemaphoreTake(led_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        intensity = target_intensity;
+        intensity = (float)target_intensity / Q16_ONE;
         xSemaphoreGive(led_mutex);
     } else if (led_mutex == NULL) {
-        intensity = target_intensity;
+        intensity = (float)target_intensity / Q16_ONE;
     }
     return intensity;
 }
+
+void led_pause(bool paused) {
+    led_paused = paused;
+    // A paused task parks once it finishes the frame in progress; a
+    // resumed one renders the scene again
+    led_wake_task();
+}
+
+ws2812_pixel_t *led_begin_direct_frame(void) {
+    if (!led_paused || wire_mutex == NULL) {
+        return NULL;
+    }
+    xSemaphoreTake(wire_mutex, portMAX_DELAY);
+    ws2812_pixel_t *frame = ws2812_begin_frame();
+    if (frame == NULL) {
+        xSemaphoreGive(wire_mutex);
+    }
+    return frame;
+}
+
+void led_end_direct_frame(void) {
+    ws2812_end_frame();
+    xSemaphoreGive(wire_mutex);
+}
+
+void led_get_render_stats(led_render_stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+    
+    if (led_mutex != NULL && xSemaphoreTake(led_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        *stats = render_stats;
+        xSemaphoreGive(led_mutex);
+    } else if (led_mutex == NULL) {
+        *stats = render_stats;
+    }
+}
+
+void led_get_progress_stats(led_progress_stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+    
+    if (led_mutex != NULL && xSemaphoreTake(led_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        *stats = progress_stats;
+        xSemaphoreGive(led_mutex);
+    } else if (led_mutex == NULL) {
+        *stats = progress_stats;
+    }
+}
@@ -18,8 +18,9 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "ws2812_control.h"
+#include "led_waveform.h"
 
-// Predefined LED colors in GRB format (not RGB)
+// Predefined LED colors, packed as 0x00GGRRBB (WS2812 wire order, not RGB)
 #define LED_COLOR_OFF    0x000000  // Black (LEDs off)
 #define LED_COLOR_RED    0x00FF00  // Red
 #define LED_COLOR_GREEN  0xFF0000  // Green
@@ -27,6 +28,39 @@
 #define LED_COLOR_YELLOW 0xFFFF00  // Yellow
 #define LED_COLOR_CYAN   0xFF00FF  // Cyan (Green + Blue)
 
+/**
+ * @brief Render cost statistics
+ * 
+ * Cycle counts cover the frame computation in led_task only (not the
+ * WS2812 transmission). At 10 MHz, 10 cycles == 1 us of the 10 ms frame.
+ * Frame periods are measured between consecutive animated frames; the
+ * gap after the task slept on a settled scene is not counted.
+ */
+typedef struct {
+    uint32_t frames;        // Frames rendered since boot
+    uint32_t last_cycles;   // CPU cycles spent on the most recent frame
+    uint32_t max_cycles;    // Worst-case CPU cycles for a single frame
+    uint64_t total_cycles;  // Sum of CPU cycles over all frames
+    uint32_t periods;          // Back-to-back animated frame periods measured
+    uint32_t min_period_us;    // Shortest frame period (us)
+    uint32_t max_period_us;    // Longest frame period (us); max - min is the jitter
+    uint64_t total_period_us;  // Sum of all measured frame periods (us)
+} led_render_stats_t;
+
+/**
+ * @brief Progress bar accuracy statistics
+ * 
+ * For every frame rendered while a progress ramp is set, the progress the
+ * frame shows is compared with the exact ramp progress at the frame time.
+ * During the windback that precedes a ramp the bar shows no progress yet.
+ * Errors are Q16.16 fractions of the full bar (65536 == 1.0).
+ */
+typedef struct {
+    uint32_t frames;        // Frames compared
+    uint32_t max_error;     // Largest |displayed - true| progress
+    uint64_t total_error;   // Sum of |displayed - true| over all frames
+} led_progress_stats_t;
+
 // LED system initialization and control functions
 /**
  * @brief Initialize the LED control system
@@ -39,7 +73,7 @@ void led_init(void);
 /**
  * @brief Set all LEDs to the same color
  * 
- * @param color Color value in GRB format (0x00RRGGBB)
+ * @param color Color value packed as 0x00GGRRBB
  */
 void led_set_color(uint32_t color);
 
@@ -47,13 +81,16 @@ void led_set_color(uint32_t color);
  * @brief Set individual LED color
  * 
  * @param led_index LED index (0-9)
- * @param color Color value in GRB format
+ * @param color Color value packed as 0x00GGRRBB
  */
 void led_set_led_color(uint8_t led_index, uint32_t color);
 
 /**
  * @brief Set LED intensity (brightness)
  * 
+ * The intensity is a perceived brightness: it is mapped to LED output
+ * through the lightness lookup table (CIE L* unless configured otherwise).
+ * 
  * @param intensity Intensity value (0.0 to 1.0)
  */
 void led_set_intensity(float intensity);
@@ -63,12 +100,27 @@ void led_set_intensity(float intensity);
  * 
  * This function sets the progress bar by lighting up LEDs 1-10
  * based on the progress value (0.0 to 1.0). Uses smooth transitions.
+ * For a timer, led_set_progress_ramp() shows exact progress instead.
  * 
  * @param progress Progress value from 0.0 (no LEDs) to 1.0 (all 10 LEDs)
  * @param color Color for the progress LEDs
  */
 void led_set_progress(float progress, uint32_t color);
 
+/**
+ * @brief Show a progress bar that fills up over time
+ * 
+ * Progress is computed from the time of each frame: 0.0 at @p start_us,
+ * 1.0 at @p start_us + @p duration_us. While the ramp runs, the LED task
+ * only wakes when the next output byte changes, which it computes from
+ * the ramp, so the chip can light sleep in between.
+ * 
+ * @param start_us Start of the ramp (systime_now_us() timebase)
+ * @param duration_us Time to fill the bar
+ * @param color Color for the progress LEDs
+ */
+void led_set_progress_ramp(int64_t start_us, int64_t duration_us, uint32_t color);
+
 /**
  * @brief Set pulsing effect on all LEDs
  * 
@@ -79,6 +131,17 @@ void led_set_progress(float progress, uint32_t color);
  */
 void led_set_pulsing(uint32_t color, bool enabled);
 
+/**
+ * @brief Select the waveform used by the pulsing effect
+ * 
+ * The default preset is a 4 second sine (LED_PULSE_DEFAULT_WAVEFORM,
+ * LED_PULSE_DEFAULT_PERIOD_MS).
+ * 
+ * @param waveform Waveform shape
+ * @param period_ms Pulse period in milliseconds (0 selects the default period)
+ */
+void led_set_pulse_waveform(led_waveform_t waveform, uint32_t period_ms);
+
 /**
  * @brief Clear all LEDs (turn off)
  */
@@ -91,4 +154,46 @@ void led_clear_all(void);
  */
 float led_get_intensity(void);
 
+/**
+ * @brief Pause or resume the LED task's effects
+ * 
+ * While paused, the LED task renders nothing and the strip belongs to
+ * led_begin_direct_frame(). The led_set_* functions still update the
+ * scene, which is shown when the task resumes.
+ * 
+ * @param paused true to pause, false to resume
+ */
+void led_pause(bool paused);
+
+/**
+ * @brief Claim a WS2812 wire buffer while the LED task is paused
+ * 
+ * Every pixel must be written, then led_end_direct_frame() transmits it.
+ * 
+ * @return Buffer of NUM_LEDS pixels in wire order, or NULL if the LED
+ *         task is not paused or no buffer came free
+ */
+ws2812_pixel_t *led_begin_direct_frame(void);
+
+/**
+ * @brief Transmit the frame claimed with led_begin_direct_frame()
+ * 
+ * The RMT channel stays enabled until the LED task resumes and settles.
+ */
+void led_end_direct_frame(void);
+
+/**
+ * @brief Get renderer cost statistics
+ * 
+ * @param stats Pointer to structure to fill with the current statistics
+ */
+void led_get_render_stats(led_render_stats_t *stats);
+
+/**
+ * @brief Get displayed vs. true progress statistics
+ * 
+ * @param stats Pointer to structure to fill with the current statistics
+ */
+void led_get_progress_stats(led_progress_stats_t *stats);
+
 #endif // LED_H
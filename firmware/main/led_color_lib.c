@@ -199,4 +199,32 @@ uint32_t apply_color_intensity(uint32_t color, float intensity) {
     
     // Convert back to GRB format
     return ((uint32_t)(g_scaled + 0.5f) << 16) | ((uint32_t)(r_scaled + 0.5f) << 8) | (uint32_t)(b_scaled + 0.5f);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Apply fixed-point intensity/brightness to a color
+ * 
+ * This function scales all color components by a Q16.16 intensity and
+ * rounds to nearest, matching apply_color_intensity() without any float math.
+ * 
+ * @param color Base color value in GRB format
+ * @param intensity Intensity multiplier in Q16.16 (0 to 65536)
+ * @return 24-bit color value in GRB format with applied intensity
+ */
+uint32_t apply_color_intensity_q16(uint32_t color, uint32_t intensity) {
+    // Clamp intensity to valid range
+    if (intensity > 65536) intensity = 65536;
+    
+    // Extract RGB components from GRB format
+    uint32_t g = (color >> 16) & 0xFF;
+    uint32_t r = (color >> 8) & 0xFF;
+    uint32_t b = color & 0xFF;
+    
+    // Apply intensity with rounding
+    g = (g * intensity + 0x8000) >> 16;
+    r = (r * intensity + 0x8000) >> 16;
+    b = (b * intensity + 0x8000) >> 16;
+    
+    // Convert back to GRB format
+    return (g << 16) | (r << 8) | b;
+}
@@ -94,4 +94,17 @@ uint32_t get_color_green_to_red(uint8_t step);
  */
 uint32_t apply_color_intensity(uint32_t color, float intensity);
 
+/**
+ * @brief Apply fixed-point intensity/brightness to a color
+ * 
+ * Integer-only equivalent of apply_color_intensity(), with the same
+ * rounding. The intensity is a Q16.16 value from 0 (off) to 65536
+ * (full brightness).
+ * 
+ * @param color Base color value in GRB format
+ * @param intensity Intensity value in Q16.16 (0 to 65536)
+ * @return 24-bit GRB color value with applied intensity
+ */
+uint32_t apply_color_intensity_q16(uint32_t color, uint32_t intensity);
+
 #endif // LED_COLOR_LIB_H
@@ -0,0 +1,206 @@
+/**
+ * @file led_stream.c
+ * @brief Live LED frames streamed from a host
+ *
+ * Every frame is decoded into a scratch copy of the strip and only
+ * replaces the stream's copy once all its ops applied, so a malformed
+ * frame never mixes into the frame waiting to be shown or the base for
+ * the next delta. An accepted frame is kept even if it is never shown,
+ * since the next delta builds on it.
+ * Showing a frame copies those NUM_LEDS pixels into a WS2812 wire buffer
+ * and transmits it, without going through the LED task's renderer.
+ *
+ * All functions are called from the serial task.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#include "led_stream.h"
+#include "led.h"
+#include "systime.h"
+#include "esp_log.h"
+#include <inttypes.h>
+#include <string.h>
+
+static const char *TAG = "led_stream";
+
+static bool stream_active = false;
+static ws2812_pixel_t stream_pixels[NUM_LEDS];  // Last accepted strip, base for the next delta
+static bool stream_synced = false;              // stream_pixels hold a valid frame
+static uint8_t stream_next_sequence = 0;
+static bool frame_pending = false;              // Decoded but not shown yet
+static int64_t first_shown_us = 0;
+static int64_t last_shown_us = 0;
+static int64_t last_received_us = 0;
+static led_stream_stats_t stream_stats = {0};
+
+/**
+ * @brief Apply a frame's ops to a strip
+ *
+ * @return false if the ops are malformed; pixels are then partly updated
+ */
+static bool decode_frame(const uint8_t *ops, size_t length, ws2812_pixel_t *pixels)
+{
+    size_t pixel = 0;
+    size_t i = 0;
+    while (i < length) {
+        uint8_t op = ops[i++];
+        size_t count;
+        if ((op & LED_STREAM_OP_LITERAL) == 0) {
+            count = (size_t)op + 1;
+        } else {
+            count = (size_t)(op & LED_STREAM_OP_COUNT_MASK) + 1;
+        }
+        if (count > NUM_LEDS - pixel) {
+            return false;
+        }
+
+        if ((op & LED_STREAM_OP_LITERAL) == 0) {
+            pixel += count;
+        } else if ((op & LED_STREAM_OP_FILL) == LED_STREAM_OP_FILL) {
+            if (length - i < sizeof(ws2812_pixel_t)) {
+                return false;
+            }
+            ws2812_pixel_t color = { .g = ops[i], .r = ops[i + 1], .b = ops[i + 2] };
+            i += sizeof(ws2812_pixel_t);
+            for (size_t end = pixel + count; pixel < end; pixel++) {
+                pixels[pixel] = color;
+            }
+        } else {
+            if (length - i < count * sizeof(ws2812_pixel_t)) {
+                return false;
+            }
+            memcpy(&pixels[pixel], &ops[i], count * sizeof(ws2812_pixel_t));
+            i += count * sizeof(ws2812_pixel_t);
+            pixel += count;
+        }
+    }
+    return true;
+}
+
+_Static_assert(sizeof(ws2812_pixel_t) == 3, "stream pixels are copied as 3 bytes each");
+
+void led_stream_start(void)
+{
+    int64_t now_us = systime_now_us();
+    memset(&stream_stats, 0, sizeof(stream_stats));
+    stream_synced = false;
+    frame_pending = false;
+    last_shown_us = now_us - LED_STREAM_FRAME_MS * SYSTIME_US_PER_MS;
+    last_received_us = now_us;
+    if (!stream_active) {
+        stream_active = true;
+        led_pause(true);
+        ESP_LOGI(TAG, "LED stream started");
+    }
+}
+
+void led_stream_stop(void)
+{
+    if (!stream_active) {
+        return;
+    }
+    stream_active = false;
+    if (frame_pending) {
+        stream_stats.dropped++;
+        frame_pending = false;
+    }
+    led_pause(false);
+
+    led_stream_stats_t stats;
+    led_stream_get_stats(&stats);
+    ESP_LOGI(TAG, "LED stream ended: %" PRIu32 " frames shown at %" PRIu32 ".%02" PRIu32 " fps, %" PRIu32
+             " dropped, %" PRIu32 " rejected", stats.shown, stats.fps_x100 / 100, stats.fps_x100 % 100,
+             stats.dropped, stats.rejected);
+}
+
+bool led_stream_active(void)
+{
+    return stream_active;
+}
+
+bool led_stream_receive(uint8_t sequence, const uint8_t *data, size_t length)
+{
+    if (!stream_active) {
+        return false;
+    }
+    stream_stats.received++;
+    last_received_us = systime_now_us();
+
+    bool keyframe = length > 0 && (data[0] & LED_STREAM_KEYFRAME) != 0;
+    if (length == 0 || (!keyframe && (!stream_synced || sequence != stream_next_sequence))) {
+        stream_stats.rejected++;
+        return false;
+    }
+    ws2812_pixel_t decoded[NUM_LEDS];
+    if (keyframe) {
+        memset(decoded, 0, sizeof(decoded));
+    } else {
+        memcpy(decoded, stream_pixels, sizeof(decoded));
+    }
+    if (!decode_frame(&data[1], length - 1, decoded)) {
+        // The shown and pending frames stay; deltas wait for a keyframe
+        stream_synced = false;
+        stream_stats.rejected++;
+        return false;
+    }
+    memcpy(stream_pixels, decoded, sizeof(stream_pixels));
+    stream_synced = true;
+    stream_next_sequence = (uint8_t)(sequence + 1);
+
+    // Late: the previous frame never got its slot
+    if (frame_pending) {
+        stream_stats.dropped++;
+    }
+    frame_pending = true;
+    return true;
+}
+
+void led_stream_poll(void)
+{
+    if (!stream_active) {
+        return;
+    }
+    int64_t now_us = systime_now_us();
+    if (frame_pending && now_us - last_shown_us >= LED_STREAM_FRAME_MS * SYSTIME_US_PER_MS) {
+        ws2812_pixel_t *frame = led_begin_direct_frame();
+        if (frame != NULL) {
+            memcpy(frame, stream_pixels, sizeof(stream_pixels));
+            led_end_direct_frame();
+            if (stream_stats.shown++ == 0) {
+                first_shown_us = now_us;
+            }
+            last_shown_us = now_us;
+        } else {
+            stream_stats.dropped++;
+        }
+        frame_pending = false;
+    }
+    if (systime_expired(last_received_us + LED_STREAM_TIMEOUT_MS * SYSTIME_US_PER_MS)) {
+        ESP_LOGW(TAG, "No LED frame for %d ms", LED_STREAM_TIMEOUT_MS);
+        led_stream_stop();
+    }
+}
+
+int64_t led_stream_next_deadline_us(void)
+{
+    if (!stream_active) {
+        return SYSTIME_NEVER;
+    }
+    int64_t timeout_us = last_received_us + LED_STREAM_TIMEOUT_MS * SYSTIME_US_PER_MS;
+    if (!frame_pending) {
+        return timeout_us;
+    }
+    return systime_earlier(timeout_us, last_shown_us + LED_STREAM_FRAME_MS * SYSTIME_US_PER_MS);
+}
+
+void led_stream_get_stats(led_stream_stats_t *stats)
+{
+    // Rate between the first and the last frame shown, so the time before
+    // the host started sending or after it stopped does not count
+    *stats = stream_stats;
+    int64_t span_us = last_shown_us - first_shown_us;
+    stats->fps_x100 = stream_stats.shown > 1 && span_us > 0 ?
+        (uint32_t)((stream_stats.shown - 1) * 100 * SYSTIME_US_PER_SEC / span_us) : 0;
+}
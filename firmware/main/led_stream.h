@@ -0,0 +1,122 @@
+/**
+ * @file led_stream.h
+ * @brief Live LED frames streamed from a host
+ *
+ * While a stream runs, the LED task's effects are paused and frames
+ * received over the serial port go straight to the WS2812 strip, at most
+ * one per LED_STREAM_FRAME_MS. A frame that arrives while the previous
+ * one is still waiting for its slot replaces it, so a host that sends
+ * too fast or a burst of delayed frames never builds up a queue: late
+ * frames are dropped and only the newest is shown.
+ *
+ * A frame is a flags byte followed by run-length/delta ops over the
+ * NUM_LEDS pixels, each pixel 3 bytes in wire order (G, R, B):
+ *
+ *   0x00-0x7F   Skip n + 1 pixels, which keep their previous color
+ *   0x80-0xBF   n + 1 literal pixels follow (low 6 bits are n)
+ *   0xC0-0xFF   The next n + 1 pixels all take the one color that follows
+ *
+ * Pixels after the last op keep their color. A keyframe
+ * (LED_STREAM_KEYFRAME) starts from all pixels off; any other frame is a
+ * delta on the previous one and must carry the next sequence number, or
+ * it is rejected until the next keyframe.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#ifndef LED_STREAM_H
+#define LED_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Frame flags
+#define LED_STREAM_KEYFRAME 0x01
+
+// Op codes, with the pixel count - 1 in the low bits
+#define LED_STREAM_OP_SKIP 0x00
+#define LED_STREAM_OP_LITERAL 0x80
+#define LED_STREAM_OP_FILL 0xC0
+#define LED_STREAM_OP_COUNT_MASK 0x3F
+
+// Shortest time between two frames shown (100 fps)
+#define LED_STREAM_FRAME_MS 10
+
+// A stream without a frame for this long ends and the effects resume
+#define LED_STREAM_TIMEOUT_MS 2000
+
+// Stream statistics, since the stream started
+typedef struct {
+    uint32_t received;      // Frames received
+    uint32_t shown;         // Frames sent to the LEDs
+    uint32_t dropped;       // Frames replaced by a newer one before they were shown
+    uint32_t rejected;      // Malformed frames and deltas without their base
+    uint32_t fps_x100;      // Frames shown per second between the first and last, times 100
+} led_stream_stats_t;
+
+/**
+ * @brief Start a stream
+ *
+ * Pauses the LED effects; the strip keeps what it shows until the first
+ * frame. Restarting a running stream clears its statistics.
+ */
+void led_stream_start(void);
+
+/**
+ * @brief End the stream and resume the LED effects
+ */
+void led_stream_stop(void);
+
+/**
+ * @brief Check if a stream is running
+ *
+ * @return true between led_stream_start() and the end of the stream
+ */
+bool led_stream_active(void);
+
+/**
+ * @brief Decode a received frame
+ *
+ * The frame is shown by the next led_stream_poll() that finds its slot
+ * due, unless a newer frame replaces it first.
+ *
+ * @param sequence Frame sequence number
+ * @param data Flags byte and ops
+ * @param length Number of bytes
+ * @return true if the frame was accepted
+ */
+bool led_stream_receive(uint8_t sequence, const uint8_t *data, size_t length);
+
+/**
+ * @brief Show the pending frame if its slot is due, end an idle stream
+ *
+ * Call after the received input has been processed and whenever
+ * led_stream_next_deadline_us() passes.
+ */
+void led_stream_poll(void);
+
+/**
+ * @brief Get when led_stream_poll() next has something to do
+ *
+ * @return Deadline (systime_now_us() timebase), or SYSTIME_NEVER
+ */
+int64_t led_stream_next_deadline_us(void);
+
+/**
+ * @brief Get the statistics of the current or last stream
+ *
+ * @param stats Filled with the counts
+ */
+void led_stream_get_stats(led_stream_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LED_STREAM_H
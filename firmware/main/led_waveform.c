@@ -0,0 +1,94 @@
+/**
+ * @file led_waveform.c
+ * @brief Table-driven brightness waveforms for LED effects
+ * 
+ * This file implements waveform evaluation on top of the lookup tables
+ * generated by tools/gen_led_tables.py, plus a benchmark comparing the
+ * table path with the sinf() path it replaces.
+ * 
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#include "led_waveform.h"
+#include "led_tables.h"
+#include "ws2812_control.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include <math.h>
+#include <inttypes.h>
+
+static const char *TAG = "led_waveform";
+
+_Static_assert(LED_WAVEFORM_COUNT == LED_WAVE_COUNT, "led_waveform_t does not match generated tables");
+_Static_assert(LED_WAVEFORM_SINE == LED_WAVE_INDEX_SINE, "sine table index mismatch");
+_Static_assert(LED_WAVEFORM_TRIANGLE == LED_WAVE_INDEX_TRIANGLE, "triangle table index mismatch");
+_Static_assert(LED_WAVEFORM_BREATHE == LED_WAVE_INDEX_BREATHE, "breathe table index mismatch");
+_Static_assert(LED_WAVEFORM_SQUARE == LED_WAVE_INDEX_SQUARE, "square table index mismatch");
+
+// Phase bits below the table index used for linear interpolation
+#define WAVE_FRAC_BITS 8
+#define WAVE_INDEX_SHIFT (32 - LED_WAVE_TABLE_BITS)
+
+// Number of frames timed by the benchmark
+#define BENCHMARK_FRAMES 400
+
+uint32_t led_waveform_phase_step(uint32_t period_ms, uint32_t frame_ms)
+{
+    if (period_ms == 0) {
+        period_ms = LED_PULSE_DEFAULT_PERIOD_MS;
+    }
+    return (uint32_t)(((uint64_t)frame_ms << 32) / period_ms);
+}
+
+uint32_t led_waveform_sample(led_waveform_t waveform, uint32_t phase)
+{
+    if (waveform >= LED_WAVEFORM_COUNT) {
+        waveform = LED_PULSE_DEFAULT_WAVEFORM;
+    }
+
+    const uint16_t *table = led_wave_tables[waveform];
+    uint32_t index = phase >> WAVE_INDEX_SHIFT;
+    int32_t value = table[index];
+
+    // Interpolate between table entries, except across the square wave's edges
+    if (waveform != LED_WAVEFORM_SQUARE) {
+        int32_t next = table[(index + 1) & (LED_WAVE_TABLE_SIZE - 1)];
+        int32_t frac = (phase >> (WAVE_INDEX_SHIFT - WAVE_FRAC_BITS)) & ((1 << WAVE_FRAC_BITS) - 1);
+        value += ((next - value) * frac) / (1 << WAVE_FRAC_BITS);
+    }
+
+    return (uint32_t)value;
+}
+
+void led_waveform_benchmark(void)
+{
+    volatile uint32_t sink = 0;
+    const uint32_t frame_ms = 10;
+
+    // Previous path: phase from elapsed milliseconds and one sinf() per LED
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (uint32_t frame = 0; frame < BENCHMARK_FRAMES; frame++) {
+        uint32_t time_ms = frame * frame_ms;
+        for (int led = 0; led < NUM_LEDS; led++) {
+            float phase = ((time_ms % LED_PULSE_DEFAULT_PERIOD_MS) / (float)LED_PULSE_DEFAULT_PERIOD_MS) * 2 * M_PI;
+            float brightness = (sinf(phase) + 1.0f) / 2.0f;
+            sink = (uint32_t)(brightness * 255 + 0.5f);
+        }
+    }
+    uint32_t sinf_cycles = esp_cpu_get_cycle_count() - start;
+
+    // Table path: phase accumulator and one lookup per frame
+    uint32_t phase = 0;
+    uint32_t step = led_waveform_phase_step(LED_PULSE_DEFAULT_PERIOD_MS, frame_ms);
+    start = esp_cpu_get_cycle_count();
+    for (uint32_t frame = 0; frame < BENCHMARK_FRAMES; frame++) {
+        phase += step;
+        sink = led_waveform_sample(LED_PULSE_DEFAULT_WAVEFORM, phase);
+    }
+    uint32_t table_cycles = esp_cpu_get_cycle_count() - start;
+    (void)sink;
+
+    ESP_LOGI(TAG, "Pulse brightness per frame: sinf %" PRIu32 " cycles, table %" PRIu32 " cycles",
+             sinf_cycles / BENCHMARK_FRAMES, table_cycles / BENCHMARK_FRAMES);
+}
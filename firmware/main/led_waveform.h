@@ -0,0 +1,69 @@
+/**
+ * @file led_waveform.h
+ * @brief Table-driven brightness waveforms for LED effects
+ * 
+ * This header file defines the interface for the pulse waveform generator.
+ * Waveforms are one-period lookup tables generated at build time and kept
+ * in flash. They are evaluated with a 32-bit phase accumulator, so an
+ * effect costs one table lookup per frame and no floating point math.
+ * 
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#ifndef LED_WAVEFORM_H
+#define LED_WAVEFORM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Waveform shapes (order matches the generated tables)
+typedef enum {
+    LED_WAVEFORM_SINE = 0,     // Smooth sine pulse
+    LED_WAVEFORM_TRIANGLE,     // Linear ramp up and down
+    LED_WAVEFORM_BREATHE,      // Exponential "breathing" pulse, lingers near dark
+    LED_WAVEFORM_SQUARE,       // Hard on/off blink
+    LED_WAVEFORM_COUNT
+} led_waveform_t;
+
+// Default pulse effect preset
+#define LED_PULSE_DEFAULT_WAVEFORM  LED_WAVEFORM_SINE
+#define LED_PULSE_DEFAULT_PERIOD_MS 4000
+
+/**
+ * @brief Compute the phase increment for a waveform period
+ * 
+ * The phase is a 32-bit fraction of one period (2^32 == one full period).
+ * 
+ * @param period_ms Waveform period in milliseconds (0 selects the default)
+ * @param frame_ms Time between two evaluations in milliseconds
+ * @return Phase increment per frame
+ */
+uint32_t led_waveform_phase_step(uint32_t period_ms, uint32_t frame_ms);
+
+/**
+ * @brief Sample a waveform
+ * 
+ * @param waveform Waveform shape
+ * @param phase Phase as a 32-bit fraction of one period
+ * @return Brightness in Q16.16 (0 = off, 65535 = full brightness)
+ */
+uint32_t led_waveform_sample(led_waveform_t waveform, uint32_t phase);
+
+/**
+ * @brief Benchmark the table path against per-LED sinf()
+ * 
+ * Times a pulse frame computed the way the renderer used to (one sinf()
+ * per LED) and the table path (one lookup per frame) and logs the cycle
+ * counts for both.
+ */
+void led_waveform_benchmark(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LED_WAVEFORM_H
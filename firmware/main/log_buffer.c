@@ -0,0 +1,102 @@
+/**
+ * @file log_buffer.c
+ * @brief Recent log output kept in RAM for export over the serial port
+ *
+ * The log is hooked with esp_log_set_vprintf(): each line is formatted
+ * once into a stack buffer, copied into the ring and then handed to the
+ * previous output function as "%s", so no task formats a line twice or
+ * needs stack for a second printf-style formatting.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#include "log_buffer.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+_Static_assert((LOG_BUFFER_SIZE & (LOG_BUFFER_SIZE - 1)) == 0, "ring size must be a power of two");
+
+static portMUX_TYPE log_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t log_ring[LOG_BUFFER_SIZE];
+static uint32_t log_written = 0;        // Bytes logged since boot; wraps after 4 GiB
+static vprintf_like_t log_next = NULL;
+
+/**
+ * @brief Hand already formatted text to the previous output function
+ */
+static int log_forward(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int length = log_next(format, args);
+    va_end(args);
+    return length;
+}
+
+/**
+ * @brief Log output hook: format the line, keep it, then print it
+ */
+static int log_vprintf(const char *format, va_list args)
+{
+    char line[LOG_BUFFER_LINE_MAX];
+    int length = vsnprintf(line, sizeof(line), format, args);
+    if (length <= 0) {
+        return length;
+    }
+
+    size_t kept = length < (int)sizeof(line) ? (size_t)length : sizeof(line) - 1;
+    if (kept < (size_t)length) {
+        // Cut short; keep the line break, so the next line starts on its own
+        size_t format_length = strlen(format);
+        if (format_length > 0 && format[format_length - 1] == '\n') {
+            line[kept - 1] = '\n';
+        }
+    }
+    portENTER_CRITICAL(&log_lock);
+    size_t start = log_written & (LOG_BUFFER_SIZE - 1);
+    size_t first = kept < LOG_BUFFER_SIZE - start ? kept : LOG_BUFFER_SIZE - start;
+    memcpy(&log_ring[start], line, first);
+    memcpy(log_ring, &line[first], kept - first);
+    log_written += kept;
+    portEXIT_CRITICAL(&log_lock);
+    return log_forward("%s", line);
+}
+
+void log_buffer_init(void)
+{
+    if (log_next == NULL) {
+        log_next = esp_log_set_vprintf(log_vprintf);
+    }
+}
+
+size_t log_buffer_read(uint32_t *position, uint8_t *out, size_t max_length)
+{
+    portENTER_CRITICAL(&log_lock);
+    uint32_t oldest = log_written > LOG_BUFFER_SIZE ? log_written - LOG_BUFFER_SIZE : 0;
+    // Unsigned distances, so the positions may wrap
+    if (log_written - *position > log_written - oldest) {
+        *position = oldest;
+    }
+    size_t length = log_written - *position;
+    if (length > max_length) {
+        length = max_length;
+    }
+    size_t start = *position & (LOG_BUFFER_SIZE - 1);
+    size_t first = length < LOG_BUFFER_SIZE - start ? length : LOG_BUFFER_SIZE - start;
+    memcpy(out, &log_ring[start], first);
+    memcpy(&out[first], log_ring, length - first);
+    portEXIT_CRITICAL(&log_lock);
+    return length;
+}
+
+uint32_t log_buffer_end(void)
+{
+    portENTER_CRITICAL(&log_lock);
+    uint32_t end = log_written;
+    portEXIT_CRITICAL(&log_lock);
+    return end;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file log_buffer.h
+ * @brief Recent log output kept in RAM for export over the serial port
+ *
+ * Every line logged with ESP_LOGx is copied into a ring buffer as well as
+ * printed, so a host can read the log back in bulk without having been
+ * connected when it was written. Positions count bytes logged since boot;
+ * once the ring wraps, the oldest text is overwritten.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#ifndef LOG_BUFFER_H
+#define LOG_BUFFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Size of the ring, the most recent text that can be exported
+#define LOG_BUFFER_SIZE 4096
+
+// Longest line logged, terminator included; longer lines are cut to
+// LOG_BUFFER_LINE_MAX - 1 bytes, ending in their line break, in the ring
+// and on the console alike, since both get the one formatted copy
+#define LOG_BUFFER_LINE_MAX 128
+
+/**
+ * @brief Start copying the log into the ring
+ *
+ * Call first thing in app_main(), so the boot messages are kept.
+ */
+void log_buffer_init(void);
+
+/**
+ * @brief Read logged text
+ *
+ * @param position Position to read from; on return, the position of the
+ *                 first byte read, which is later than requested if that
+ *                 text was already overwritten
+ * @param out Text read, not NUL terminated
+ * @param max_length Size of out
+ * @return Number of bytes read; 0 once position reaches log_buffer_end()
+ */
+size_t log_buffer_read(uint32_t *position, uint8_t *out, size_t max_length);
+
+/**
+ * @brief Get the position after the last byte logged
+ *
+ * @return Bytes logged since boot
+ */
+uint32_t log_buffer_end(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_BUFFER_H
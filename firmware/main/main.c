@@ -6,16 +6,31 @@
 #include "led.h"
 #include "button.h"
 #include "timer.h"
+#include "journal.h"
+#include "latency.h"
+#include "log_buffer.h"
+#include "serial_protocol.h"
+#include "telemetry.h"
 #include "piezo.h"
+#include "systime.h"
+#include "sdkconfig.h"
 
 static const char *TAG = "main";
 static TaskHandle_t main_task_handle = NULL;
+static esp_pm_lock_handle_t main_pm_lock = NULL;  // Held while the main loop is working
 
 // Button event callback
-static void button_event_handler(uint8_t button_id, button_press_type_t press_type)
+static void button_event_handler(const button_event_t *event)
 {
-    bool is_long_press = (press_type == BUTTON_PRESS_LONG);
-    timer_handle_button(button_id, is_long_press);
+    // A retraction is timed as part of the double tap that follows it
+    bool timed = event->type != BUTTON_PRESS_RETRACT;
+    if (timed) {
+        latency_press(event->event_us);
+    }
+    timer_handle_button(event->button_id, event->type);
+    if (timed) {
+        latency_handled();
+    }
     
     // Notify main task to update immediately
     if (main_task_handle != NULL) {
@@ -23,18 +38,67 @@ static void button_event_handler(uint8_t button_id, button_press_type_t press_ty
     }
 }
 
+// Serial command callback: a command started or stopped the timer
+static void serial_timer_handler(void)
+{
+    if (main_task_handle != NULL) {
+        xTaskNotifyGive(main_task_handle);
+    }
+}
+
+/**
+ * @brief Show a timer state on the LEDs
+ */
+static void show_timer_state(timer_state_t state)
+{
+    switch (state) {
+        case TIMER_STATE_IDLE:
+            // All LEDs light blue (Cyan) at 30% brightness
+            led_set_intensity(0.3f);
+            led_set_color(LED_COLOR_CYAN);
+            break;
+            
+        case TIMER_STATE_RUNNING: {
+            // Show progress bar at full brightness; the LED task advances it
+            led_set_intensity(1.0f);
+            int64_t start_us, duration_us;
+            if (timer_get_run(&start_us, &duration_us)) {
+                led_set_progress_ramp(start_us, duration_us, LED_COLOR_GREEN);
+            }
+            break;
+        }
+        
+        case TIMER_STATE_COMPLETED:
+        case TIMER_STATE_GRACE_PERIOD:
+            // Pulse LEDs to notify completion (full brightness)
+            led_set_intensity(1.0f);
+            led_set_pulse_waveform(LED_PULSE_DEFAULT_WAVEFORM, 0);
+            led_set_pulsing(LED_COLOR_GREEN, true);
+            break;
+            
+        case TIMER_STATE_ALERTING:
+            led_set_intensity(1.0f);
+            led_set_pulse_waveform(LED_PULSE_DEFAULT_WAVEFORM, 0);
+            led_set_pulsing(LED_COLOR_RED, true);
+            break;
+    }
+}
+
 void app_main(void)
 {
     // Capture main task handle first
     main_task_handle = xTaskGetCurrentTaskHandle();
 
+    // Keep the log from the first line on, for export over the serial port
+    log_buffer_init();
+
     ESP_LOGI(TAG, "Pomodoro Timer Starting");
 
     // Configure power management
     esp_pm_config_esp32c2_t pm_config = {
         .max_freq_mhz = 10,
         .min_freq_mhz = 10,
-        .light_sleep_enable = false
+        .light_sleep_enable = true   // Tickless idle sleeps whenever no task has work
     };
     
     esp_err_t ret = esp_pm_configure(&pm_config);
@@ -43,6 +107,12 @@ void app_main(void)
     } else {
         ESP_LOGI(TAG, "Power management configured");
     }
+    
+    ret = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "main_loop", &main_pm_lock);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to create main loop PM lock: %s", esp_err_to_name(ret));
+        main_pm_lock = NULL;
+    }
 
     // Initialize NVS (Non-Volatile Storage)
     ret = nvs_flash_init();
@@ -56,13 +126,31 @@ void app_main(void)
     // Initialize LED system
     led_init();
     ESP_LOGI(TAG, "LED system initialized");
+
+    // Pick up a session interrupted by a reset before anything slow runs,
+    // so it is back on the LEDs right away
+    timer_init();
+    journal_init();
+    bool resumed = journal_restore();
+    if (resumed) {
+        show_timer_state(timer_get_state());
+        ESP_LOGI(TAG, "Session resumed");
+    }
+
+#if CONFIG_FOCUSBAR_RUN_BENCHMARKS
+    led_waveform_benchmark();
+    button_gesture_benchmark();
+    telemetry_benchmark();
+#endif
     
     // Initialize piezo buzzer
     if (piezo_init() != 0) {
         ESP_LOGE(TAG, "Failed to initialize piezo");
     } else {
         ESP_LOGI(TAG, "Piezo initialized");
-        piezo_play_startup_jingle();
+        if (!resumed) {
+            piezo_play_startup_jingle(NULL);
+        }
     }
     
     // Initialize button system
@@ -70,22 +158,25 @@ void app_main(void)
     button_register_callback(button_event_handler);
     ESP_LOGI(TAG, "Button system initialized");
     
-    // Initialize timer system
-    timer_init();
-    ESP_LOGI(TAG, "Timer system initialized");
+    // Serial commands, e.g. the input latency report, and binary frames
+    serial_protocol_init();
+    serial_register_timer_callback(serial_timer_handler);
     
-    // Clear all LEDs initially
-    led_clear_all();
+    if (!resumed) {
+        // Clear all LEDs initially
+        led_clear_all();
+    }
     
     ESP_LOGI(TAG, "Pomodoro Timer Ready");
 
     // Main loop
-    timer_state_t last_state = TIMER_STATE_IDLE;
+    timer_state_t last_state = timer_get_state();
+    uint32_t alert_sequence = 0;    // Jingle this loop started for the alert, 0 if none
     
     while (1) {
-        // Wait for notification or timeout (100ms)
-        // This allows immediate response to button events while maintaining periodic updates
-        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+        if (main_pm_lock != NULL) {
+            esp_pm_lock_acquire(main_pm_lock);
+        }
         
         // Update timer
         timer_update();
@@ -100,65 +191,35 @@ void app_main(void)
             last_state = current_state;
         }
         
+        // Journal transitions so a reset can resume the session
+        journal_record();
+        
         // Handle timer states
-        switch (current_state) {
-            case TIMER_STATE_IDLE:
-                // All LEDs light blue (Cyan) at 30% brightness
-                led_set_intensity(0.3f);
-                led_set_color(LED_COLOR_CYAN);
-                
-                if (piezo_is_playing()) {
-                    piezo_stop();
-                }
-                break;
-                
-            case TIMER_STATE_RUNNING: {
-                // Show progress bar at full brightness
-                led_set_intensity(1.0f);
-                float progress = timer_get_progress();
-                led_set_progress(progress, LED_COLOR_GREEN);
-                if (piezo_is_playing()) {
-                    piezo_stop();
-                }
-                break;
-            }
-            
-            case TIMER_STATE_COMPLETED:
-                // Pulse LEDs to notify completion (full brightness)
-                led_set_intensity(1.0f);
-                led_set_pulsing(LED_COLOR_GREEN, true);
-                if (piezo_is_playing()) {
-                    piezo_stop();
-                }
-                break;
-                
-            case TIMER_STATE_GRACE_PERIOD:
-                // Keep pulsing during grace period
-                led_set_intensity(1.0f);
-                led_set_pulsing(LED_COLOR_GREEN, true);
-                if (piezo_is_playing()) {
-                    piezo_stop();
-                }
-                break;
-                
-            case TIMER_STATE_ALERTING: {
-                // Pulse LEDs
-                led_set_intensity(1.0f);
-                led_set_pulsing(LED_COLOR_RED, true);
-                
-                // Play jingle every 2 seconds
-                static TickType_t last_jingle_time = 0;
-                TickType_t now = xTaskGetTickCount();
-                
-                // Play jingle immediately if first time or 2 seconds passed
-                if (last_jingle_time == 0 || (now - last_jingle_time > pdMS_TO_TICKS(2000))) {
-                    if (!piezo_is_playing()) {
-                        piezo_play_startup_jingle();
-                        last_jingle_time = xTaskGetTickCount(); // Update time after playing (it blocks)
-                    }
+        show_timer_state(current_state);
+        latency_applied();
+        
+        if (current_state == TIMER_STATE_ALERTING) {
+            // Play jingle when the alert starts and then ALERT_JINGLE_INTERVAL_MS
+            // after each one ends; it plays in the background
+            if (timer_alert_jingle_due()) {
+                if (!piezo_is_playing()) {
+                    piezo_play_startup_jingle(&alert_sequence);
                 }
-                break;
+                timer_alert_jingle_played(piezo_get_end_us());
             }
+        } else if (alert_sequence != 0) {
+            // Cut the alert short, but not whatever replaced it since (the
+            // startup jingle, a tone or tune from the serial port)
+            piezo_stop_sequence(alert_sequence);
+            alert_sequence = 0;
         }
+        
+        if (main_pm_lock != NULL) {
+            esp_pm_lock_release(main_pm_lock);
+        }
+        
+        // Sleep until the timer's next deadline or a button event, whichever
+        // comes first. In idle there is no deadline at all.
+        ulTaskNotifyTake(pdTRUE, systime_ticks_until(timer_get_next_deadline_us()));
     }
 }
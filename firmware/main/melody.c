@@ -0,0 +1,124 @@
+/**
+ * @file melody.c
+ * @brief Melodies stored in NVS
+ *
+ * This file keeps extra melodies in NVS, one blob of packed notes per
+ * slot. A stored melody is read into a RAM buffer that the sequencer
+ * plays from, so playing it takes no parsing.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#include "melody.h"
+#include "piezo.h"
+#include "nvs.h"
+#include "esp_log.h"
+#include <stdio.h>
+
+static const char *TAG = "melody";
+
+#define MELODY_NAMESPACE    "melodies"
+
+// The stored melody being played; piezo_stop() comes before it is reused
+static uint16_t playing_notes[MELODY_MAX_NOTES];
+
+/**
+ * @brief NVS key of a slot
+ */
+static void slot_key(uint8_t slot, char key[8])
+{
+    snprintf(key, 8, "tune%u", slot);
+}
+
+/**
+ * @brief Check packed notes: every duration must be non-zero
+ */
+static bool notes_valid(const uint16_t *notes, size_t count)
+{
+    if (count == 0 || count > MELODY_MAX_NOTES) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (melody_note_duration_ms(notes[i]) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool melody_store(uint8_t slot, const uint16_t *notes, size_t count)
+{
+    if (slot >= MELODY_SLOTS || !notes_valid(notes, count)) {
+        ESP_LOGE(TAG, "Invalid melody for slot %u", slot);
+        return false;
+    }
+    
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(MELODY_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret == ESP_OK) {
+        char key[8];
+        slot_key(slot, key);
+        ret = nvs_set_blob(handle, key, notes, count * sizeof(notes[0]));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to store melody %u: %s", slot, esp_err_to_name(ret));
+        return false;
+    }
+    ESP_LOGI(TAG, "Stored melody %u (%u notes)", slot, (unsigned)count);
+    return true;
+}
+
+bool melody_erase(uint8_t slot)
+{
+    if (slot >= MELODY_SLOTS) {
+        return false;
+    }
+    
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(MELODY_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret == ESP_OK) {
+        char key[8];
+        slot_key(slot, key);
+        ret = nvs_erase_key(handle, key);
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    return ret == ESP_OK || ret == ESP_ERR_NVS_NOT_FOUND;
+}
+
+bool melody_play_stored(uint8_t slot)
+{
+    if (slot >= MELODY_SLOTS) {
+        return false;
+    }
+    
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(MELODY_NAMESPACE, NVS_READONLY, &handle);
+    if (ret != ESP_OK) {
+        return false;
+    }
+    
+    // The sequencer may still be reading the buffer
+    piezo_stop();
+    
+    char key[8];
+    slot_key(slot, key);
+    size_t length = sizeof(playing_notes);
+    ret = nvs_get_blob(handle, key, playing_notes, &length);
+    nvs_close(handle);
+    size_t count = length / sizeof(playing_notes[0]);
+    if (ret != ESP_OK || length % sizeof(playing_notes[0]) != 0 || !notes_valid(playing_notes, count)) {
+        ESP_LOGW(TAG, "No melody in slot %u", slot);
+        return false;
+    }
+    
+    melody_t melody = { playing_notes, (uint16_t)count };
+    return piezo_play_melody(&melody) == 0;
+}
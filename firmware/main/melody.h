@@ -0,0 +1,89 @@
+/**
+ * @file melody.h
+ * @brief Packed melody format and the melodies stored in NVS
+ *
+ * This header file defines the packed note format the piezo sequencer
+ * plays. Every note is one 16-bit word, so a melody is a plain array
+ * that is played as is: the built-in melodies are compiled into flash
+ * from melodies.rtttl by tools/gen_melodies.py (see melody_tables.h),
+ * and extra melodies are kept in NVS in the same format.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#ifndef MELODY_H
+#define MELODY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Packed note: pitch in the top MELODY_PITCH_BITS, duration in the rest
+#define MELODY_PITCH_BITS       6
+#define MELODY_DURATION_BITS    10
+#define MELODY_DURATION_UNIT_MS 5
+#define MELODY_PITCHES          (1 << MELODY_PITCH_BITS)
+#define MELODY_MIDI_BASE        56      // Pitch p is MIDI note MELODY_MIDI_BASE + p; 0 is a rest
+
+// Melodies stored in NVS
+#define MELODY_SLOTS            4
+#define MELODY_MAX_NOTES        64
+
+typedef struct {
+    const uint16_t *notes;      // Packed notes
+    uint16_t count;
+} melody_t;
+
+/**
+ * @brief Pitch index of a packed note (0 for a rest)
+ */
+static inline uint32_t melody_note_pitch(uint16_t note)
+{
+    return note >> MELODY_DURATION_BITS;
+}
+
+/**
+ * @brief Duration of a packed note in milliseconds
+ */
+static inline uint32_t melody_note_duration_ms(uint16_t note)
+{
+    return (note & ((1u << MELODY_DURATION_BITS) - 1)) * MELODY_DURATION_UNIT_MS;
+}
+
+/**
+ * @brief Store a melody in NVS
+ *
+ * @param slot Slot number, below MELODY_SLOTS
+ * @param notes Packed notes, e.g. from gen_melodies.py --hex
+ * @param count Number of notes, 1 to MELODY_MAX_NOTES
+ * @return true on success
+ */
+bool melody_store(uint8_t slot, const uint16_t *notes, size_t count);
+
+/**
+ * @brief Remove a melody from NVS
+ *
+ * @return true if the slot is empty now
+ */
+bool melody_erase(uint8_t slot);
+
+/**
+ * @brief Play a melody stored in NVS
+ *
+ * Reads the slot into RAM and hands it to the sequencer, replacing
+ * whatever is playing.
+ *
+ * @return true if the slot held a melody
+ */
+bool melody_play_stored(uint8_t slot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MELODY_H
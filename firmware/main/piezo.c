@@ -3,8 +3,18 @@
  * @brief Piezo buzzer driver implementation
  * 
  * This file implements the piezo buzzer driver using PWM to generate
- * tones on GPIO 22. It provides easy-to-use functions for generating
- * different sounds and melodies.
+ * tones on GPIO 22. Melodies are played by a sequencer: notes wait in a
+ * queue, so playing a melody returns immediately and no task is created
+ * per note. Packed melodies (see melody.h) are played straight from
+ * their flash or RAM table, ahead of the queue.
+ * 
+ * Each tone is shaped by an envelope that the LEDC fade engine runs in
+ * hardware: a short attack up to the volume's peak duty, a decay to the
+ * sustain level and a release back to 0 that ends exactly at the end of
+ * the note. The fade-complete interrupt hands over to the esp_timer task,
+ * which starts the next phase or note (the LEDC fade functions may not be
+ * called from an ISR); a rest is ended by the same esp_timer one-shot.
+ * That is one wakeup per phase and none while a fade runs.
  * 
  * @author StuckAtPrototype, LLC
  * @version 1.0
@@ -12,9 +22,14 @@
 
 #include "piezo.h"
 #include "driver/ledc.h"
+#include "esp_attr.h"
 #include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_timer.h"
+#include "systime.h"
+#include "melody_tables.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include <stdbool.h>
 
 static const char *TAG = "piezo";
@@ -25,41 +40,309 @@ static const char *TAG = "piezo";
 #define PIEZO_LEDC_MODE LEDC_LOW_SPEED_MODE
 #define PIEZO_LEDC_CHANNEL LEDC_CHANNEL_0
 
-// Note frequencies
-#define NOTE_C6 1047
-#define NOTE_E6 1319
-#define NOTE_G6 1568
-#define NOTE_C7 2093
-#define NOTE_D7 2349
-#define NOTE_E7 2637
-#define NOTE_G7 3136
-#define NOTE_C8 4186
+// 10-bit duty; 512 is a 50% square wave, the loudest a piezo gets
+#define PIEZO_DUTY_RESOLUTION LEDC_TIMER_10_BIT
+
+// Envelope; attack and release take at most a quarter of the note each
+#define PIEZO_ATTACK_MS 5
+#define PIEZO_RELEASE_MS 20
+#define PIEZO_STOP_MS 5                 // Release when a tone is cut short
+#define PIEZO_SUSTAIN_NUM 3             // Sustain level is 3/4 of the peak
+#define PIEZO_SUSTAIN_DEN 4
+
+// Notes waiting behind the one that is playing
+#define PIEZO_QUEUE_LEN 16
+
+// Envelope phase of the current note
+typedef enum {
+    PHASE_IDLE,         // Silent, nothing playing
+    PHASE_ATTACK,       // Fading up to the peak
+    PHASE_DECAY,        // Fading down to the sustain level
+    PHASE_HOLD,         // Continuous tone at the peak until piezo_stop()
+    PHASE_RELEASE,      // Fading out, ends with the note
+    PHASE_REST,         // Silent until the note timer ends the rest
+    PHASE_STOP,         // Fading out after piezo_stop(), nothing playing
+} piezo_phase_t;
+
+// Peak duty per volume level
+static const uint32_t volume_peak_duty[PIEZO_VOLUME_COUNT] = {
+    [PIEZO_VOLUME_LOW] = 48,        // About -17 dB
+    [PIEZO_VOLUME_MEDIUM] = 160,    // About -6 dB
+    [PIEZO_VOLUME_HIGH] = 512,
+};
 
 // Static variables
 static bool piezo_initialized = false;
-static bool piezo_playing = false;
-static TaskHandle_t piezo_task_handle = NULL;
+static volatile bool piezo_playing = false;    // A note or rest of a sequence is in progress
+static esp_timer_handle_t note_timer = NULL;    // Ends a rest, runs the next phase after a fade
+static SemaphoreHandle_t piezo_mutex = NULL;    // Guards the sequencer and LEDC
+static piezo_note_t note_queue[PIEZO_QUEUE_LEN];
+static size_t queue_head = 0;
+static size_t queue_count = 0;
+static melody_t melody = {0};                   // Packed melody ahead of the queue
+static uint32_t sequence_id = 0;                // Counts the sequences started
+static uint16_t melody_index = 0;
+static int64_t note_end_us = 0;                 // SYSTIME_NEVER for a continuous tone
+static piezo_phase_t phase = PHASE_IDLE;
+static int64_t phase_end_us = 0;                // Planned end of the current phase
+static int64_t attack_end_us = 0;
+static int64_t release_start_us = 0;
+static volatile bool fade_ended = false;        // Set by the fade-complete interrupt
+static piezo_volume_t volume = PIEZO_VOLUME_HIGH;
+static esp_pm_lock_handle_t piezo_pm_lock = NULL;  // Keeps LEDC running while a tone plays
+static bool piezo_pm_lock_held = false;
 
 /**
- * @brief Piezo task for timed tone playback
+ * @brief Hold or release the lock that keeps the chip out of light sleep
  * 
- * This task handles playing tones for a specific duration.
+ * LEDC stops in light sleep, so the lock is held exactly while a tone
+ * is sounding.
  */
-static void piezo_task(void *pvParameters)
+static void piezo_keep_awake(bool awake)
 {
-    uint32_t duration_ms = (uint32_t)pvParameters;
-    
-    // Wait for the specified duration
-    vTaskDelay(pdMS_TO_TICKS(duration_ms));
-    
-    // Stop the tone
+    if (piezo_pm_lock == NULL || awake == piezo_pm_lock_held) {
+        return;
+    }
+    if (awake) {
+        esp_pm_lock_acquire(piezo_pm_lock);
+    } else {
+        esp_pm_lock_release(piezo_pm_lock);
+    }
+    piezo_pm_lock_held = awake;
+}
+
+/**
+ * @brief Cut the output to 0 and end any fade
+ */
+static void piezo_silence(void)
+{
+    ledc_fade_stop(PIEZO_LEDC_MODE, PIEZO_LEDC_CHANNEL);
     ledc_set_duty(PIEZO_LEDC_MODE, PIEZO_LEDC_CHANNEL, 0);
     ledc_update_duty(PIEZO_LEDC_MODE, PIEZO_LEDC_CHANNEL);
-    
+    piezo_keep_awake(false);
+}
+
+/**
+ * @brief Fade the output to a duty by the given time
+ * 
+ * The fade time is taken from the planned end of the phase rather than
+ * the phase's nominal length, so the latency of handing over from the
+ * fade interrupt never adds up over a melody.
+ * 
+ * @return true if a fade was started, false if the end has already been
+ *         reached (the duty is set at once then)
+ */
+static bool envelope_fade(uint32_t duty, int64_t end_us)
+{
+    fade_ended = false;
+    int64_t fade_ms = (end_us - systime_now_us() + SYSTIME_US_PER_MS / 2) / SYSTIME_US_PER_MS;
+    if (fade_ms <= 0 || ledc_set_fade_with_time(PIEZO_LEDC_MODE, PIEZO_LEDC_CHANNEL, duty, (int)fade_ms) != ESP_OK ||
+        ledc_fade_start(PIEZO_LEDC_MODE, PIEZO_LEDC_CHANNEL, LEDC_FADE_NO_WAIT) != ESP_OK) {
+        ledc_fade_stop(PIEZO_LEDC_MODE, PIEZO_LEDC_CHANNEL);
+        ledc_set_duty(PIEZO_LEDC_MODE, PIEZO_LEDC_CHANNEL, duty);
+        ledc_update_duty(PIEZO_LEDC_MODE, PIEZO_LEDC_CHANNEL);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Drop the queue and the current note; caller holds piezo_mutex
+ * 
+ * The output is left where it is: the next note's attack fades up from
+ * there, or piezo_stop() fades it out.
+ */
+static void sequencer_clear(void)
+{
+    esp_timer_stop(note_timer);     // ESP_ERR_INVALID_STATE if it is not armed
+    ledc_fade_stop(PIEZO_LEDC_MODE, PIEZO_LEDC_CHANNEL);
+    fade_ended = false;
+    melody.count = 0;
+    melody_index = 0;
+    queue_head = 0;
+    queue_count = 0;
+    phase = PHASE_IDLE;
     piezo_playing = false;
-    piezo_task_handle = NULL;
+}
+
+/**
+ * @brief Start the next queued note, or end the sequence; caller holds piezo_mutex
+ * 
+ * @return true if the note is under way, false if it was over at once
+ *         and the next one should follow
+ */
+static bool sequencer_start_note(void)
+{
+    piezo_note_t note;
+    if (melody_index < melody.count) {
+        // Unpacking is a shift and a table lookup
+        uint16_t packed = melody.notes[melody_index++];
+        note.frequency_hz = melody_pitch_hz[melody_note_pitch(packed)];
+        note.duration_ms = melody_note_duration_ms(packed);
+    } else if (queue_count > 0) {
+        note = note_queue[queue_head];
+        queue_head = (queue_head + 1) % PIEZO_QUEUE_LEN;
+        queue_count--;
+    } else {
+        piezo_silence();
+        phase = PHASE_IDLE;
+        piezo_playing = false;
+        return true;
+    }
+    piezo_playing = true;
     
-    vTaskDelete(NULL);
+    int64_t start_us = systime_now_us();
+    note_end_us = note.duration_ms != 0 ? start_us + note.duration_ms * SYSTIME_US_PER_MS : SYSTIME_NEVER;
+    
+    if (note.frequency_hz != 0) {
+        esp_err_t ret = ledc_set_freq(PIEZO_LEDC_MODE, PIEZO_LEDC_TIMER, note.frequency_hz);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to set frequency: %s", esp_err_to_name(ret));
+            piezo_silence();
+            phase = PHASE_REST;
+        } else {
+            uint32_t attack_ms = PIEZO_ATTACK_MS;
+            uint32_t release_ms = PIEZO_RELEASE_MS;
+            if (note.duration_ms != 0) {
+                attack_ms = attack_ms < note.duration_ms / 4u ? attack_ms : note.duration_ms / 4u;
+                release_ms = release_ms < note.duration_ms / 4u ? release_ms : note.duration_ms / 4u;
+            }
+            attack_end_us = start_us + attack_ms * SYSTIME_US_PER_MS;
+            release_start_us = note_end_us - release_ms * SYSTIME_US_PER_MS;
+            piezo_keep_awake(true);
+            phase = PHASE_ATTACK;
+            phase_end_us = attack_end_us;
+            return envelope_fade(volume_peak_duty[volume], phase_end_us);
+        }
+    } else {
+        piezo_silence();
+        phase = PHASE_REST;
+    }
+    
+    // Rest
+    if (note_end_us == SYSTIME_NEVER) {
+        return true;            // Silent until piezo_stop()
+    }
+    phase_end_us = note_end_us;
+    return esp_timer_start_once(note_timer, (uint64_t)note.duration_ms * SYSTIME_US_PER_MS) == ESP_OK;
+}
+
+/**
+ * @brief Move on from a finished phase; caller holds piezo_mutex
+ * 
+ * Phases that are over as soon as they start (a note too short for a
+ * decay, say) are passed through in the same call.
+ */
+static void sequencer_advance(void)
+{
+    uint32_t peak = volume_peak_duty[volume];
+    bool started = false;
+    while (!started) {
+        switch (phase) {
+        case PHASE_ATTACK:
+            if (note_end_us == SYSTIME_NEVER) {
+                phase = PHASE_HOLD;
+                started = true;
+            } else {
+                phase = PHASE_DECAY;
+                phase_end_us = release_start_us;
+                started = envelope_fade(peak * PIEZO_SUSTAIN_NUM / PIEZO_SUSTAIN_DEN, phase_end_us);
+            }
+            break;
+        case PHASE_DECAY:
+            phase = PHASE_RELEASE;
+            phase_end_us = note_end_us;
+            started = envelope_fade(0, phase_end_us);
+            break;
+        case PHASE_STOP:
+            piezo_keep_awake(false);
+            phase = PHASE_IDLE;
+            started = true;
+            break;
+        case PHASE_IDLE:
+        case PHASE_HOLD:
+            started = true;
+            break;
+        case PHASE_RELEASE:
+        case PHASE_REST:
+        default:
+            started = sequencer_start_note();
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Start playing after the queue was filled; caller holds piezo_mutex
+ */
+static void sequencer_start(void)
+{
+    sequence_id = sequence_id + 1 != 0 ? sequence_id + 1 : 1;
+    if (!sequencer_start_note()) {
+        sequencer_advance();
+    }
+}
+
+/**
+ * @brief LEDC fade-complete interrupt
+ * 
+ * Runs in ISR context, where the fade functions may not be called, so
+ * the next phase is left to the esp_timer task.
+ */
+static bool IRAM_ATTR fade_end_callback(const ledc_cb_param_t *param, void *user_arg)
+{
+    if (param->event == LEDC_FADE_END_EVT) {
+        fade_ended = true;
+        esp_timer_start_once(note_timer, 0);
+    }
+    return false;
+}
+
+/**
+ * @brief esp_timer callback at the end of a rest or fade
+ * 
+ * Runs in the esp_timer task. A callback that lost the race with a stop
+ * or a newer note finds the current phase not yet over and does nothing.
+ */
+static void note_timer_callback(void *arg)
+{
+    xSemaphoreTake(piezo_mutex, portMAX_DELAY);
+    bool done = phase == PHASE_REST ? systime_expired(phase_end_us) : fade_ended;
+    if (done && phase != PHASE_IDLE && phase != PHASE_HOLD) {
+        fade_ended = false;
+        sequencer_advance();
+    }
+    xSemaphoreGive(piezo_mutex);
+}
+
+/**
+ * @brief Queue notes, optionally replacing whatever is playing
+ */
+static int sequencer_submit(const piezo_note_t *notes, size_t count, bool replace)
+{
+    if (!piezo_initialized) {
+        ESP_LOGE(TAG, "Piezo not initialized");
+        return -1;
+    }
+    
+    xSemaphoreTake(piezo_mutex, portMAX_DELAY);
+    if (replace) {
+        sequencer_clear();
+    }
+    if (count > PIEZO_QUEUE_LEN - queue_count) {
+        xSemaphoreGive(piezo_mutex);
+        ESP_LOGW(TAG, "Note queue full, %u notes dropped", (unsigned)count);
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        note_queue[(queue_head + queue_count) % PIEZO_QUEUE_LEN] = notes[i];
+        queue_count++;
+    }
+    if (!piezo_playing) {
+        sequencer_start();
+    }
+    xSemaphoreGive(piezo_mutex);
+    return 0;
 }
 
 int piezo_init(void)
@@ -73,7 +356,7 @@ int piezo_init(void)
     ledc_timer_config_t ledc_timer = {
         .speed_mode = PIEZO_LEDC_MODE,
         .timer_num = PIEZO_LEDC_TIMER,
-        .duty_resolution = LEDC_TIMER_8_BIT,  // 8-bit resolution (0-255)
+        .duty_resolution = PIEZO_DUTY_RESOLUTION,
         .freq_hz = 1000,  // Default frequency, will be changed per tone
         .clk_cfg = LEDC_AUTO_CLK,
     };
@@ -99,6 +382,43 @@ int piezo_init(void)
         return -1;
     }
 
+    // The fade engine runs the envelopes and reports the end of each fade
+    ret = ledc_fade_func_install(0);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to install LEDC fade: %s", esp_err_to_name(ret));
+        return -1;
+    }
+    ledc_cbs_t fade_callbacks = {
+        .fade_cb = fade_end_callback,
+    };
+    ret = ledc_cb_register(PIEZO_LEDC_MODE, PIEZO_LEDC_CHANNEL, &fade_callbacks, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register LEDC fade callback: %s", esp_err_to_name(ret));
+        return -1;
+    }
+
+    piezo_mutex = xSemaphoreCreateMutex();
+    if (piezo_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create piezo mutex");
+        return -1;
+    }
+
+    esp_timer_create_args_t timer_args = {
+        .callback = note_timer_callback,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "piezo_note",
+    };
+    ret = esp_timer_create(&timer_args, &note_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create note timer: %s", esp_err_to_name(ret));
+        return -1;
+    }
+
+    if (esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "piezo", &piezo_pm_lock) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to create PM lock, tones may stop in light sleep");
+        piezo_pm_lock = NULL;
+    }
+
     piezo_initialized = true;
     piezo_playing = false;
     ESP_LOGI(TAG, "Piezo initialized on GPIO %d", PIEZO_GPIO);
@@ -106,67 +426,105 @@ int piezo_init(void)
 }
 
 int piezo_play_tone(uint32_t frequency, uint32_t duration_ms)
+{
+    piezo_note_t note = { .frequency_hz = frequency, .duration_ms = duration_ms };
+    return sequencer_submit(&note, 1, true);
+}
+
+int piezo_play_notes(const piezo_note_t *notes, size_t count)
+{
+    return sequencer_submit(notes, count, true);
+}
+
+/**
+ * @brief Play a melody and report which sequence it is
+ * 
+ * @param sequence Set to the sequence's id, or NULL
+ */
+static int play_melody(const melody_t *new_melody, uint32_t *sequence)
 {
     if (!piezo_initialized) {
         ESP_LOGE(TAG, "Piezo not initialized");
         return -1;
     }
-
-    // Stop any currently playing tone
-    piezo_stop();
-
-    // Update timer frequency
-    esp_err_t ret = ledc_set_freq(PIEZO_LEDC_MODE, PIEZO_LEDC_TIMER, frequency);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to set frequency: %s", esp_err_to_name(ret));
-        return -1;
+    
+    xSemaphoreTake(piezo_mutex, portMAX_DELAY);
+    sequencer_clear();
+    melody = *new_melody;
+    sequencer_start();
+    if (sequence != NULL) {
+        *sequence = sequence_id;
     }
+    xSemaphoreGive(piezo_mutex);
+    return 0;
+}
 
-    // Set duty cycle to 50% for clean tone (128 out of 255)
-    ledc_set_duty(PIEZO_LEDC_MODE, PIEZO_LEDC_CHANNEL, 128);
-    ledc_update_duty(PIEZO_LEDC_MODE, PIEZO_LEDC_CHANNEL);
+int piezo_play_melody(const melody_t *new_melody)
+{
+    return play_melody(new_melody, NULL);
+}
 
-    piezo_playing = true;
+int piezo_queue_notes(const piezo_note_t *notes, size_t count)
+{
+    return sequencer_submit(notes, count, false);
+}
 
-    // If duration is specified, create a task to stop after duration
-    if (duration_ms > 0) {
-        // Delete any existing task
-        if (piezo_task_handle != NULL) {
-            vTaskDelete(piezo_task_handle);
-            piezo_task_handle = NULL;
+/**
+ * @brief Stop whatever is playing; caller holds piezo_mutex
+ */
+static void stop_locked(void)
+{
+    bool sounding = phase != PHASE_IDLE && phase != PHASE_REST;
+    sequencer_clear();
+    if (sounding) {
+        // A short release instead of a click; the PM lock goes when it ends
+        phase = PHASE_STOP;
+        if (!envelope_fade(0, systime_deadline_ms(PIEZO_STOP_MS))) {
+            sequencer_advance();
         }
+    } else {
+        piezo_silence();
+    }
+}
 
-        // Create task to stop after duration
-        BaseType_t task_ret = xTaskCreate(piezo_task, "piezo_task", 2048, 
-                                         (void*)(uintptr_t)duration_ms, 5, &piezo_task_handle);
-        if (task_ret != pdPASS) {
-            ESP_LOGE(TAG, "Failed to create piezo task");
-            piezo_stop();
-            return -1;
-        }
+int piezo_stop(void)
+{
+    if (!piezo_initialized) {
+        return 0;  // Not initialized, nothing to stop
     }
 
+    xSemaphoreTake(piezo_mutex, portMAX_DELAY);
+    stop_locked();
+    xSemaphoreGive(piezo_mutex);
     return 0;
 }
 
-int piezo_stop(void)
+int piezo_stop_sequence(uint32_t sequence)
 {
     if (!piezo_initialized) {
-        return 0;  // Not initialized, nothing to stop
+        return 0;
     }
 
-    // Delete the task if it exists
-    if (piezo_task_handle != NULL) {
-        vTaskDelete(piezo_task_handle);
-        piezo_task_handle = NULL;
+    xSemaphoreTake(piezo_mutex, portMAX_DELAY);
+    if (piezo_playing && sequence_id == sequence) {
+        stop_locked();
     }
+    xSemaphoreGive(piezo_mutex);
+    return 0;
+}
 
-    // Set duty to 0 to stop the tone
-    ledc_set_duty(PIEZO_LEDC_MODE, PIEZO_LEDC_CHANNEL, 0);
-    ledc_update_duty(PIEZO_LEDC_MODE, PIEZO_LEDC_CHANNEL);
+void piezo_set_volume(piezo_volume_t level)
+{
+    if (level >= PIEZO_VOLUME_COUNT) {
+        return;
+    }
+    // Takes effect from the next phase on
+    volume = level;
+}
 
-    piezo_playing = false;
-    return 0;
+piezo_volume_t piezo_get_volume(void)
+{
+    return volume;
 }
 
 bool piezo_is_playing(void)
@@ -174,39 +532,40 @@ bool piezo_is_playing(void)
     return piezo_playing;
 }
 
+int64_t piezo_get_end_us(void)
+{
+    if (!piezo_initialized) {
+        return systime_now_us();
+    }
+    
+    xSemaphoreTake(piezo_mutex, portMAX_DELAY);
+    int64_t end_us = piezo_playing ? note_end_us : systime_now_us();
+    for (uint16_t i = melody_index; i < melody.count && end_us != SYSTIME_NEVER; i++) {
+        end_us += melody_note_duration_ms(melody.notes[i]) * SYSTIME_US_PER_MS;
+    }
+    for (size_t i = 0; i < queue_count && end_us != SYSTIME_NEVER; i++) {
+        const piezo_note_t *note = &note_queue[(queue_head + i) % PIEZO_QUEUE_LEN];
+        end_us = note->duration_ms != 0 ? end_us + note->duration_ms * SYSTIME_US_PER_MS : SYSTIME_NEVER;
+    }
+    xSemaphoreGive(piezo_mutex);
+    return end_us;
+}
+
 int piezo_play_notification(void)
 {
-    // Play a pleasant two-tone notification: A4 (440Hz) then A5 (880Hz)
-    piezo_play_tone(440, 200);
-    vTaskDelay(pdMS_TO_TICKS(250));
-    piezo_play_tone(880, 300);
-    return 0;
+    // A4 then A5
+    return piezo_play_melody(&melody_notification);
 }
 
 int piezo_play_alert(void)
 {
-    // Play a more urgent alert sound: repeated beeps at safe high frequency
-    for (int i = 0; i < 3; i++) {
-        piezo_play_tone(2093, 200); // C7 (2093 Hz) - known to be audible
-        vTaskDelay(pdMS_TO_TICKS(200));
-    }
-    return 0;
+    // Three C7 beeps
+    return piezo_play_melody(&melody_alert);
 }
 
-int piezo_play_startup_jingle(void)
+int piezo_play_startup_jingle(uint32_t *sequence)
 {
     ESP_LOGI(TAG, "Playing startup jingle");
-    // Reverting to C6-C7 range which was confirmed audible
-    uint32_t notes[] = {NOTE_C6, NOTE_E6, NOTE_G6, NOTE_C7}; 
-    uint32_t durations[] = {100, 100, 100, 300};
-    
-    for (int i = 0; i < 4; i++) {
-        int ret = piezo_play_tone(notes[i], durations[i]);
-        if (ret != 0) {
-            ESP_LOGE(TAG, "Failed to play note %d", i);
-        }
-        vTaskDelay(pdMS_TO_TICKS(durations[i] + 50)); // Wait for note duration + small gap
-    }
-    
-    return 0;
+    // C6 E6 G6 C7 with a small gap after each note
+    return play_melody(&melody_startup, sequence);
 }
@@ -4,6 +4,10 @@
  * 
  * This header file defines the interface for controlling a piezo buzzer
  * on GPIO 22. It provides functions for generating tones and melodies.
+ * Every call returns immediately: notes are played in the background by
+ * a sequencer, and all functions are safe to call from any task. Tones
+ * are shaped by attack, decay and release envelopes run by the LEDC fade
+ * hardware, at one of a few volume levels.
  * 
  * @author StuckAtPrototype, LLC
  * @version 1.0
@@ -14,11 +18,27 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include "melody.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Volume levels
+typedef enum {
+    PIEZO_VOLUME_LOW = 0,
+    PIEZO_VOLUME_MEDIUM,
+    PIEZO_VOLUME_HIGH,          // Default
+    PIEZO_VOLUME_COUNT,
+} piezo_volume_t;
+
+// One note of a melody
+typedef struct {
+    uint16_t frequency_hz;      // 0 for a rest
+    uint16_t duration_ms;       // 0 to hold until piezo_stop() (last note only)
+} piezo_note_t;
+
 /**
  * @brief Initialize piezo buzzer driver
  * 
@@ -32,8 +52,9 @@ int piezo_init(void);
 /**
  * @brief Play a tone on the piezo buzzer
  * 
- * This function plays a tone at the specified frequency for the given duration.
- * If duration is 0, the tone will play continuously until stopped.
+ * This function plays a tone at the specified frequency for the given duration,
+ * replacing whatever is playing. If duration is 0, the tone will play
+ * continuously until stopped.
  * 
  * @param frequency Frequency in Hz (e.g., 440 for A4, 880 for A5)
  * @param duration_ms Duration in milliseconds (0 = continuous)
@@ -41,22 +62,94 @@ int piezo_init(void);
  */
 int piezo_play_tone(uint32_t frequency, uint32_t duration_ms);
 
+/**
+ * @brief Play a sequence of notes, replacing whatever is playing
+ * 
+ * @param notes Notes to play; copied, so the array may be temporary
+ * @param count Number of notes, at most 16
+ * @return 0 on success, -1 if not initialized or too many notes
+ */
+int piezo_play_notes(const piezo_note_t *notes, size_t count);
+
+/**
+ * @brief Play a packed melody, replacing whatever is playing
+ * 
+ * The notes are read from the melody's table while they play, so it must
+ * stay valid until the melody ends or piezo_stop() returns; the built-in
+ * melodies live in flash. Notes queued with piezo_queue_notes() afterwards
+ * play when the melody ends.
+ * 
+ * @param melody Melody to play
+ * @return 0 on success, -1 if not initialized
+ */
+int piezo_play_melody(const melody_t *melody);
+
+/**
+ * @brief Append notes to the sequence that is playing
+ * 
+ * Starts them right away if nothing is playing.
+ * 
+ * @param notes Notes to play; copied, so the array may be temporary
+ * @param count Number of notes
+ * @return 0 on success, -1 if not initialized or the queue has no room
+ *         for all of them (none are queued then)
+ */
+int piezo_queue_notes(const piezo_note_t *notes, size_t count);
+
 /**
  * @brief Stop the piezo buzzer
  * 
- * This function immediately stops any currently playing tone.
+ * This function immediately stops any currently playing tone and drops
+ * the queued notes. A sounding tone is faded out over 5 ms rather than
+ * cut, to avoid a click.
  * 
  * @return 0 on success, negative error code on failure
  */
 int piezo_stop(void);
 
+/**
+ * @brief Stop a sequence, unless another one has replaced it
+ * 
+ * Lets the code that started a sound end it without cutting off one
+ * that was started since, e.g. over the serial port.
+ * 
+ * @param sequence Id from the call that started it
+ * @return 0 on success, negative error code on failure
+ */
+int piezo_stop_sequence(uint32_t sequence);
+
+/**
+ * @brief Set the volume
+ * 
+ * Takes effect from the next envelope phase, so a note that is playing
+ * may finish at the old level.
+ * 
+ * @param level Volume level
+ */
+void piezo_set_volume(piezo_volume_t level);
+
+/**
+ * @brief Get the volume
+ * 
+ * @return Current volume level
+ */
+piezo_volume_t piezo_get_volume(void);
+
 /**
  * @brief Check if piezo is currently playing
  * 
- * @return true if piezo is playing, false otherwise
+ * @return true while a sequence is in progress, rests included
  */
 bool piezo_is_playing(void);
 
+/**
+ * @brief Get when the queued notes will have finished playing
+ * 
+ * @return End time (systime_now_us() timebase), the current time if
+ *         nothing is playing, or SYSTIME_NEVER for a continuous tone
+ */
+int64_t piezo_get_end_us(void);
+
 /**
  * @brief Play a notification sound (timer completion)
  * 
@@ -80,9 +173,11 @@ int piezo_play_alert(void);
  * 
  * Plays a short, pleasant sequence of notes to indicate device startup.
  * 
+ * @param sequence Set to the id of the sequence, for piezo_stop_sequence();
+ *                 may be NULL
  * @return 0 on success, negative error code on failure
  */
-int piezo_play_startup_jingle(void);
+int piezo_play_startup_jingle(uint32_t *sequence);
 
 #ifdef __cplusplus
 }
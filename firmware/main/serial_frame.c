@@ -0,0 +1,100 @@
+/**
+ * @file serial_frame.c
+ * @brief Binary frame encoding for the serial protocol
+ *
+ * COBS replaces each 0x00 with the distance to the next one: the data is
+ * split at its zeros and every block is prefixed with its length + 1. A
+ * block of 254 non-zero bytes is written with code 0xFF and no implied
+ * zero. The CRC goes little-endian after the payload, inside the COBS
+ * encoding.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#include "serial_frame.h"
+
+// CRC-16/CCITT-FALSE, one table entry per nibble: 32 bytes of flash and
+// two lookups per byte, which suits frames of a few dozen bytes
+static const uint16_t crc16_nibble_table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+uint16_t serial_frame_crc16(const uint8_t *data, size_t length)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc = (uint16_t)(crc << 4) ^ crc16_nibble_table[(crc >> 12) ^ (data[i] >> 4)];
+        crc = (uint16_t)(crc << 4) ^ crc16_nibble_table[(crc >> 12) ^ (data[i] & 0x0F)];
+    }
+    return crc;
+}
+
+size_t serial_frame_cobs_encode(const uint8_t *data, size_t length, uint8_t *out)
+{
+    size_t code_index = 0;      // Where the current block's length goes
+    size_t out_index = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] != 0) {
+            out[out_index++] = data[i];
+            code++;
+        }
+        if (data[i] == 0 || code == 0xFF) {
+            out[code_index] = code;
+            code_index = out_index++;
+            code = 1;
+        }
+    }
+    out[code_index] = code;
+    return out_index;
+}
+
+size_t serial_frame_cobs_decode(uint8_t *data, size_t length)
+{
+    size_t in_index = 0;
+    size_t out_index = 0;
+    while (in_index < length) {
+        uint8_t code = data[in_index++];
+        if (code == 0 || in_index + code - 1 > length) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            uint8_t byte = data[in_index++];
+            if (byte == 0) {
+                return 0;
+            }
+            data[out_index++] = byte;
+        }
+        // Every block but the last ends in an implied zero
+        if (code != 0xFF && in_index < length) {
+            data[out_index++] = 0;
+        }
+    }
+    return out_index;
+}
+
+size_t serial_frame_pack(uint8_t *payload, size_t length, uint8_t *out)
+{
+    serial_frame_put_u16(&payload[length], serial_frame_crc16(payload, length));
+    // A leading delimiter ends whatever the receiver had buffered, e.g.
+    // log text that went out on the same UART
+    out[0] = SERIAL_FRAME_DELIMITER;
+    size_t encoded = serial_frame_cobs_encode(payload, length + SERIAL_FRAME_CRC_SIZE, &out[1]);
+    out[1 + encoded] = SERIAL_FRAME_DELIMITER;
+    return encoded + 2;
+}
+
+int serial_frame_unpack(uint8_t *data, size_t length)
+{
+    size_t decoded = serial_frame_cobs_decode(data, length);
+    if (decoded <= SERIAL_FRAME_CRC_SIZE) {
+        return -1;
+    }
+    size_t payload_length = decoded - SERIAL_FRAME_CRC_SIZE;
+    if (serial_frame_get_u16(&data[payload_length]) != serial_frame_crc16(data, payload_length)) {
+        return -1;
+    }
+    return (int)payload_length;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file serial_frame.h
+ * @brief Binary frame encoding for the serial protocol
+ *
+ * Frames are protected by a CRC-16 and framed with COBS (Consistent
+ * Overhead Byte Stuffing), which removes every 0x00 from the data so a
+ * 0x00 byte can mark frame boundaries. A receiver that joins mid-stream
+ * or loses bytes resynchronizes at the next 0x00.
+ *
+ * The functions work on caller-provided buffers and keep no state, so
+ * the same code builds for the firmware and for host tools.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#ifndef SERIAL_FRAME_H
+#define SERIAL_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Frame delimiter; never appears inside an encoded frame
+#define SERIAL_FRAME_DELIMITER 0x00
+
+// Size of the CRC appended to a frame
+#define SERIAL_FRAME_CRC_SIZE 2
+
+// Worst-case COBS encoded size of n bytes (without delimiters)
+#define SERIAL_FRAME_ENCODED_MAX(n) ((n) + (n) / 254 + 1)
+
+/**
+ * @brief Compute the CRC-16/CCITT-FALSE of a buffer
+ *
+ * Polynomial 0x1021, initial value 0xFFFF, no reflection.
+ *
+ * @param data Bytes to check
+ * @param length Number of bytes
+ * @return CRC
+ */
+uint16_t serial_frame_crc16(const uint8_t *data, size_t length);
+
+/**
+ * @brief COBS encode a buffer
+ *
+ * @param data Bytes to encode
+ * @param length Number of bytes
+ * @param out Encoded bytes, at least SERIAL_FRAME_ENCODED_MAX(length);
+ *            must not overlap data
+ * @return Number of encoded bytes
+ */
+size_t serial_frame_cobs_encode(const uint8_t *data, size_t length, uint8_t *out);
+
+/**
+ * @brief COBS decode a buffer in place
+ *
+ * Decoding never makes data longer, so the decoded bytes overwrite the
+ * encoded ones from the start of the buffer.
+ *
+ * @param data Encoded bytes, without delimiters; decoded on return
+ * @param length Number of encoded bytes
+ * @return Number of decoded bytes, or 0 if the data is not valid COBS
+ */
+size_t serial_frame_cobs_decode(uint8_t *data, size_t length);
+
+/**
+ * @brief Append the CRC to a payload and COBS encode it between delimiters
+ *
+ * @param payload Frame contents; SERIAL_FRAME_CRC_SIZE bytes past its end
+ *                must be writable, they receive the CRC
+ * @param length Number of payload bytes
+ * @param out Encoded frame, at least
+ *            SERIAL_FRAME_ENCODED_MAX(length + SERIAL_FRAME_CRC_SIZE) + 2 bytes
+ * @return Number of bytes to send
+ */
+size_t serial_frame_pack(uint8_t *payload, size_t length, uint8_t *out);
+
+/**
+ * @brief Decode a received frame in place and check its CRC
+ *
+ * @param data Encoded bytes between two delimiters; decoded on return
+ * @param length Number of encoded bytes
+ * @return Number of payload bytes (CRC stripped), or -1 if the frame is
+ *         not valid COBS, too short or fails the CRC
+ */
+int serial_frame_unpack(uint8_t *data, size_t length);
+
+/**
+ * @brief Read a little-endian 16-bit field
+ */
+static inline uint16_t serial_frame_get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/**
+ * @brief Read a little-endian 32-bit field
+ */
+static inline uint32_t serial_frame_get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief Write a little-endian 16-bit field
+ */
+static inline void serial_frame_put_u16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+/**
+ * @brief Write a little-endian 32-bit field
+ */
+static inline void serial_frame_put_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERIAL_FRAME_H
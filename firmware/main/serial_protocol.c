@@ -2,16 +2,57 @@
  * @file serial_protocol.c
  * @brief Serial protocol implementation
  * 
- * This file implements the serial communication protocol.
- * Functionality to be implemented later.
+ * This file implements the serial communication protocol. Commands are
+ * text lines on UART0:
+ *
+ *   latency             Print the button input latency histograms
+ *   latency reset       Clear them
+ *   tune store N HEX    Store a packed melody in NVS slot N, four hex
+ *                       digits per note (tools/gen_melodies.py --hex)
+ *   tune play N         Play the melody in slot N
+ *   tune erase N        Remove it
+ *   volume [LEVEL]      Set the buzzer volume (low, medium, high) or print it
+ * 
+ * and binary frames (see serial_protocol.h) for programs. A 0x00 byte
+ * switches the receiver from text to a frame, which ends at the next
+ * 0x00. The serial task sleeps on the UART driver's event queue; the
+ * frame is COBS decoded in place in the buffer it was read into, and
+ * commands read their arguments straight from there, so no message is
+ * copied or allocated.
+ *
+ * The characters that wake the chip from light sleep are lost, so after
+ * an idle period a host sends SERIAL_WAKE_PREAMBLE_LENGTH 0x00 bytes (or
+ * an empty text line) before the first frame. Any input then holds off
+ * light sleep for SERIAL_RX_AWAKE_MS, so the rest of the exchange
+ * arrives intact.
  * 
  * @author StuckAtPrototype, LLC
  * @version 1.0
  */
 
 #include "serial_protocol.h"
+#include "serial_frame.h"
+#include "button.h"
+#include "latency.h"
+#include "led.h"
+#include "led_stream.h"
+#include "log_buffer.h"
+#include "melody.h"
+#include "piezo.h"
+#include "systime.h"
+#include "telemetry.h"
+#include "timer.h"
+#include "ws2812_control.h"
 #include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
 #include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
 #include <string.h>
 
 static const char *TAG = "serial_protocol";
@@ -19,8 +60,672 @@ static const char *TAG = "serial_protocol";
 // UART configuration
 #define UART_NUM UART_NUM_0
 #define UART_BUF_SIZE 1024
+#define UART_TX_BUF_SIZE 512        // Writes return once queued here
+#define UART_EVENT_QUEUE_LEN 16
+
+// Edges on RX that wake the chip from light sleep; the characters that
+// caused them are lost, hence the wake preamble
+#define UART_WAKEUP_THRESHOLD 3
+
+// Long enough for "tune store N" and MELODY_MAX_NOTES packed notes
+#define SERIAL_LINE_MAX (16 + 4 * MELODY_MAX_NOTES)
+
+// Received frame, decoded in place; room for the CRC after the payload
+#define FRAME_RX_MAX SERIAL_FRAME_ENCODED_MAX(SERIAL_FRAME_PAYLOAD_MAX + SERIAL_FRAME_CRC_SIZE)
+
+// Response header: opcode, sequence number, status
+#define FRAME_HEADER_SIZE 3
+
+// Log read results: position and end, then the text
+#define LOG_READ_HEADER_SIZE 8
+
+// A frame command; results go after the response header
+typedef struct {
+    uint8_t opcode;
+    int8_t arg_length;          // -1 for any length
+    bool respond;               // false for streamed data that gets no response
+    serial_status_t (*run)(const uint8_t *args, size_t arg_length, uint8_t *results, size_t *result_length);
+} frame_command_t;
 
 static bool serial_initialized = false;
+static QueueHandle_t uart_queue = NULL;
+static char line_buffer[SERIAL_LINE_MAX];
+static size_t line_length = 0;
+static bool line_overflow = false;          // The current line lost bytes
+static uint8_t frame_buffer[FRAME_RX_MAX];
+static size_t frame_length = 0;
+static bool in_frame = false;               // Between a 0x00 and the next
+static bool frame_overflow = false;
+static uint8_t response[SERIAL_FRAME_PAYLOAD_MAX + SERIAL_FRAME_CRC_SIZE];
+static uint8_t response_encoded[SERIAL_FRAME_ENCODED_MAX(sizeof(response)) + 2];
+static serial_stats_t serial_stats = {0};
+static serial_timer_callback_t timer_callback = NULL;
+static uint32_t telemetry_interval_ms = 0;  // 0: not streaming
+static int64_t telemetry_next_us = SYSTIME_NEVER;
+static uint8_t telemetry_sequence = 0;      // Counts streamed messages
+static int64_t telemetry_lease_end_us = SYSTIME_NEVER;  // Streaming stops here unless renewed
+static esp_pm_lock_handle_t rx_pm_lock = NULL;  // Held for a while after input
+static int64_t rx_awake_until_us = SYSTIME_NEVER;   // Release time while held
+
+/**
+ * @brief Write a formatted line to the UART
+ */
+static void serial_printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static void serial_printf(const char *format, ...)
+{
+    char buffer[96];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (len > 0) {
+        uart_write_bytes(UART_NUM, buffer, len < (int)sizeof(buffer) ? (size_t)len : sizeof(buffer) - 1);
+    }
+}
+
+/**
+ * @brief Print the input latency histograms, one line per non-empty bucket
+ */
+static void send_latency_report(void)
+{
+    latency_stats_t stats;
+    latency_get_stats(&stats);
+
+    serial_printf("latency: %" PRIu32 " presses, %" PRIu32 " without a frame\n",
+                  stats.stages[LATENCY_EDGE_TO_CALLBACK].count, stats.no_frame);
+    for (int stage = 0; stage < LATENCY_NUM_STAGES; stage++) {
+        const latency_histogram_t *histogram = &stats.stages[stage];
+        if (histogram->count == 0) {
+            serial_printf("%s: no samples\n", latency_stage_name(stage));
+            continue;
+        }
+        serial_printf("%s: %" PRIu32 " samples, min %" PRIu32 " us, avg %" PRIu32 " us, max %" PRIu32 " us\n",
+                      latency_stage_name(stage), histogram->count, histogram->min_us,
+                      (uint32_t)(histogram->total_us / histogram->count), histogram->max_us);
+        for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+            if (histogram->buckets[bucket] == 0) {
+                continue;
+            }
+            uint32_t low_us = bucket == 0 ? 0 : 1u << (bucket - 1);
+            if (bucket == LATENCY_BUCKETS - 1) {
+                serial_printf("  %" PRIu32 " us and up: %" PRIu32 "\n", low_us, histogram->buckets[bucket]);
+            } else {
+                uint32_t high_us = bucket == 0 ? 0 : (1u << bucket) - 1;
+                serial_printf("  %" PRIu32 "..%" PRIu32 " us: %" PRIu32 "\n", low_us, high_us, histogram->buckets[bucket]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Value of one hex digit, or -1
+ */
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * @brief Run a "tune" command; args is the text after "tune "
+ */
+static void handle_tune_command(const char *args)
+{
+    char action[8];
+    unsigned slot;
+    int consumed = 0;
+    if (sscanf(args, "%7s %u %n", action, &slot, &consumed) < 2 || slot >= MELODY_SLOTS) {
+        serial_printf("tune: expected store|play|erase and a slot below %d\n", MELODY_SLOTS);
+        return;
+    }
+    
+    if (strcmp(action, "play") == 0) {
+        serial_printf("tune: %s\n", melody_play_stored(slot) ? "playing" : "empty slot");
+    } else if (strcmp(action, "erase") == 0) {
+        serial_printf("tune: %s\n", melody_erase(slot) ? "erased" : "failed");
+    } else if (strcmp(action, "store") == 0) {
+        // Packed notes, converted once here so playback has nothing to parse
+        static uint16_t notes[MELODY_MAX_NOTES];
+        const char *hex = args + consumed;
+        size_t digits = strlen(hex);
+        if (digits == 0 || digits % 4 != 0 || digits / 4 > MELODY_MAX_NOTES) {
+            serial_printf("tune: expected 4 hex digits per note, up to %d notes\n", MELODY_MAX_NOTES);
+            return;
+        }
+        for (size_t i = 0; i < digits; i++) {
+            int value = hex_digit(hex[i]);
+            if (value < 0) {
+                serial_printf("tune: bad hex digit '%c'\n", hex[i]);
+                return;
+            }
+            notes[i / 4] = (i % 4 == 0 ? 0 : notes[i / 4] << 4) | value;
+        }
+        serial_printf("tune: %s\n", melody_store(slot, notes, digits / 4) ? "stored" : "failed");
+    } else {
+        serial_printf("tune: unknown action %s\n", action);
+    }
+}
+
+/**
+ * @brief Run a "volume" command; args is the text after "volume", maybe empty
+ */
+static void handle_volume_command(const char *args)
+{
+    static const char *const names[PIEZO_VOLUME_COUNT] = {
+        [PIEZO_VOLUME_LOW] = "low",
+        [PIEZO_VOLUME_MEDIUM] = "medium",
+        [PIEZO_VOLUME_HIGH] = "high",
+    };
+    while (*args == ' ') {
+        args++;
+    }
+    if (*args != '\0') {
+        int level = 0;
+        while (level < PIEZO_VOLUME_COUNT && strcmp(args, names[level]) != 0) {
+            level++;
+        }
+        if (level == PIEZO_VOLUME_COUNT) {
+            serial_printf("volume: expected low|medium|high\n");
+            return;
+        }
+        piezo_set_volume((piezo_volume_t)level);
+    }
+    serial_printf("volume: %s\n", names[piezo_get_volume()]);
+}
+
+/**
+ * @brief Execute one command line
+ */
+static void handle_command(const char *line)
+{
+    if (strcmp(line, "latency") == 0) {
+        send_latency_report();
+    } else if (strcmp(line, "latency reset") == 0) {
+        latency_reset();
+        serial_printf("latency: reset\n");
+    } else if (strncmp(line, "tune ", 5) == 0) {
+        handle_tune_command(line + 5);
+    } else if (strncmp(line, "volume", 6) == 0 && (line[6] == '\0' || line[6] == ' ')) {
+        handle_volume_command(line + 6);
+    } else if (line[0] != '\0') {
+        serial_printf("unknown command: %s\n", line);
+    }
+}
+
+/**
+ * @brief Tell the registered callback that the timer changed
+ */
+static void timer_changed(void)
+{
+    if (timer_callback != NULL) {
+        timer_callback();
+    }
+}
+
+/**
+ * @brief SERIAL_OP_PING: echo the arguments
+ */
+static serial_status_t frame_ping(const uint8_t *args, size_t arg_length, uint8_t *results, size_t *result_length)
+{
+    memcpy(results, args, arg_length);
+    *result_length = arg_length;
+    return SERIAL_STATUS_OK;
+}
+
+/**
+ * @brief SERIAL_OP_TIMER_START: u8 minutes
+ */
+static serial_status_t frame_timer_start(const uint8_t *args, size_t arg_length, uint8_t *results,
+                                         size_t *result_length)
+{
+    if (!timer_start(args[0])) {
+        return SERIAL_STATUS_BAD_ARGUMENT;
+    }
+    timer_changed();
+    return SERIAL_STATUS_OK;
+}
+
+/**
+ * @brief SERIAL_OP_TIMER_STOP
+ */
+static serial_status_t frame_timer_stop(const uint8_t *args, size_t arg_length, uint8_t *results,
+                                        size_t *result_length)
+{
+    timer_stop();
+    timer_changed();
+    return SERIAL_STATUS_OK;
+}
+
+/**
+ * @brief SERIAL_OP_TIMER_QUERY: state, remaining and run length in ms
+ */
+static serial_status_t frame_timer_query(const uint8_t *args, size_t arg_length, uint8_t *results,
+                                         size_t *result_length)
+{
+    timer_snapshot_t timer;
+    timer_get_snapshot(&timer);
+    int64_t remaining_us = 0;
+    if (timer.state == TIMER_STATE_RUNNING) {
+        remaining_us = systime_us_until(timer.start_us + timer.duration_us);
+    }
+    results[0] = (uint8_t)timer.state;
+    serial_frame_put_u32(&results[1], (uint32_t)(remaining_us / SYSTIME_US_PER_MS));
+    serial_frame_put_u32(&results[5], (uint32_t)(timer.duration_us / SYSTIME_US_PER_MS));
+    *result_length = 9;
+    return SERIAL_STATUS_OK;
+}
+
+/**
+ * @brief SERIAL_OP_LED_SCENE: scene, intensity, color, waveform, parameter
+ */
+static serial_status_t frame_led_scene(const uint8_t *args, size_t arg_length, uint8_t *results,
+                                       size_t *result_length)
+{
+    float intensity = args[1] / 255.0f;
+    uint32_t color = serial_frame_get_u32(&args[2]);
+    uint8_t waveform = args[6];
+    uint16_t parameter = serial_frame_get_u16(&args[7]);
+    if (color > 0xFFFFFF || waveform >= LED_WAVEFORM_COUNT) {
+        return SERIAL_STATUS_BAD_ARGUMENT;
+    }
+    
+    switch (args[0]) {
+        case SERIAL_LED_OFF:
+            led_clear_all();
+            break;
+        case SERIAL_LED_SOLID:
+            led_set_intensity(intensity);
+            led_set_color(color);
+            break;
+        case SERIAL_LED_PULSE:
+            led_set_intensity(intensity);
+            led_set_pulse_waveform((led_waveform_t)waveform, parameter);
+            led_set_pulsing(color, true);
+            break;
+        case SERIAL_LED_PROGRESS:
+            led_set_intensity(intensity);
+            led_set_progress(parameter / 65535.0f, color);
+            break;
+        default:
+            return SERIAL_STATUS_BAD_ARGUMENT;
+    }
+    return SERIAL_STATUS_OK;
+}
+
+/**
+ * @brief SERIAL_OP_LED_STREAM: u8 serial_led_stream_t -> stream statistics
+ */
+static serial_status_t frame_led_stream(const uint8_t *args, size_t arg_length, uint8_t *results,
+                                        size_t *result_length)
+{
+    switch (args[0]) {
+        case SERIAL_LED_STREAM_STOP:
+            led_stream_stop();
+            break;
+        case SERIAL_LED_STREAM_START:
+            led_stream_start();
+            break;
+        case SERIAL_LED_STREAM_QUERY:
+            break;
+        default:
+            return SERIAL_STATUS_BAD_ARGUMENT;
+    }
+    
+    led_stream_stats_t stats;
+    led_stream_get_stats(&stats);
+    results[0] = led_stream_active() ? 1 : 0;
+    serial_frame_put_u32(&results[1], stats.received);
+    serial_frame_put_u32(&results[5], stats.shown);
+    serial_frame_put_u32(&results[9], stats.dropped);
+    serial_frame_put_u32(&results[13], stats.rejected);
+    serial_frame_put_u32(&results[17], stats.fps_x100);
+    *result_length = 21;
+    return SERIAL_STATUS_OK;
+}
+
+/**
+ * @brief SERIAL_OP_LED_FRAME: flags and ops (led_stream.h); no response
+ */
+static serial_status_t frame_led_frame(const uint8_t *args, size_t arg_length, uint8_t *results,
+                                       size_t *result_length)
+{
+    uint8_t sequence = frame_buffer[1];
+    return led_stream_receive(sequence, args, arg_length) ? SERIAL_STATUS_OK : SERIAL_STATUS_BAD_ARGUMENT;
+}
+
+/**
+ * @brief SERIAL_OP_PLAY_TONE: u16 frequency, u16 duration
+ */
+static serial_status_t frame_play_tone(const uint8_t *args, size_t arg_length, uint8_t *results,
+                                       size_t *result_length)
+{
+    uint16_t frequency = serial_frame_get_u16(&args[0]);
+    uint16_t duration_ms = serial_frame_get_u16(&args[2]);
+    if (frequency == 0) {
+        return SERIAL_STATUS_BAD_ARGUMENT;
+    }
+    return piezo_play_tone(frequency, duration_ms) == 0 ? SERIAL_STATUS_OK : SERIAL_STATUS_FAILED;
+}
+
+/**
+ * @brief SERIAL_OP_STOP_TONE
+ */
+static serial_status_t frame_stop_tone(const uint8_t *args, size_t arg_length, uint8_t *results,
+                                       size_t *result_length)
+{
+    return piezo_stop() == 0 ? SERIAL_STATUS_OK : SERIAL_STATUS_FAILED;
+}
+
+/**
+ * @brief SERIAL_OP_PERF: the serial_perf_counter_t counters
+ */
+static serial_status_t frame_perf(const uint8_t *args, size_t arg_length, uint8_t *results, size_t *result_length)
+{
+    button_stats_t button;
+    led_render_stats_t render;
+    ws2812_stats_t ws2812;
+    // Too big for the serial task's stack
+    static latency_stats_t latency;
+    button_get_stats(&button);
+    led_get_render_stats(&render);
+    ws2812_get_stats(&ws2812);
+    latency_get_stats(&latency);
+    const latency_histogram_t *end_to_end = &latency.stages[LATENCY_EDGE_TO_FRAME];
+    
+    uint32_t counters[SERIAL_PERF_COUNT] = {
+        [SERIAL_PERF_UPTIME_MS] = (uint32_t)(systime_now_us() / SYSTIME_US_PER_MS),
+        [SERIAL_PERF_BUTTON_ISRS] = button.isr_calls,
+        [SERIAL_PERF_BUTTON_PRESSES] = button.presses,
+        [SERIAL_PERF_LED_FRAMES] = render.frames,
+        [SERIAL_PERF_LED_AVG_CYCLES] = render.frames > 0 ? (uint32_t)(render.total_cycles / render.frames) : 0,
+        [SERIAL_PERF_LED_MAX_CYCLES] = render.max_cycles,
+        [SERIAL_PERF_WS2812_SENT] = ws2812.frames_sent,
+        [SERIAL_PERF_WS2812_SKIPPED] = ws2812.frames_skipped,
+        [SERIAL_PERF_LATENCY_COUNT] = end_to_end->count,
+        [SERIAL_PERF_LATENCY_AVG_US] = end_to_end->count > 0 ? (uint32_t)(end_to_end->total_us / end_to_end->count) : 0,
+        [SERIAL_PERF_LATENCY_MAX_US] = end_to_end->max_us,
+        [SERIAL_PERF_FRAMES_RECEIVED] = serial_stats.frames_received,
+        [SERIAL_PERF_FRAMES_REJECTED] = serial_stats.frames_rejected,
+        [SERIAL_PERF_RX_OVERRUNS] = serial_stats.rx_overruns,
+    };
+    for (int i = 0; i < SERIAL_PERF_COUNT; i++) {
+        serial_frame_put_u32(&results[4 * i], counters[i]);
+    }
+    *result_length = 4 * SERIAL_PERF_COUNT;
+    return SERIAL_STATUS_OK;
+}
+
+/**
+ * @brief Extend the telemetry subscription after a frame from the host
+ *
+ * A host that went away without unsubscribing would otherwise be sent
+ * telemetry forever, keeping the chip and the link busy.
+ */
+static void renew_telemetry_lease(void)
+{
+    uint32_t lease_ms = 2 * telemetry_interval_ms;
+    if (lease_ms < SERIAL_TELEMETRY_LEASE_MS) {
+        lease_ms = SERIAL_TELEMETRY_LEASE_MS;
+    }
+    telemetry_lease_end_us = systime_deadline_ms(lease_ms);
+}
+
+/**
+ * @brief SERIAL_OP_TELEMETRY: u16 interval ms -> one message, then streaming
+ */
+static serial_status_t frame_telemetry(const uint8_t *args, size_t arg_length, uint8_t *results,
+                                       size_t *result_length)
+{
+    uint32_t interval_ms = serial_frame_get_u16(&args[0]);
+    if (interval_ms != 0 && interval_ms < SERIAL_TELEMETRY_MIN_INTERVAL_MS) {
+        return SERIAL_STATUS_BAD_ARGUMENT;
+    }
+    telemetry_interval_ms = interval_ms;
+    telemetry_next_us = interval_ms != 0 ? systime_deadline_ms(interval_ms) : SYSTIME_NEVER;
+    
+    telemetry_snapshot_t snapshot;
+    telemetry_capture(&snapshot);
+    *result_length = telemetry_encode(&snapshot, results);
+    return SERIAL_STATUS_OK;
+}
+
+/**
+ * @brief SERIAL_OP_LOG_READ: u32 position -> position, end, text from there
+ */
+static serial_status_t frame_log_read(const uint8_t *args, size_t arg_length, uint8_t *results,
+                                      size_t *result_length)
+{
+    uint32_t position = serial_frame_get_u32(&args[0]);
+    size_t length = log_buffer_read(&position, &results[LOG_READ_HEADER_SIZE],
+                                    SERIAL_FRAME_PAYLOAD_MAX - FRAME_HEADER_SIZE - LOG_READ_HEADER_SIZE);
+    serial_frame_put_u32(&results[0], position);
+    serial_frame_put_u32(&results[4], log_buffer_end());
+    *result_length = LOG_READ_HEADER_SIZE + length;
+    return SERIAL_STATUS_OK;
+}
+
+static const frame_command_t frame_commands[] = {
+    { SERIAL_OP_PING, -1, true, frame_ping },
+    { SERIAL_OP_TIMER_START, 1, true, frame_timer_start },
+    { SERIAL_OP_TIMER_STOP, 0, true, frame_timer_stop },
+    { SERIAL_OP_TIMER_QUERY, 0, true, frame_timer_query },
+    { SERIAL_OP_LED_SCENE, 9, true, frame_led_scene },
+    { SERIAL_OP_LED_STREAM, 1, true, frame_led_stream },
+    { SERIAL_OP_LED_FRAME, -1, false, frame_led_frame },
+    { SERIAL_OP_PLAY_TONE, 4, true, frame_play_tone },
+    { SERIAL_OP_STOP_TONE, 0, true, frame_stop_tone },
+    { SERIAL_OP_PERF, 0, true, frame_perf },
+    { SERIAL_OP_TELEMETRY, 2, true, frame_telemetry },
+    { SERIAL_OP_LOG_READ, 4, true, frame_log_read },
+};
+
+_Static_assert(FRAME_HEADER_SIZE + 4 * SERIAL_PERF_COUNT <= SERIAL_FRAME_PAYLOAD_MAX,
+               "perf counters do not fit in a frame");
+_Static_assert(FRAME_HEADER_SIZE + TELEMETRY_MESSAGE_MAX <= SERIAL_FRAME_PAYLOAD_MAX,
+               "telemetry does not fit in a frame");
+
+/**
+ * @brief Run the frame between two delimiters and send the response
+ */
+static void handle_frame(void)
+{
+    int length = frame_overflow ? -1 : serial_frame_unpack(frame_buffer, frame_length);
+    if (length < 2) {
+        serial_stats.frames_rejected++;
+        return;
+    }
+    serial_stats.frames_received++;
+    
+    uint8_t opcode = frame_buffer[0];
+    const uint8_t *args = &frame_buffer[2];
+    size_t arg_length = (size_t)length - 2;
+    size_t result_length = 0;
+    serial_status_t status = SERIAL_STATUS_UNKNOWN_OP;
+    bool respond = true;
+    for (size_t i = 0; i < sizeof(frame_commands) / sizeof(frame_commands[0]); i++) {
+        const frame_command_t *command = &frame_commands[i];
+        if (command->opcode != opcode) {
+            continue;
+        }
+        respond = command->respond;
+        if (command->arg_length >= 0 && arg_length != (size_t)command->arg_length) {
+            status = SERIAL_STATUS_BAD_LENGTH;
+        } else if (arg_length > SERIAL_FRAME_PAYLOAD_MAX - FRAME_HEADER_SIZE) {
+            status = SERIAL_STATUS_BAD_LENGTH;      // A ping too long to echo
+        } else {
+            status = command->run(args, arg_length, &response[FRAME_HEADER_SIZE], &result_length);
+        }
+        break;
+    }
+    
+    // Any request shows the host is still there, after a subscription too
+    renew_telemetry_lease();
+    
+    if (!respond) {
+        return;
+    }
+    response[0] = opcode | SERIAL_OP_RESPONSE;
+    response[1] = frame_buffer[1];
+    response[2] = (uint8_t)status;
+    size_t encoded = serial_frame_pack(response, FRAME_HEADER_SIZE + result_length, response_encoded);
+    uart_write_bytes(UART_NUM, response_encoded, encoded);
+}
+
+/**
+ * @brief Send the next streamed telemetry message
+ * 
+ * The snapshot is encoded straight into the frame and the frame is
+ * handed to the UART driver's TX ring, so the serial task does not wait
+ * for it to go out.
+ */
+static void send_telemetry(void)
+{
+    telemetry_snapshot_t snapshot;
+    telemetry_capture(&snapshot);
+    response[0] = SERIAL_OP_TELEMETRY | SERIAL_OP_RESPONSE;
+    response[1] = telemetry_sequence++;
+    response[2] = SERIAL_STATUS_OK;
+    size_t length = telemetry_encode(&snapshot, &response[FRAME_HEADER_SIZE]);
+    size_t encoded = serial_frame_pack(response, FRAME_HEADER_SIZE + length, response_encoded);
+    uart_write_bytes(UART_NUM, response_encoded, encoded);
+}
+
+/**
+ * @brief Start over on the text line and frame after lost input
+ */
+static void reset_receiver(void)
+{
+    line_length = 0;
+    line_overflow = false;
+    frame_length = 0;
+    frame_overflow = false;
+    in_frame = false;
+}
+
+/**
+ * @brief Add one received byte to the line or frame, running complete ones
+ */
+static void handle_byte(uint8_t byte)
+{
+    if (byte == SERIAL_FRAME_DELIMITER) {
+        if (in_frame && (frame_length > 0 || frame_overflow)) {
+            handle_frame();
+            in_frame = false;
+        } else {
+            in_frame = true;        // Start of a frame; a partial text line is dropped
+            line_length = 0;
+            line_overflow = false;
+        }
+        frame_length = 0;
+        frame_overflow = false;
+    } else if (in_frame) {
+        if (frame_length < sizeof(frame_buffer)) {
+            frame_buffer[frame_length++] = byte;
+        } else {
+            frame_overflow = true;
+        }
+    } else if (byte == '\r' || byte == '\n') {
+        line_buffer[line_length] = '\0';
+        if (line_overflow) {
+            // Running what is left of it could act on cut-off arguments
+            serial_printf("line too long, at most %d characters\n", SERIAL_LINE_MAX - 1);
+        } else {
+            handle_command(line_buffer);
+        }
+        line_length = 0;
+        line_overflow = false;
+    } else if (line_length < SERIAL_LINE_MAX - 1) {
+        line_buffer[line_length++] = (char)byte;
+    } else {
+        line_overflow = true;
+    }
+}
+
+/**
+ * @brief Stay out of light sleep for a while after input
+ *
+ * Once awake, the UART receives normally; only the bytes that woke the
+ * chip are lost. Holding the chip awake after any input keeps a frame
+ * that follows, or the next request of a conversation, from being cut
+ * the same way.
+ */
+static void hold_awake_after_rx(void)
+{
+    if (rx_pm_lock == NULL) {
+        return;
+    }
+    if (rx_awake_until_us == SYSTIME_NEVER) {
+        esp_pm_lock_acquire(rx_pm_lock);
+    }
+    rx_awake_until_us = systime_deadline_ms(SERIAL_RX_AWAKE_MS);
+}
+
+/**
+ * @brief Serial task: sleeps on the UART event queue, runs commands as data arrives
+ * 
+ * While telemetry or LED frames are streaming, it also wakes when the next
+ * message or frame is due.
+ */
+static void serial_task(void *pvParameters)
+{
+    uart_event_t event;
+
+    while (1) {
+        int64_t deadline_us = systime_earlier(telemetry_next_us, led_stream_next_deadline_us());
+        deadline_us = systime_earlier(deadline_us, rx_awake_until_us);
+        if (xQueueReceive(uart_queue, &event, systime_ticks_until(deadline_us)) != pdTRUE) {
+            event.type = UART_EVENT_MAX;    // Timed out
+        }
+        switch (event.type) {
+            case UART_DATA:
+                hold_awake_after_rx();
+                serial_process_commands();
+                break;
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                // Input was lost; whatever was half received is garbage
+                hold_awake_after_rx();
+                serial_stats.rx_overruns++;
+                uart_flush_input(UART_NUM);
+                xQueueReset(uart_queue);
+                reset_receiver();
+                break;
+            default:
+                break;
+        }
+        
+        if (rx_awake_until_us != SYSTIME_NEVER && systime_expired(rx_awake_until_us)) {
+            esp_pm_lock_release(rx_pm_lock);
+            rx_awake_until_us = SYSTIME_NEVER;
+        }
+        
+        // After all received frames, so only the newest LED frame is shown
+        led_stream_poll();
+        
+        if (telemetry_interval_ms != 0 && systime_expired(telemetry_next_us)
+                && systime_expired(telemetry_lease_end_us)) {
+            ESP_LOGW(TAG, "No frame from the host, telemetry stopped");
+            telemetry_interval_ms = 0;
+            telemetry_next_us = SYSTIME_NEVER;
+        }
+        if (telemetry_interval_ms != 0 && systime_expired(telemetry_next_us)) {
+            send_telemetry();
+            // Keep the cadence, unless the task fell a whole interval behind
+            telemetry_next_us += telemetry_interval_ms * SYSTIME_US_PER_MS;
+            if (systime_expired(telemetry_next_us)) {
+                telemetry_next_us = systime_deadline_ms(telemetry_interval_ms);
+            }
+        }
+    }
+}
 
 void serial_protocol_init(void)
 {
@@ -40,7 +745,7 @@ void serial_protocol_init(void)
     };
 
     // Install UART driver
-    esp_err_t ret = uart_driver_install(UART_NUM, UART_BUF_SIZE, 0, 0, NULL, 0);
+    esp_err_t ret = uart_driver_install(UART_NUM, UART_BUF_SIZE, UART_TX_BUF_SIZE, UART_EVENT_QUEUE_LEN, &uart_queue, 0);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to install UART driver: %s", esp_err_to_name(ret));
         return;
@@ -61,38 +766,50 @@ void serial_protocol_init(void)
         return;
     }
 
+    // Let input wake the chip from light sleep
+    ret = uart_set_wakeup_threshold(UART_NUM, UART_WAKEUP_THRESHOLD);
+    if (ret == ESP_OK) {
+        ret = esp_sleep_enable_uart_wakeup(UART_NUM);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to enable UART wakeup: %s", esp_err_to_name(ret));
+    }
+    ret = esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "serial_rx", &rx_pm_lock);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to create serial RX PM lock: %s", esp_err_to_name(ret));
+        rx_pm_lock = NULL;
+    }
+
     serial_initialized = true;
+
+    if (xTaskCreate(serial_task, "serial", 3072, NULL, 2, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create serial task");
+        return;
+    }
     ESP_LOGI(TAG, "Serial protocol initialized");
 }
 
-void serial_process_commands(void)
+void serial_register_timer_callback(serial_timer_callback_t callback)
 {
-    if (!serial_initialized) {
-        return;
-    }
+    timer_callback = callback;
+}
 
-    // TODO: Implement command processing
-    // Read from UART and process commands
+void serial_get_stats(serial_stats_t *stats)
+{
+    *stats = serial_stats;
 }
 
-void serial_send_sensor_data(uint8_t ens210_status, float temp_c, float humidity,
-                             const char* ens16x_status_str, int etvoc, int eco2, int aqi)
+void serial_process_commands(void)
 {
     if (!serial_initialized) {
         return;
     }
 
-    // TODO: Implement JSON serialization and transmission
-    // Format: {"ens210":{"status":...,"temp":...,"humidity":...},"ens16x":{"status":...,"etvoc":...,"eco2":...,"aqi":...}}
-    
-    char json_buffer[512];
-    int len = snprintf(json_buffer, sizeof(json_buffer),
-        "{\"ens210\":{\"status\":%u,\"temp\":%.2f,\"humidity\":%.2f},"
-        "\"ens16x\":{\"status\":\"%s\",\"etvoc\":%d,\"eco2\":%d,\"aqi\":%d}}\n",
-        ens210_status, temp_c, humidity, ens16x_status_str, etvoc, eco2, aqi);
-    
-    if (len > 0 && len < sizeof(json_buffer)) {
-        uart_write_bytes(UART_NUM, json_buffer, len);
+    uint8_t chunk[32];
+    int got;
+    while ((got = uart_read_bytes(UART_NUM, chunk, sizeof(chunk), 0)) > 0) {
+        for (int i = 0; i < got; i++) {
+            handle_byte(chunk[i]);
+        }
     }
 }
-
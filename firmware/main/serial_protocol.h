@@ -2,8 +2,20 @@
  * @file serial_protocol.h
  * @brief Serial protocol header
  * 
- * This header file defines the interface for serial communication protocol.
- * Functionality to be implemented later.
+ * This header file defines the interface for serial communication protocol:
+ * text commands and binary frames on UART0 (see serial_protocol.c),
+ * including streamed telemetry.
+ * 
+ * Binary frames (serial_frame.h) are sent as 0x00, the COBS encoded
+ * payload and CRC, and 0x00 again. A request payload is an opcode, a
+ * sequence number and the opcode's arguments; the response carries the
+ * opcode with SERIAL_OP_RESPONSE set, the same sequence number, a status
+ * and the results. Multi-byte fields are little-endian.
+ *
+ * The chip is in light sleep when idle, and the bytes that wake it are
+ * lost. Before the first frame after a pause of more than
+ * SERIAL_RX_AWAKE_MS, send SERIAL_WAKE_PREAMBLE_LENGTH 0x00 bytes; the
+ * receiver takes repeated delimiters as one.
  * 
  * @author StuckAtPrototype, LLC
  * @version 1.0
@@ -18,34 +30,135 @@
 extern "C" {
 #endif
 
+// Largest frame payload, CRC not included
+#define SERIAL_FRAME_PAYLOAD_MAX 96
+
+// 0x00 bytes a host sends to wake the chip before a frame after idle
+#define SERIAL_WAKE_PREAMBLE_LENGTH 4
+
+// Light sleep is held off this long after the last received byte
+#define SERIAL_RX_AWAKE_MS 500
+
+// Shortest telemetry streaming interval
+#define SERIAL_TELEMETRY_MIN_INTERVAL_MS 20
+
+// Telemetry streaming stops after this long, or two intervals if longer,
+// without a request from the host
+#define SERIAL_TELEMETRY_LEASE_MS 5000
+
+// Opcodes; arguments -> results after the opcode, sequence and status
+typedef enum {
+    SERIAL_OP_PING = 0x01,          // any bytes -> the same bytes
+    SERIAL_OP_TIMER_START = 0x10,   // u8 minutes (a button preset)
+    SERIAL_OP_TIMER_STOP = 0x11,
+    SERIAL_OP_TIMER_QUERY = 0x12,   // -> u8 timer_state_t, u32 remaining ms, u32 run length ms
+    SERIAL_OP_LED_SCENE = 0x20,     // u8 serial_led_scene_t, u8 intensity (255 = full),
+                                    // u32 color 0x00GGRRBB, u8 led_waveform_t,
+                                    // u16 pulse period ms or progress (65535 = full)
+    SERIAL_OP_LED_STREAM = 0x21,    // u8 serial_led_stream_t -> u8 streaming, u32 frames received,
+                                    // shown, dropped (late), rejected, u32 fps x100
+    SERIAL_OP_LED_FRAME = 0x22,     // Frame for the LED stream (led_stream.h); no response
+    SERIAL_OP_PLAY_TONE = 0x30,     // u16 frequency Hz, u16 duration ms (0 = until stopped)
+    SERIAL_OP_STOP_TONE = 0x31,
+    SERIAL_OP_PERF = 0x40,          // -> serial_perf_counter_t u32 counters, in order
+    SERIAL_OP_TELEMETRY = 0x50,     // u16 interval ms (0 = once) -> telemetry CBOR map (telemetry.h);
+                                    // then every interval the same response again, its
+                                    // sequence number counting the messages streamed, for
+                                    // as long as any request renews SERIAL_TELEMETRY_LEASE_MS
+    SERIAL_OP_LOG_READ = 0x60,      // u32 position -> u32 position of the text returned (later if
+                                    // the text asked for was overwritten), u32 end of the log,
+                                    // then the text (log_buffer.h); empty at the end
+    SERIAL_OP_RESPONSE = 0x80,      // Set in the opcode of a response
+} serial_opcode_t;
+
+// Response status
+typedef enum {
+    SERIAL_STATUS_OK = 0,
+    SERIAL_STATUS_UNKNOWN_OP,
+    SERIAL_STATUS_BAD_LENGTH,
+    SERIAL_STATUS_BAD_ARGUMENT,
+    SERIAL_STATUS_FAILED,
+} serial_status_t;
+
+// LED scenes; shown until the main loop next updates the LEDs for the
+// timer (a button, a command or a timer deadline)
+typedef enum {
+    SERIAL_LED_OFF = 0,
+    SERIAL_LED_SOLID,
+    SERIAL_LED_PULSE,
+    SERIAL_LED_PROGRESS,
+} serial_led_scene_t;
+
+// LED stream control
+typedef enum {
+    SERIAL_LED_STREAM_STOP = 0,
+    SERIAL_LED_STREAM_START,
+    SERIAL_LED_STREAM_QUERY,
+} serial_led_stream_t;
+
+// Counters returned by SERIAL_OP_PERF
+typedef enum {
+    SERIAL_PERF_UPTIME_MS = 0,
+    SERIAL_PERF_BUTTON_ISRS,
+    SERIAL_PERF_BUTTON_PRESSES,
+    SERIAL_PERF_LED_FRAMES,
+    SERIAL_PERF_LED_AVG_CYCLES,
+    SERIAL_PERF_LED_MAX_CYCLES,
+    SERIAL_PERF_WS2812_SENT,
+    SERIAL_PERF_WS2812_SKIPPED,
+    SERIAL_PERF_LATENCY_COUNT,      // Button edge to LED frame
+    SERIAL_PERF_LATENCY_AVG_US,
+    SERIAL_PERF_LATENCY_MAX_US,
+    SERIAL_PERF_FRAMES_RECEIVED,    // Binary frames with a valid CRC
+    SERIAL_PERF_FRAMES_REJECTED,    // Bad COBS, CRC or size
+    SERIAL_PERF_RX_OVERRUNS,        // UART FIFO or RX buffer overflows
+    SERIAL_PERF_COUNT,
+} serial_perf_counter_t;
+
+// Serial protocol statistics
+typedef struct {
+    uint32_t frames_received;
+    uint32_t frames_rejected;
+    uint32_t rx_overruns;
+} serial_stats_t;
+
+/**
+ * @brief Callback after a command changed the timer
+ * 
+ * Runs in the serial task.
+ */
+typedef void (*serial_timer_callback_t)(void);
+
 /**
  * @brief Initialize serial protocol
  * 
- * Initializes the serial communication protocol.
+ * Initializes the serial communication protocol and starts the task that
+ * runs commands as they arrive.
  */
 void serial_protocol_init(void);
 
 /**
- * @brief Process incoming serial commands
+ * @brief Register a callback for commands that change the timer
  * 
- * Processes any incoming commands from the serial interface.
- * Should be called periodically.
+ * @param callback Function to call after the timer was started or stopped
  */
-void serial_process_commands(void);
+void serial_register_timer_callback(serial_timer_callback_t callback);
+
+/**
+ * @brief Get serial protocol statistics
+ * 
+ * @param stats Filled with the counts since boot
+ */
+void serial_get_stats(serial_stats_t *stats);
 
 /**
- * @brief Send sensor data as JSON over serial
- * 
- * @param ens210_status ENS210 sensor status
- * @param temp_c Temperature in Celsius
- * @param humidity Humidity percentage
- * @param ens16x_status_str ENS16X status string
- * @param etvoc eTVOC value
- * @param eco2 eCO2 value
- * @param aqi AQI value
+ * @brief Process incoming serial commands
+ * 
+ * Processes any incoming commands already received on the serial
+ * interface, without waiting for more. The serial task calls this
+ * whenever the UART driver reports received data.
  */
-void serial_send_sensor_data(uint8_t ens210_status, float temp_c, float humidity,
-                             const char* ens16x_status_str, int etvoc, int eco2, int aqi);
+void serial_process_commands(void);
 
 #ifdef __cplusplus
 }
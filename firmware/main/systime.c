@@ -0,0 +1,69 @@
+/**
+ * @file systime.c
+ * @brief 64-bit monotonic microsecond clock and deadline helpers
+ *
+ * This file implements the shared time base on top of esp_timer.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#include "systime.h"
+#include "esp_timer.h"
+#include <sys/time.h>
+
+// Microseconds per FreeRTOS tick
+#define SYSTIME_US_PER_TICK ((int64_t)portTICK_PERIOD_MS * SYSTIME_US_PER_MS)
+
+int64_t systime_now_us(void)
+{
+    return esp_timer_get_time();
+}
+
+int64_t systime_rtc_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * SYSTIME_US_PER_SEC + tv.tv_usec;
+}
+
+int64_t systime_deadline_ms(uint32_t ms)
+{
+    return systime_now_us() + (int64_t)ms * SYSTIME_US_PER_MS;
+}
+
+bool systime_expired(int64_t deadline_us)
+{
+    return deadline_us != SYSTIME_NEVER && systime_now_us() >= deadline_us;
+}
+
+int64_t systime_us_until(int64_t deadline_us)
+{
+    if (deadline_us == SYSTIME_NEVER) {
+        return SYSTIME_NEVER;
+    }
+    int64_t remaining = deadline_us - systime_now_us();
+    return remaining > 0 ? remaining : 0;
+}
+
+int64_t systime_earlier(int64_t a_us, int64_t b_us)
+{
+    return a_us < b_us ? a_us : b_us;
+}
+
+TickType_t systime_ticks_until(int64_t deadline_us)
+{
+    int64_t remaining = systime_us_until(deadline_us);
+    if (remaining == SYSTIME_NEVER) {
+        return portMAX_DELAY;
+    }
+    if (remaining == 0) {
+        return 0;
+    }
+
+    int64_t ticks = (remaining + SYSTIME_US_PER_TICK - 1) / SYSTIME_US_PER_TICK + 1;
+    if (ticks >= (int64_t)portMAX_DELAY) {
+        return portMAX_DELAY - 1;  // Still a finite wait
+    }
+    return (TickType_t)ticks;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file systime.h
+ * @brief 64-bit monotonic microsecond clock and deadline helpers
+ *
+ * This header file defines the one time base shared by the timer, button
+ * and LED modules. Times are microseconds since boot from esp_timer, which
+ * never wraps in practice (292,000 years), so elapsed times and deadlines
+ * are plain int64_t arithmetic with no tick conversions or overflow.
+ * The host build provides esp_timer_get_time() from the simulator clock.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#ifndef SYSTIME_H
+#define SYSTIME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Deadline that never expires
+#define SYSTIME_NEVER INT64_MAX
+
+#define SYSTIME_US_PER_MS  1000LL
+#define SYSTIME_US_PER_SEC 1000000LL
+
+/**
+ * @brief Microseconds since boot
+ */
+int64_t systime_now_us(void);
+
+/**
+ * @brief Microseconds on the system clock kept by the RTC timer
+ *
+ * Unlike systime_now_us(), this clock keeps counting through software,
+ * watchdog and brownout resets; only a power-on reset restarts it. It
+ * relates times across reboots and is not meant for deadlines.
+ */
+int64_t systime_rtc_us(void);
+
+/**
+ * @brief Deadline a number of milliseconds from now
+ */
+int64_t systime_deadline_ms(uint32_t ms);
+
+/**
+ * @brief Check whether a deadline has been reached
+ *
+ * @return true once the clock is at or past @p deadline_us
+ */
+bool systime_expired(int64_t deadline_us);
+
+/**
+ * @brief Time left until a deadline
+ *
+ * @return Microseconds until @p deadline_us (0 if expired), or
+ *         SYSTIME_NEVER for SYSTIME_NEVER
+ */
+int64_t systime_us_until(int64_t deadline_us);
+
+/**
+ * @brief Earlier of two deadlines
+ */
+int64_t systime_earlier(int64_t a_us, int64_t b_us);
+
+/**
+ * @brief FreeRTOS timeout that does not end before a deadline
+ *
+ * A blocking call with a timeout of n ticks may return up to one tick
+ * early, since the current tick has partly elapsed. The result is
+ * rounded up by one tick to make up for that, so a task waiting for a
+ * deadline wakes once, after it.
+ *
+ * @return Ticks to wait (0 if expired), or portMAX_DELAY for SYSTIME_NEVER
+ */
+TickType_t systime_ticks_until(int64_t deadline_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SYSTIME_H
@@ -0,0 +1,151 @@
+/**
+ * @file telemetry.c
+ * @brief Device telemetry snapshot and its CBOR encoding
+ *
+ * The encoder writes each field as it goes, with no intermediate text
+ * and no division: a CBOR unsigned integer is a type byte followed by
+ * 0, 1, 2 or 4 big-endian bytes.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#include "telemetry.h"
+#include "button.h"
+#include "latency.h"
+#include "led.h"
+#include "systime.h"
+#include "timer.h"
+#include "ws2812_control.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include <inttypes.h>
+#include <stdio.h>
+
+static const char *TAG = "telemetry";
+
+// CBOR major types, in the top three bits of the initial byte
+#define CBOR_UNSIGNED 0x00
+#define CBOR_MAP 0xA0
+
+// Additional information values for 1, 2 and 4 byte arguments
+#define CBOR_ARG_1 24
+#define CBOR_ARG_2 25
+#define CBOR_ARG_4 26
+
+// Number of messages timed by the benchmark
+#define BENCHMARK_MESSAGES 200
+
+/**
+ * @brief Write a CBOR initial byte with its argument
+ *
+ * @return Number of bytes written
+ */
+static size_t cbor_put_head(uint8_t *out, uint8_t major, uint32_t value)
+{
+    if (value < CBOR_ARG_1) {
+        out[0] = major | (uint8_t)value;
+        return 1;
+    }
+    if (value <= 0xFF) {
+        out[0] = major | CBOR_ARG_1;
+        out[1] = (uint8_t)value;
+        return 2;
+    }
+    if (value <= 0xFFFF) {
+        out[0] = major | CBOR_ARG_2;
+        out[1] = (uint8_t)(value >> 8);
+        out[2] = (uint8_t)value;
+        return 3;
+    }
+    out[0] = major | CBOR_ARG_4;
+    out[1] = (uint8_t)(value >> 24);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 8);
+    out[4] = (uint8_t)value;
+    return 5;
+}
+
+_Static_assert(TELEMETRY_KEY_COUNT < CBOR_ARG_1, "map header and keys must fit in one byte");
+
+void telemetry_capture(telemetry_snapshot_t *snapshot)
+{
+    button_stats_t button;
+    led_render_stats_t render;
+    ws2812_stats_t ws2812;
+    // Too big for the caller's stack
+    static latency_stats_t latency;
+    button_get_stats(&button);
+    led_get_render_stats(&render);
+    ws2812_get_stats(&ws2812);
+    latency_get_stats(&latency);
+    const latency_histogram_t *end_to_end = &latency.stages[LATENCY_EDGE_TO_FRAME];
+
+    uint32_t progress = 0;
+    int64_t start_us, duration_us;
+    if (timer_get_run(&start_us, &duration_us) && duration_us > 0) {
+        int64_t elapsed_us = duration_us - systime_us_until(start_us + duration_us);
+        progress = (uint32_t)(elapsed_us * TELEMETRY_PROGRESS_FULL / duration_us);
+    }
+
+    uint32_t *values = snapshot->values;
+    values[TELEMETRY_KEY_UPTIME_MS] = (uint32_t)(systime_now_us() / SYSTIME_US_PER_MS);
+    values[TELEMETRY_KEY_STATE] = (uint32_t)timer_get_state();
+    values[TELEMETRY_KEY_PROGRESS] = progress;
+    values[TELEMETRY_KEY_REMAINING_S] = timer_get_remaining_seconds();
+    values[TELEMETRY_KEY_LED_FRAMES] = render.frames;
+    values[TELEMETRY_KEY_WS2812_SENT] = ws2812.frames_sent;
+    values[TELEMETRY_KEY_WS2812_SKIPPED] = ws2812.frames_skipped;
+    values[TELEMETRY_KEY_PRESSES] = button.presses;
+    values[TELEMETRY_KEY_LATENCY_AVG_US] =
+        end_to_end->count > 0 ? (uint32_t)(end_to_end->total_us / end_to_end->count) : 0;
+    values[TELEMETRY_KEY_LATENCY_MAX_US] = end_to_end->max_us;
+}
+
+size_t telemetry_encode(const telemetry_snapshot_t *snapshot, uint8_t *out)
+{
+    size_t length = cbor_put_head(out, CBOR_MAP, TELEMETRY_KEY_COUNT);
+    for (uint32_t key = 0; key < TELEMETRY_KEY_COUNT; key++) {
+        out[length++] = CBOR_UNSIGNED | (uint8_t)key;
+        length += cbor_put_head(&out[length], CBOR_UNSIGNED, snapshot->values[key]);
+    }
+    return length;
+}
+
+void telemetry_benchmark(void)
+{
+    telemetry_snapshot_t snapshot;
+    telemetry_capture(&snapshot);
+
+    // Previous path: the sensor JSON message, formatted with snprintf()
+    // and soft-float %.2f into a 512-byte stack buffer
+    volatile float temp_c = 23.45f;
+    volatile float humidity = 41.7f;
+    char json[512];
+    int json_length = 0;
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < BENCHMARK_MESSAGES; i++) {
+        json_length = snprintf(json, sizeof(json),
+            "{\"ens210\":{\"status\":%u,\"temp\":%.2f,\"humidity\":%.2f},"
+            "\"ens16x\":{\"status\":\"%s\",\"etvoc\":%d,\"eco2\":%d,\"aqi\":%d}}\n",
+            0u, temp_c, humidity, "OK", 120, 650, 2);
+    }
+    uint32_t json_cycles = esp_cpu_get_cycle_count() - start;
+
+    // CBOR path; the uptime changes so every message is encoded afresh
+    uint8_t cbor[TELEMETRY_MESSAGE_MAX];
+    volatile uint8_t sink = 0;
+    size_t cbor_length = 0;
+    start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < BENCHMARK_MESSAGES; i++) {
+        snapshot.values[TELEMETRY_KEY_UPTIME_MS] += 10;
+        cbor_length = telemetry_encode(&snapshot, cbor);
+        sink = cbor[cbor_length - 1];
+    }
+    uint32_t cbor_cycles = esp_cpu_get_cycle_count() - start;
+    (void)sink;
+
+    ESP_LOGI(TAG, "Telemetry per message: snprintf JSON %" PRIu32 " cycles (%d bytes), CBOR %" PRIu32
+             " cycles (%u bytes)", json_cycles / BENCHMARK_MESSAGES, json_length,
+             cbor_cycles / BENCHMARK_MESSAGES, (unsigned)cbor_length);
+}
@@ -0,0 +1,78 @@
+/**
+ * @file telemetry.h
+ * @brief Device telemetry snapshot and its CBOR encoding
+ *
+ * A telemetry message is a CBOR map (RFC 8949) from the small integer
+ * keys below to unsigned integers, e.g. 30 to 40 bytes for a running
+ * timer. Integer keys and values keep both the encoder and the message
+ * small: there is no floating point and no text.
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Map keys, one per snapshot field
+typedef enum {
+    TELEMETRY_KEY_UPTIME_MS = 0,
+    TELEMETRY_KEY_STATE,            // timer_state_t
+    TELEMETRY_KEY_PROGRESS,         // Run progress, 0-10000
+    TELEMETRY_KEY_REMAINING_S,
+    TELEMETRY_KEY_LED_FRAMES,       // Frames rendered
+    TELEMETRY_KEY_WS2812_SENT,      // Frames sent to the LEDs
+    TELEMETRY_KEY_WS2812_SKIPPED,   // Frames not sent because nothing changed
+    TELEMETRY_KEY_PRESSES,
+    TELEMETRY_KEY_LATENCY_AVG_US,   // Button edge to LED frame
+    TELEMETRY_KEY_LATENCY_MAX_US,
+    TELEMETRY_KEY_COUNT,
+} telemetry_key_t;
+
+// Progress of a complete run
+#define TELEMETRY_PROGRESS_FULL 10000
+
+// Worst-case encoded size: map header, then a 1-byte key and a 5-byte value per field
+#define TELEMETRY_MESSAGE_MAX (1 + 6 * TELEMETRY_KEY_COUNT)
+
+// Device state at one moment, indexed by telemetry_key_t
+typedef struct {
+    uint32_t values[TELEMETRY_KEY_COUNT];
+} telemetry_snapshot_t;
+
+/**
+ * @brief Take a snapshot of the device state
+ *
+ * @param snapshot Filled with the current values
+ */
+void telemetry_capture(telemetry_snapshot_t *snapshot);
+
+/**
+ * @brief Encode a snapshot as a CBOR map
+ *
+ * @param snapshot Values to encode
+ * @param out Encoded message, at least TELEMETRY_MESSAGE_MAX bytes
+ * @return Number of bytes written
+ */
+size_t telemetry_encode(const telemetry_snapshot_t *snapshot, uint8_t *out);
+
+/**
+ * @brief Benchmark the encoder
+ *
+ * Logs the cycles per message of telemetry_encode() and of the
+ * snprintf() JSON sensor message it replaces.
+ */
+void telemetry_benchmark(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TELEMETRY_H
@@ -13,8 +13,9 @@
 #include "button.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
-#include <math.h>
+#include "freertos/semphr.h"
+#include "systime.h"
+#include <inttypes.h>
 
 static const char *TAG = "timer";
 
@@ -27,113 +28,254 @@ static const uint32_t timer_durations[NUM_BUTTONS] = {
     TIMER_DURATION_60MIN  // Button 4: 60 minutes
 };
 
+// Guards everything below; buttons, the serial port and the main loop
+// all change the timer, and the 64-bit times are not written atomically
+static SemaphoreHandle_t timer_mutex = NULL;
+
 // Timer state
 static timer_state_t timer_state = TIMER_STATE_IDLE;
 static uint32_t timer_duration_seconds = 0;
-static uint32_t timer_start_time_ticks = 0;
-static uint32_t grace_period_start_ticks = 0;
-static uint32_t alert_start_ticks = 0;
-static float current_progress = 0.0f;
-static float target_progress = 0.0f;
+static int64_t timer_start_us = 0;
+static int64_t grace_period_start_us = 0;
+static int64_t alert_start_us = 0;
+static int64_t next_jingle_us = 0;          // When the alert jingle is due again
 
-// Smooth transition speed (same as LED transition algorithm)
-#define TRANSITION_SPEED 0.02f
+// Run state before the last tap, restored if the tap is retracted
+static struct {
+    bool valid;
+    timer_state_t state;
+    uint32_t duration_seconds;
+    int64_t start_us;
+} tap_undo = {0};
 
 void timer_init(void)
 {
+    if (timer_mutex == NULL) {
+        timer_mutex = xSemaphoreCreateMutex();
+        if (timer_mutex == NULL) {
+            ESP_LOGE(TAG, "Failed to create timer mutex");
+            return;
+        }
+    }
+    xSemaphoreTake(timer_mutex, portMAX_DELAY);
     timer_state = TIMER_STATE_IDLE;
     timer_duration_seconds = 0;
-    timer_start_time_ticks = 0;
-    grace_period_start_ticks = 0;
-    alert_start_ticks = 0;
-    current_progress = 0.0f;
-    target_progress = 0.0f;
+    timer_start_us = 0;
+    grace_period_start_us = 0;
+    alert_start_us = 0;
+    xSemaphoreGive(timer_mutex);
     ESP_LOGI(TAG, "Timer system initialized");
 }
 
-bool timer_start(uint32_t duration_minutes)
+/**
+ * @brief Check a duration against the button presets
+ */
+static bool is_valid_duration(uint32_t duration_minutes)
 {
-    // Validate duration
-    bool valid_duration = false;
     for (int i = 0; i < NUM_BUTTONS; i++) {
         if (timer_durations[i] == duration_minutes) {
-            valid_duration = true;
-            break;
+            return true;
         }
     }
+    return false;
+}
+
+/**
+ * @brief Stop the timer; caller holds timer_mutex
+ */
+static void stop_locked(void)
+{
+    if (timer_state == TIMER_STATE_IDLE) {
+        return;
+    }
     
-    if (!valid_duration) {
-        ESP_LOGE(TAG, "Invalid timer duration: %lu minutes", duration_minutes);
+    timer_state = TIMER_STATE_IDLE;
+    timer_duration_seconds = 0;
+    timer_start_us = 0;
+    grace_period_start_us = 0;
+    alert_start_us = 0;
+    
+    ESP_LOGI(TAG, "Timer stopped");
+}
+
+/**
+ * @brief Start a new run; caller holds timer_mutex
+ */
+static bool start_locked(uint32_t duration_minutes)
+{
+    // Validate duration
+    if (!is_valid_duration(duration_minutes)) {
+        ESP_LOGE(TAG, "Invalid timer duration: %" PRIu32 " minutes", duration_minutes);
         return false;
     }
     
     // Stop any existing timer
-    timer_stop();
+    stop_locked();
     
     // Start new timer
     timer_duration_seconds = duration_minutes * 60;
-    timer_start_time_ticks = xTaskGetTickCount();
+    timer_start_us = systime_now_us();
     timer_state = TIMER_STATE_RUNNING;
-    current_progress = 0.0f;
-    target_progress = 0.0f;
     
-    ESP_LOGI(TAG, "Timer started: %lu minutes (%lu seconds)", duration_minutes, timer_duration_seconds);
+    ESP_LOGI(TAG, "Timer started: %" PRIu32 " minutes (%" PRIu32 " seconds)", duration_minutes, timer_duration_seconds);
     return true;
 }
 
+/**
+ * @brief Stop the timer after a button press; caller holds timer_mutex
+ */
+static void reset_locked(void)
+{
+    stop_locked();
+    ESP_LOGI(TAG, "Timer reset");
+}
+
+bool timer_start(uint32_t duration_minutes)
+{
+    xSemaphoreTake(timer_mutex, portMAX_DELAY);
+    bool started = start_locked(duration_minutes);
+    xSemaphoreGive(timer_mutex);
+    return started;
+}
+
 void timer_stop(void)
 {
-    if (timer_state == TIMER_STATE_IDLE) {
-        return;
-    }
-    
-    timer_state = TIMER_STATE_IDLE;
-    timer_duration_seconds = 0;
-    timer_start_time_ticks = 0;
-    grace_period_start_ticks = 0;
-    alert_start_ticks = 0;
-    current_progress = 0.0f;
-    target_progress = 0.0f;
-    
-    ESP_LOGI(TAG, "Timer stopped");
+    xSemaphoreTake(timer_mutex, portMAX_DELAY);
+    stop_locked();
+    xSemaphoreGive(timer_mutex);
 }
 
 void timer_reset(void)
 {
-    timer_stop();
-    ESP_LOGI(TAG, "Timer reset");
+    xSemaphoreTake(timer_mutex, portMAX_DELAY);
+    reset_locked();
+    xSemaphoreGive(timer_mutex);
 }
 
 timer_state_t timer_get_state(void)
 {
-    return timer_state;
+    xSemaphoreTake(timer_mutex, portMAX_DELAY);
+    timer_state_t state = timer_state;
+    xSemaphoreGive(timer_mutex);
+    return state;
+}
+
+bool timer_get_run(int64_t *start_us, int64_t *duration_us)
+{
+    xSemaphoreTake(timer_mutex, portMAX_DELAY);
+    bool running = timer_state == TIMER_STATE_RUNNING;
+    if (running) {
+        *start_us = timer_start_us;
+        *duration_us = timer_duration_seconds * SYSTIME_US_PER_SEC;
+    }
+    xSemaphoreGive(timer_mutex);
+    return running;
 }
 
-float timer_get_progress(void)
+void timer_get_snapshot(timer_snapshot_t *snapshot)
 {
-    return current_progress;
+    xSemaphoreTake(timer_mutex, portMAX_DELAY);
+    snapshot->state = timer_state;
+    snapshot->start_us = 0;
+    snapshot->duration_us = 0;
+    if (timer_state == TIMER_STATE_RUNNING) {
+        snapshot->start_us = timer_start_us;
+        snapshot->duration_us = timer_duration_seconds * SYSTIME_US_PER_SEC;
+    }
+    xSemaphoreGive(timer_mutex);
 }
 
 uint32_t timer_get_remaining_seconds(void)
 {
-    if (timer_state != TIMER_STATE_RUNNING) {
+    int64_t start_us;
+    int64_t duration_us;
+    if (!timer_get_run(&start_us, &duration_us)) {
         return 0;
     }
     
-    TickType_t current_ticks = xTaskGetTickCount();
-    TickType_t elapsed_ticks = current_ticks - timer_start_time_ticks;
-    uint32_t elapsed_seconds = (elapsed_ticks * 1000) / configTICK_RATE_HZ / 1000;
+    int64_t elapsed_seconds = (systime_now_us() - start_us) / SYSTIME_US_PER_SEC;
+    int64_t duration_seconds = duration_us / SYSTIME_US_PER_SEC;
     
-    if (elapsed_seconds >= timer_duration_seconds) {
+    if (elapsed_seconds >= duration_seconds) {
         return 0;
     }
     
-    return timer_duration_seconds - elapsed_seconds;
+    return (uint32_t)(duration_seconds - elapsed_seconds);
+}
+
+/**
+ * @brief End of the running timer
+ */
+static int64_t run_end_us(void)
+{
+    return timer_start_us + timer_duration_seconds * SYSTIME_US_PER_SEC;
+}
+
+/**
+ * @brief End of the grace period
+ */
+static int64_t grace_period_end_us(void)
+{
+    return grace_period_start_us + GRACE_PERIOD_SECONDS * SYSTIME_US_PER_SEC;
+}
+
+/**
+ * @brief End of the alert
+ */
+static int64_t alert_end_us(void)
+{
+    return alert_start_us + ALERT_DURATION_SECONDS * SYSTIME_US_PER_SEC;
+}
+
+/**
+ * @brief Pick up a run started before a reset; caller holds timer_mutex
+ */
+static timer_state_t resume_locked(int64_t start_us, uint32_t duration_minutes)
+{
+    if (!is_valid_duration(duration_minutes)) {
+        ESP_LOGE(TAG, "Invalid timer duration: %" PRIu32 " minutes", duration_minutes);
+        return timer_state;
+    }
+    
+    stop_locked();
+    
+    int64_t now_us = systime_now_us();
+    timer_duration_seconds = duration_minutes * 60;
+    timer_start_us = start_us;
+    grace_period_start_us = run_end_us();
+    alert_start_us = grace_period_end_us();
+    next_jingle_us = now_us;
+    
+    // Pick up in whichever phase the session would be in by now
+    if (now_us < grace_period_start_us) {
+        timer_state = TIMER_STATE_RUNNING;
+    } else if (now_us < alert_start_us) {
+        timer_state = TIMER_STATE_COMPLETED;
+    } else if (now_us < alert_end_us()) {
+        timer_state = TIMER_STATE_ALERTING;
+    } else {
+        timer_duration_seconds = 0;
+        ESP_LOGI(TAG, "Session is already over, staying idle");
+        return timer_state;
+    }
+    
+    ESP_LOGI(TAG, "Timer resumed: %" PRIu32 " minutes, %" PRId64 " s elapsed, state %d",
+             duration_minutes, (int64_t)((now_us - start_us) / SYSTIME_US_PER_SEC), timer_state);
+    return timer_state;
+}
+
+timer_state_t timer_resume(int64_t start_us, uint32_t duration_minutes)
+{
+    xSemaphoreTake(timer_mutex, portMAX_DELAY);
+    timer_state_t state = resume_locked(start_us, duration_minutes);
+    xSemaphoreGive(timer_mutex);
+    return state;
 }
 
 void timer_update(void)
 {
-    TickType_t current_ticks = xTaskGetTickCount();
+    xSemaphoreTake(timer_mutex, portMAX_DELAY);
+    int64_t now_us = systime_now_us();
     
     switch (timer_state) {
         case TIMER_STATE_IDLE:
@@ -141,46 +283,24 @@ void timer_update(void)
             break;
             
         case TIMER_STATE_RUNNING: {
-            // Calculate elapsed time in ticks for smooth progress
-            TickType_t elapsed_ticks = current_ticks - timer_start_time_ticks;
-            uint32_t total_duration_ticks = pdMS_TO_TICKS(timer_duration_seconds * 1000);
-            
-            // Calculate target progress (0.0 to 1.0)
-            if (elapsed_ticks >= total_duration_ticks) {
-                target_progress = 1.0f;
+            // Progress is derived from the start time by the display
+            // (timer_get_run); only completion is checked here
+            if (now_us >= run_end_us()) {
                 // Timer completed
                 timer_state = TIMER_STATE_COMPLETED;
-                grace_period_start_ticks = current_ticks;
+                grace_period_start_us = now_us;
                 ESP_LOGI(TAG, "Timer completed");
-            } else {
-                // Ensure we have at least a tiny bit of progress to trigger "on" state
-                if (elapsed_ticks == 0) elapsed_ticks = 1; 
-                target_progress = (float)elapsed_ticks / (float)total_duration_ticks;
             }
-            
-            // Smoothly transition current_progress towards target_progress
-            float progress_diff = target_progress - current_progress;
-            current_progress += progress_diff * TRANSITION_SPEED;
-            
-            // Clamp to valid range
-            if (current_progress < 0.0f) current_progress = 0.0f;
-            if (current_progress > 1.0f) current_progress = 1.0f;
             break;
         }
         
         case TIMER_STATE_COMPLETED:
-            // Keep progress at 1.0
-            current_progress = 1.0f;
-            target_progress = 1.0f;
-            
             // Check if grace period has expired
-            TickType_t grace_elapsed_ticks = current_ticks - grace_period_start_ticks;
-            uint32_t grace_elapsed_seconds = (grace_elapsed_ticks * 1000) / configTICK_RATE_HZ / 1000;
-            
-            if (grace_elapsed_seconds >= GRACE_PERIOD_SECONDS) {
+            if (now_us >= grace_period_end_us()) {
                 // Grace period expired, start alerting
                 timer_state = TIMER_STATE_ALERTING;
-                alert_start_ticks = current_ticks;
+                alert_start_us = now_us;
+                next_jingle_us = now_us;
                 ESP_LOGI(TAG, "Grace period expired, starting alert");
             }
             break;
@@ -193,58 +313,137 @@ void timer_update(void)
             
         case TIMER_STATE_ALERTING: {
             // Check if alert duration has expired
-            TickType_t alert_elapsed_ticks = current_ticks - alert_start_ticks;
-            uint32_t alert_elapsed_seconds = (alert_elapsed_ticks * 1000) / configTICK_RATE_HZ / 1000;
-            
-            if (alert_elapsed_seconds >= ALERT_DURATION_SECONDS) {
+            if (now_us >= alert_end_us()) {
                 // Alert duration expired, stop alerting
                 timer_state = TIMER_STATE_IDLE;
-                current_progress = 0.0f;
-                target_progress = 0.0f;
                 ESP_LOGI(TAG, "Alert duration expired, timer idle");
             }
             break;
         }
     }
+    xSemaphoreGive(timer_mutex);
 }
 
-void timer_handle_button(uint8_t button_id, bool is_long_press)
+/**
+ * @brief Next time timer_update() has work; caller holds timer_mutex
+ */
+static int64_t next_deadline_locked(void)
 {
-    if (button_id >= NUM_BUTTONS) {
-        ESP_LOGW(TAG, "Invalid button ID: %d", button_id);
+    switch (timer_state) {
+        case TIMER_STATE_RUNNING:
+            // The progress bar is a ramp the LED task follows by itself
+            return run_end_us();
+            
+        case TIMER_STATE_COMPLETED:
+            return grace_period_end_us();
+            
+        case TIMER_STATE_ALERTING:
+            return systime_earlier(alert_end_us(), next_jingle_us);
+            
+        default:
+            // Idle: only a button press changes anything
+            return SYSTIME_NEVER;
+    }
+}
+
+int64_t timer_get_next_deadline_us(void)
+{
+    xSemaphoreTake(timer_mutex, portMAX_DELAY);
+    int64_t deadline_us = next_deadline_locked();
+    xSemaphoreGive(timer_mutex);
+    return deadline_us;
+}
+
+bool timer_alert_jingle_due(void)
+{
+    xSemaphoreTake(timer_mutex, portMAX_DELAY);
+    bool due = timer_state == TIMER_STATE_ALERTING && systime_expired(next_jingle_us);
+    xSemaphoreGive(timer_mutex);
+    return due;
+}
+
+void timer_alert_jingle_played(int64_t jingle_end_us)
+{
+    if (jingle_end_us == SYSTIME_NEVER) {
+        jingle_end_us = systime_now_us();
+    }
+    xSemaphoreTake(timer_mutex, portMAX_DELAY);
+    next_jingle_us = jingle_end_us + ALERT_JINGLE_INTERVAL_MS * SYSTIME_US_PER_MS;
+    xSemaphoreGive(timer_mutex);
+}
+
+/**
+ * @brief Remember the run state before a tap, so it can be retracted
+ */
+static void save_tap_undo(void)
+{
+    tap_undo.valid = true;
+    tap_undo.state = timer_state;
+    tap_undo.duration_seconds = timer_duration_seconds;
+    tap_undo.start_us = timer_start_us;
+}
+
+/**
+ * @brief Act on a button event; caller holds timer_mutex
+ */
+static void handle_button_locked(uint8_t button_id, button_press_type_t press_type)
+{    
+    if (press_type == BUTTON_PRESS_RETRACT) {
+        // Put back the run the last tap started or stopped
+        if (tap_undo.valid) {
+            timer_state = tap_undo.state;
+            timer_duration_seconds = tap_undo.duration_seconds;
+            timer_start_us = tap_undo.start_us;
+            ESP_LOGI(TAG, "Tap retracted");
+        }
+        tap_undo.valid = false;
         return;
     }
+    tap_undo.valid = false;
     
     switch (timer_state) {
         case TIMER_STATE_IDLE:
-            // Short press: start timer with button's duration
-            if (!is_long_press) {
-                uint32_t duration = timer_durations[button_id];
-                timer_start(duration);
-            }
-            // Long press: no action in idle state
-            break;
-            
         case TIMER_STATE_RUNNING:
-            // Short press: stop/reset timer
-            if (!is_long_press) {
-                timer_stop();
+            if (press_type == BUTTON_PRESS_SHORT) {
+                // Tap: start timer with button's duration from idle, stop it while running
+                save_tap_undo();
+                if (timer_state == TIMER_STATE_IDLE) {
+                    start_locked(timer_durations[button_id]);
+                } else {
+                    stop_locked();
+                }
+            } else if (press_type == BUTTON_PRESS_DOUBLE) {
+                // Double tap: start over with the button's duration
+                start_locked(timer_durations[button_id]);
+            } else if (press_type == BUTTON_PRESS_CHORD) {
+                stop_locked();
             }
-            // Long press: no action while running
+            // Long press and repeat: no action
             break;
             
         case TIMER_STATE_COMPLETED:
         case TIMER_STATE_GRACE_PERIOD:
             // Any button press during grace period: reset timer (no piezo)
-            timer_reset();
+            reset_locked();
             ESP_LOGI(TAG, "Timer reset during grace period (no alert)");
             break;
             
         case TIMER_STATE_ALERTING:
             // Any button press during alerting: stop alert and reset
-            timer_reset();
+            reset_locked();
             ESP_LOGI(TAG, "Timer reset during alert");
             break;
     }
 }
 
+void timer_handle_button(uint8_t button_id, button_press_type_t press_type)
+{
+    if (button_id >= NUM_BUTTONS) {
+        ESP_LOGW(TAG, "Invalid button ID: %d", button_id);
+        return;
+    }
+    
+    xSemaphoreTake(timer_mutex, portMAX_DELAY);
+    handle_button_locked(button_id, press_type);
+    xSemaphoreGive(timer_mutex);
+}
@@ -4,6 +4,8 @@
  * 
  * This header file defines the interface for the Pomodoro timer system
  * with state machine, progress tracking, and button integration.
+ * All functions may be called from any task except timer_init(), which
+ * must run before the others.
  * 
  * @author StuckAtPrototype, LLC
  * @version 1.0
@@ -14,6 +16,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "button.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -41,6 +44,16 @@ typedef enum {
 // Alert duration (1 minute = 60 seconds)
 #define ALERT_DURATION_SECONDS 60
 
+// Pause between alert jingles
+#define ALERT_JINGLE_INTERVAL_MS 2000
+
+// Timer state and run, read together
+typedef struct {
+    timer_state_t state;
+    int64_t start_us;       // Start of the run while RUNNING, else 0
+    int64_t duration_us;    // Its duration while RUNNING, else 0
+} timer_snapshot_t;
+
 /**
  * @brief Initialize the timer system
  */
@@ -54,6 +67,19 @@ void timer_init(void);
  */
 bool timer_start(uint32_t duration_minutes);
 
+/**
+ * @brief Resume a timer that was started before a reset
+ *
+ * The timer picks up in whichever state the session would have reached by
+ * now: running, completed (grace period) or alerting. A session that has
+ * already run through its alert leaves the timer idle.
+ *
+ * @param start_us Session start (systime_now_us() timebase, may be negative)
+ * @param duration_minutes Duration in minutes, one of the button presets
+ * @return Resulting timer state
+ */
+timer_state_t timer_resume(int64_t start_us, uint32_t duration_minutes);
+
 /**
  * @brief Stop and reset the timer
  */
@@ -72,11 +98,27 @@ void timer_reset(void);
 timer_state_t timer_get_state(void);
 
 /**
- * @brief Get current timer progress (0.0 to 1.0)
+ * @brief Get the start time and duration of the running timer
+ * 
+ * This is the timer's only progress output: progress at any instant is
+ * exactly (now - start) / duration, evaluated by the display for each
+ * frame, so the timer does not need to be polled or smoothed.
  * 
- * @return Progress value from 0.0 (start) to 1.0 (complete)
+ * @param start_us Set to the start time (systime_now_us() timebase)
+ * @param duration_us Set to the timer duration
+ * @return true if the timer is running, false otherwise (outputs untouched)
  */
-float timer_get_progress(void);
+bool timer_get_run(int64_t *start_us, int64_t *duration_us);
+
+/**
+ * @brief Get the state and the run in one consistent read
+ *
+ * For callers that need both: separate timer_get_state() and
+ * timer_get_run() calls can straddle a start or stop from another task.
+ *
+ * @param snapshot Filled with the current state and run
+ */
+void timer_get_snapshot(timer_snapshot_t *snapshot);
 
 /**
  * @brief Get remaining time in seconds
@@ -94,12 +136,46 @@ uint32_t timer_get_remaining_seconds(void);
 void timer_update(void);
 
 /**
- * @brief Handle button press event
+ * @brief Get when timer_update() next has work to do
+ * 
+ * The deadline is timer completion, grace period expiry, or the earlier
+ * of alert expiry and the next alert jingle. Between deadlines the state
+ * machine has nothing to do, so callers can sleep until then or until a
+ * button event.
+ * 
+ * @return Deadline (systime_now_us() timebase), or SYSTIME_NEVER
+ */
+int64_t timer_get_next_deadline_us(void);
+
+/**
+ * @brief Check whether the alert jingle should be played now
+ * 
+ * @return true while alerting once the previous jingle is
+ *         ALERT_JINGLE_INTERVAL_MS old (immediately when the alert starts)
+ */
+bool timer_alert_jingle_due(void);
+
+/**
+ * @brief Record that the alert jingle was handled, scheduling the next one
+ * 
+ * @param jingle_end_us When the jingle finishes playing (systime_now_us()
+ *                      timebase); the next one is due ALERT_JINGLE_INTERVAL_MS
+ *                      later
+ */
+void timer_alert_jingle_played(int64_t jingle_end_us);
+
+/**
+ * @brief Handle button gesture
+ * 
+ * A tap starts the button's duration from idle and stops a running
+ * timer; a double tap (re)starts the button's duration in either state;
+ * a chord stops the timer. Any gesture ends a grace period or alert.
+ * BUTTON_PRESS_RETRACT undoes the start or stop of the last tap.
  * 
  * @param button_id Button ID (0-4)
- * @param is_long_press true if long press, false if short press
+ * @param press_type Gesture
  */
-void timer_handle_button(uint8_t button_id, bool is_long_press);
+void timer_handle_button(uint8_t button_id, button_press_type_t press_type);
 
 #ifdef __cplusplus
 }
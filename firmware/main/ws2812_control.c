@@ -15,12 +15,18 @@
 #include "esp_err.h"
 #include "esp_check.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_attr.h"
 #include "esp_log.h"
+#include <stdbool.h>
+#include <string.h>
 
 // Hardware configuration
 #define LED_RMT_TX_GPIO         25  // GPIO pin for LED data output
-#define BITS_PER_LED_CMD        24  // 24 bits per LED (8 bits each for R, G, B)
+#define BITS_PER_LED_CMD        24  // 24 bits per LED (8 bits each for G, R, B)
 #define LED_BUFFER_ITEMS        (NUM_LEDS * BITS_PER_LED_CMD)
+#define LED_FRAME_BYTES         (NUM_LEDS * sizeof(ws2812_pixel_t))
+#define LED_NUM_BUFFERS         2   // Frame N+1 is filled while frame N is on the wire
 
 // WS2812 timing parameters (assuming 10MHz RMT resolution)
 #define T0H     3  // 0 bit high time (0.3μs)
@@ -33,28 +39,25 @@ static const char *TAG = "NeoPixel WS2812 Driver";
 // Global variables for RMT control
 static rmt_channel_handle_t led_chan = NULL;      // RMT channel handle
 static rmt_encoder_handle_t led_encoder = NULL;   // RMT encoder handle
-static uint8_t led_data_buffer[NUM_LEDS * 3];     // Buffer for LED data (3 bytes per LED: RGB)
+static ws2812_pixel_t led_data_buffers[LED_NUM_BUFFERS][NUM_LEDS]; // Wire buffers (3 bytes per LED: GRB)
+static uint8_t led_front_buffer = 0;              // Buffer holding the most recently submitted frame
+static bool led_frame_claimed = false;            // Back buffer handed out by ws2812_begin_frame()
+static bool led_data_valid = false;               // Front buffer holds the last transmitted frame
+static bool led_chan_enabled = false;             // RMT channel enabled (holds its PM lock)
+static SemaphoreHandle_t led_free_buffers = NULL; // Counts wire buffers not owned by the RMT driver
+static ws2812_stats_t ws2812_stats = {0};         // Transmitted/skipped frame counters
 
 /**
- * @brief RMT encoder wrapper function
+ * @brief RMT transmit-done callback
  * 
- * This function wraps the bytes encoder for RMT transmission.
- * It's used internally by the RMT driver to encode data for transmission.
- * 
- * @param encoder RMT encoder handle
- * @param channel RMT channel handle
- * @param primary_data Data to encode
- * @param data_size Size of data to encode
- * @param ret_state Return state pointer
- * @return Number of encoded symbols
+ * Runs in ISR context when a frame has left the wire and hands its
+ * buffer back to ws2812_begin_frame().
  */
-static size_t ws2812_rmt_encode(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state)
+static bool IRAM_ATTR ws2812_on_trans_done(rmt_channel_handle_t channel, const rmt_tx_done_event_data_t *edata, void *user_ctx)
 {
-    rmt_encoder_handle_t bytes_encoder = (rmt_encoder_handle_t)encoder;
-    rmt_encode_state_t session_state = 0;
-    size_t encoded_symbols = bytes_encoder->encode(bytes_encoder, channel, primary_data, data_size, &session_state);
-    *ret_state = session_state;
-    return encoded_symbols;
+    BaseType_t high_task_wakeup = pdFALSE;
+    xSemaphoreGiveFromISR(led_free_buffers, &high_task_wakeup);
+    return high_task_wakeup == pdTRUE;
 }
 
 /**
@@ -78,6 +81,17 @@ esp_err_t ws2812_control_init(void)
     };
     ESP_RETURN_ON_ERROR(rmt_new_tx_channel(&tx_chan_config, &led_chan), TAG, "Failed to create RMT TX channel");
 
+    led_free_buffers = xSemaphoreCreateCounting(LED_NUM_BUFFERS, LED_NUM_BUFFERS);
+    if (led_free_buffers == NULL) {
+        ESP_LOGE(TAG, "Failed to create buffer semaphore");
+        return ESP_ERR_NO_MEM;
+    }
+
+    rmt_tx_event_callbacks_t callbacks = {
+            .on_trans_done = ws2812_on_trans_done,
+    };
+    ESP_RETURN_ON_ERROR(rmt_tx_register_event_callbacks(led_chan, &callbacks, NULL), TAG, "Failed to register RMT callbacks");
+
     ESP_LOGI(TAG, "Install led strip encoder");
     rmt_bytes_encoder_config_t bytes_encoder_config = {
             .bit0 = {
@@ -98,28 +112,58 @@ esp_err_t ws2812_control_init(void)
 
     ESP_LOGI(TAG, "Enable RMT TX channel");
     ESP_RETURN_ON_ERROR(rmt_enable(led_chan), TAG, "Failed to enable RMT channel");
+    led_chan_enabled = true;
 
     return ESP_OK;
 }
 
 /**
- * @brief Write LED data to WS2812 strip
+ * @brief Claim a wire buffer for the next frame
  * 
- * This function takes a structure containing LED color data and transmits it
- * to the WS2812 LED strip using the RMT peripheral. It converts the 24-bit
- * color values to the proper byte format and sends them via RMT.
+ * Frames complete in order, so once one buffer is free it is always the
+ * one not holding the most recent frame.
+ * 
+ * @return Buffer of NUM_LEDS pixels, or NULL on timeout
+ */
+ws2812_pixel_t *ws2812_begin_frame(void)
+{
+    if (!led_frame_claimed) {
+        if (xSemaphoreTake(led_free_buffers, 0) != pdTRUE) {
+            ws2812_stats.buffer_waits++;
+            if (xSemaphoreTake(led_free_buffers, pdMS_TO_TICKS(WS2812_BUFFER_TIMEOUT_MS)) != pdTRUE) {
+                ESP_LOGE(TAG, "Timed out waiting for a free LED buffer");
+                return NULL;
+            }
+        }
+        led_frame_claimed = true;
+    }
+
+    return led_data_buffers[led_front_buffer ^ 1];
+}
+
+/**
+ * @brief Transmit the frame claimed with ws2812_begin_frame()
+ * 
+ * This function queues the back buffer on the RMT peripheral exactly as
+ * the renderer wrote it and returns as soon as it is queued.
  * 
- * @param new_state Structure containing color data for all LEDs
  * @return ESP_OK on success, error code on failure
  */
-esp_err_t ws2812_write_leds(struct led_state new_state)
+esp_err_t ws2812_end_frame(void)
 {
-    // Convert 24-bit color values to RGB byte format
-    for (uint32_t led = 0; led < NUM_LEDS; led++) {
-        uint32_t bits_to_send = new_state.leds[led];
-        led_data_buffer[led * 3 + 0] = (bits_to_send >> 16) & 0xFF; // Red component
-        led_data_buffer[led * 3 + 1] = (bits_to_send >> 8) & 0xFF;  // Green component
-        led_data_buffer[led * 3 + 2] = bits_to_send & 0xFF;         // Blue component
+    if (!led_frame_claimed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    led_frame_claimed = false;
+
+    uint8_t back_buffer = led_front_buffer ^ 1;
+    const ws2812_pixel_t *frame = led_data_buffers[back_buffer];
+
+    // WS2812 pixels latch their last value, so an identical frame is a no-op
+    if (led_data_valid && memcmp(frame, led_data_buffers[led_front_buffer], LED_FRAME_BYTES) == 0) {
+        ws2812_stats.frames_skipped++;
+        xSemaphoreGive(led_free_buffers);
+        return ESP_OK;
     }
 
     // Configure transmission parameters
@@ -127,11 +171,78 @@ esp_err_t ws2812_write_leds(struct led_state new_state)
             .loop_count = 0,  // No looping
     };
 
-    // Transmit the LED data via RMT
-    ESP_RETURN_ON_ERROR(rmt_transmit(led_chan, led_encoder, led_data_buffer, sizeof(led_data_buffer), &tx_config), TAG, "Failed to transmit RMT data");
-    
-    // Wait for transmission to complete
-    ESP_RETURN_ON_ERROR(rmt_tx_wait_all_done(led_chan, portMAX_DELAY), TAG, "Failed to wait for RMT transmission to finish");
+    esp_err_t ret = ESP_OK;
+    if (!led_chan_enabled) {
+        ret = rmt_enable(led_chan);
+        if (ret != ESP_OK) {
+            xSemaphoreGive(led_free_buffers);
+            ESP_LOGE(TAG, "Failed to enable RMT channel: %s", esp_err_to_name(ret));
+            return ret;
+        }
+        led_chan_enabled = true;
+    }
+
+    // Queue the LED data on the RMT channel; the buffer is released by ws2812_on_trans_done()
+    ret = rmt_transmit(led_chan, led_encoder, frame, LED_FRAME_BYTES, &tx_config);
+    if (ret != ESP_OK) {
+        // The strip state is unknown now, make sure the next frame goes out
+        led_data_valid = false;
+        xSemaphoreGive(led_free_buffers);
+        ESP_LOGE(TAG, "Failed to transmit RMT data: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    led_front_buffer = back_buffer;
+    led_data_valid = true;
+    ws2812_stats.frames_sent++;
+    return ESP_OK;
+}
+
+/**
+ * @brief Wait until all submitted frames have been transmitted
+ * 
+ * @param timeout_ms Maximum time to wait in milliseconds (-1 waits forever)
+ * @return ESP_OK on success, ESP_ERR_TIMEOUT on timeout
+ */
+esp_err_t ws2812_wait_done(int timeout_ms)
+{
+    return rmt_tx_wait_all_done(led_chan, timeout_ms);
+}
 
+/**
+ * @brief Release the RMT channel while the strip is idle
+ * 
+ * @return ESP_OK on success, error code on failure
+ */
+esp_err_t ws2812_idle(void)
+{
+    if (!led_chan_enabled) {
+        return ESP_OK;
+    }
+
+    // Disabling the channel would cut off a frame still on the wire
+    esp_err_t ret = rmt_tx_wait_all_done(led_chan, WS2812_BUFFER_TIMEOUT_MS);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = rmt_disable(led_chan);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to disable RMT channel: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    led_chan_enabled = false;
     return ESP_OK;
 }
+
+/**
+ * @brief Get WS2812 transmission statistics
+ * 
+ * @param stats Pointer to structure to fill with the current counters
+ */
+void ws2812_get_stats(ws2812_stats_t *stats)
+{
+    if (stats != NULL) {
+        *stats = ws2812_stats;
+    }
+}
@@ -20,24 +20,38 @@
 // Hardware configuration
 #define NUM_LEDS	10   // Number of WS2812 LEDs in the strip
 
+// Longest time ws2812_begin_frame() waits for a wire buffer to come back
+#define WS2812_BUFFER_TIMEOUT_MS 20
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
- * @brief LED state structure
+ * @brief One pixel in WS2812 wire order
  * 
- * This structure defines the color state for all LEDs in the strip.
- * Each LED has a 32-bit value where only the lower 3 bytes are used:
- * - Byte 2: Red component (0-255)
- * - Byte 1: Green component (0-255)  
- * - Byte 0: Blue component (0-255)
+ * WS2812 LEDs expect green, then red, then blue, each MSB first. Frame
+ * buffers are arrays of NUM_LEDS of these, transmitted as-is, so the
+ * renderer writes the final bytes directly. Packed 32-bit colors used by
+ * the LED API follow the same order: 0x00GGRRBB.
+ */
+typedef struct {
+    uint8_t g;  // Green component (0-255), sent first
+    uint8_t r;  // Red component (0-255)
+    uint8_t b;  // Blue component (0-255), sent last
+} ws2812_pixel_t;
+
+/**
+ * @brief WS2812 transmission statistics
  * 
- * Note: WS2812 LEDs expect GRB format, not RGB format.
+ * Frames identical to the last transmitted one are not sent again,
+ * since WS2812 pixels hold their value until new data arrives.
  */
-struct led_state {
-    uint32_t leds[NUM_LEDS];    // Array of LED color values
-};
+typedef struct {
+    uint32_t frames_sent;     // Frames transmitted over RMT
+    uint32_t frames_skipped;  // Frames skipped because nothing changed
+    uint32_t buffer_waits;    // Frames that had to wait for a wire buffer
+} ws2812_stats_t;
 
 // WS2812 control function prototypes
 /**
@@ -53,17 +67,55 @@ struct led_state {
 esp_err_t ws2812_control_init(void);
 
 /**
- * @brief Update LED strip with new colors
+ * @brief Claim a wire buffer for the next frame
+ * 
+ * Returns one of two frame buffers that is not owned by the RMT driver,
+ * so the next frame can be rendered while the previous one is still
+ * being transmitted. Its content is undefined; every pixel must be
+ * written before ws2812_end_frame(). Only blocks (for at most
+ * WS2812_BUFFER_TIMEOUT_MS) if both buffers are still on the wire.
+ * 
+ * @return Buffer of NUM_LEDS pixels, or NULL on timeout
+ */
+ws2812_pixel_t *ws2812_begin_frame(void);
+
+/**
+ * @brief Transmit the frame claimed with ws2812_begin_frame()
  * 
- * This function transmits the new LED state to the WS2812 strip.
- * It converts the color values to the proper format and uses the
- * RMT peripheral to send the data with precise timing. This function
- * blocks until the entire sequence is transmitted.
+ * Queues the frame on the RMT peripheral and returns without waiting for
+ * the transmission. If the frame is identical to the last transmitted
+ * one, nothing is sent and the buffer is released immediately.
  * 
- * @param new_state The new LED state to display
  * @return ESP_OK on success, error code on failure
  */
-esp_err_t ws2812_write_leds(struct led_state new_state);
+esp_err_t ws2812_end_frame(void);
+
+/**
+ * @brief Wait until all submitted frames have been transmitted
+ * 
+ * @param timeout_ms Maximum time to wait in milliseconds (-1 waits forever)
+ * @return ESP_OK on success, ESP_ERR_TIMEOUT on timeout
+ */
+esp_err_t ws2812_wait_done(int timeout_ms);
+
+/**
+ * @brief Release the RMT channel while the strip is idle
+ * 
+ * Waits for the last frame to leave the wire, then disables the RMT
+ * channel so its power management lock no longer keeps the chip out of
+ * light sleep. The pixels hold their colour meanwhile. The next
+ * ws2812_end_frame() that has something to send re-enables the channel.
+ * 
+ * @return ESP_OK on success, error code on failure
+ */
+esp_err_t ws2812_idle(void);
+
+/**
+ * @brief Get WS2812 transmission statistics
+ * 
+ * @param stats Pointer to structure to fill with the current counters
+ */
+void ws2812_get_stats(ws2812_stats_t *stats);
 
 #endif
 
@@ -0,0 +1,792 @@
+/**
+ * @file focusbar_ctl.c
+ * @brief Linux companion tool for the FocusBar serial protocol
+ *
+ * Sends binary frames (main/serial_protocol.h) to a FocusBar on a serial
+ * port, or to the virtual one of focusbar_host --pty, and prints the
+ * results:
+ *
+ *   ping                          Check that the device answers
+ *   start MINUTES                 Start a run (a button preset)
+ *   stop                          Stop the run
+ *   status                        Timer state and remaining time
+ *   scene SCENE [RRGGBB [INTENSITY [PARAM]]]
+ *                                 Show off, solid, pulse or progress
+ *   tone FREQ [MS]                Play a tone (0 ms: until notone)
+ *   notone                        Stop it
+ *   perf                          Performance counters
+ *   telemetry [INTERVAL [COUNT]]  Print telemetry, every INTERVAL ms
+ *                                 until COUNT messages or Ctrl-C
+ *   logs [FILE]                   Export the device log
+ *   bench [COUNT]                 Round-trip latency and throughput
+ *
+ * Log text the device prints between frames is skipped. After a pause
+ * the device may be in light sleep, which loses the bytes that wake it,
+ * so a request is then preceded by a wake preamble; a request that still
+ * gets no response is sent once more.
+ *
+ * Usage: focusbar_ctl [--port PATH] [--baud N] COMMAND [ARGS]
+ *
+ * @author StuckAtPrototype, LLC
+ * @version 1.0
+ */
+
+#define _GNU_SOURCE
+#include "serial_frame.h"
+#include "serial_protocol.h"
+#include "telemetry.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_PORT "/dev/ttyACM0"
+#define DEFAULT_BAUD 115200
+#define RESPONSE_TIMEOUT_MS 1000
+
+// Time for the chip to wake after the preamble, well inside the 30 ms
+// FreeRTOS idles before it sleeps again
+#define WAKE_SETTLE_MS 2
+#define DEFAULT_BENCH_COUNT 1000
+
+// Requests in flight during the throughput benchmark; their frames must
+// fit in the device's UART RX buffer together
+#define BENCH_WINDOW 4
+
+// Response header: opcode, sequence number, status
+#define FRAME_HEADER_SIZE 3
+
+// Largest encoded frame, delimiters included
+#define FRAME_ENCODED_MAX (SERIAL_FRAME_ENCODED_MAX(SERIAL_FRAME_PAYLOAD_MAX + SERIAL_FRAME_CRC_SIZE) + 2)
+
+// A received frame: opcode, sequence, status and results
+typedef struct {
+    uint8_t payload[SERIAL_FRAME_PAYLOAD_MAX + SERIAL_FRAME_CRC_SIZE];
+    size_t length;
+} frame_t;
+
+// Round-trip times of one benchmark
+typedef struct {
+    int64_t *samples_us;
+    size_t count;
+} rtt_samples_t;
+
+static int port_fd = -1;
+static int port_baud = DEFAULT_BAUD;
+static uint8_t next_sequence = 0;
+static int64_t last_sent_us = -1;       // now_us() of the last write, -1 before the first
+static volatile sig_atomic_t interrupted = 0;
+
+// Receiver state, kept across calls since one read may hold several frames
+static uint8_t rx_frame[FRAME_ENCODED_MAX];
+static size_t rx_frame_length = 0;
+static bool rx_overflow = false;
+static uint8_t rx_chunk[256];
+static size_t rx_chunk_length = 0;
+static size_t rx_chunk_pos = 0;
+
+static const char *const state_names[] = { "idle", "running", "completed", "grace period", "alerting" };
+
+static const char *const telemetry_names[TELEMETRY_KEY_COUNT] = {
+    [TELEMETRY_KEY_UPTIME_MS] = "uptime_ms",
+    [TELEMETRY_KEY_STATE] = "state",
+    [TELEMETRY_KEY_PROGRESS] = "progress",
+    [TELEMETRY_KEY_REMAINING_S] = "remaining_s",
+    [TELEMETRY_KEY_LED_FRAMES] = "led_frames",
+    [TELEMETRY_KEY_WS2812_SENT] = "ws2812_sent",
+    [TELEMETRY_KEY_WS2812_SKIPPED] = "ws2812_skipped",
+    [TELEMETRY_KEY_PRESSES] = "presses",
+    [TELEMETRY_KEY_LATENCY_AVG_US] = "latency_avg_us",
+    [TELEMETRY_KEY_LATENCY_MAX_US] = "latency_max_us",
+};
+
+static const char *const perf_names[SERIAL_PERF_COUNT] = {
+    [SERIAL_PERF_UPTIME_MS] = "uptime_ms",
+    [SERIAL_PERF_BUTTON_ISRS] = "button_isrs",
+    [SERIAL_PERF_BUTTON_PRESSES] = "button_presses",
+    [SERIAL_PERF_LED_FRAMES] = "led_frames",
+    [SERIAL_PERF_LED_AVG_CYCLES] = "led_avg_cycles",
+    [SERIAL_PERF_LED_MAX_CYCLES] = "led_max_cycles",
+    [SERIAL_PERF_WS2812_SENT] = "ws2812_sent",
+    [SERIAL_PERF_WS2812_SKIPPED] = "ws2812_skipped",
+    [SERIAL_PERF_LATENCY_COUNT] = "latency_count",
+    [SERIAL_PERF_LATENCY_AVG_US] = "latency_avg_us",
+    [SERIAL_PERF_LATENCY_MAX_US] = "latency_max_us",
+    [SERIAL_PERF_FRAMES_RECEIVED] = "frames_received",
+    [SERIAL_PERF_FRAMES_REJECTED] = "frames_rejected",
+    [SERIAL_PERF_RX_OVERRUNS] = "rx_overruns",
+};
+
+static const char *const status_names[] = { "ok", "unknown opcode", "bad length", "bad argument", "failed" };
+
+/**
+ * @brief Monotonic clock in microseconds
+ */
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void handle_interrupt(int signal_number)
+{
+    (void)signal_number;
+    interrupted = 1;
+}
+
+/**
+ * @brief Map a baud rate to its termios speed
+ */
+static speed_t baud_to_speed(int baud)
+{
+    switch (baud) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        default: return B0;
+    }
+}
+
+/**
+ * @brief Open the serial port raw, dropping anything it had buffered
+ */
+static bool open_port(const char *path, int baud)
+{
+    speed_t speed = baud_to_speed(baud);
+    if (speed == B0) {
+        fprintf(stderr, "Unsupported baud rate %d\n", baud);
+        return false;
+    }
+    port_fd = open(path, O_RDWR | O_NOCTTY);
+    struct termios tio;
+    if (port_fd < 0 || tcgetattr(port_fd, &tio) != 0) {
+        perror(path);
+        return false;
+    }
+    cfmakeraw(&tio);
+    cfsetspeed(&tio, speed);
+    tio.c_cflag |= CLOCAL | CREAD;
+    if (tcsetattr(port_fd, TCSANOW, &tio) != 0) {
+        perror(path);
+        return false;
+    }
+    tcflush(port_fd, TCIOFLUSH);
+    port_baud = baud;
+    return true;
+}
+
+/**
+ * @brief Write all bytes to the port
+ */
+static bool write_port(const uint8_t *data, size_t length)
+{
+    size_t written = 0;
+    while (written < length) {
+        ssize_t ret = write(port_fd, &data[written], length - written);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("write");
+            return false;
+        }
+        written += (size_t)ret;
+    }
+    last_sent_us = now_us();
+    return true;
+}
+
+/**
+ * @brief Send the wake preamble if the device may have gone to sleep
+ *
+ * The device stays awake SERIAL_RX_AWAKE_MS after input; half of that
+ * leaves room for scheduling on both ends.
+ */
+static bool wake_if_idle(void)
+{
+    if (last_sent_us >= 0 && now_us() - last_sent_us < SERIAL_RX_AWAKE_MS * 1000LL / 2) {
+        return true;
+    }
+    static const uint8_t preamble[SERIAL_WAKE_PREAMBLE_LENGTH] = {0};
+    if (!write_port(preamble, sizeof(preamble))) {
+        return false;
+    }
+    tcdrain(port_fd);
+    usleep(WAKE_SETTLE_MS * 1000);
+    return true;
+}
+
+/**
+ * @brief Pack and send a request, waking the device first if needed
+ */
+static bool send_request(uint8_t opcode, uint8_t sequence, const uint8_t *args, size_t arg_length)
+{
+    uint8_t payload[SERIAL_FRAME_PAYLOAD_MAX + SERIAL_FRAME_CRC_SIZE];
+    uint8_t encoded[FRAME_ENCODED_MAX];
+    if (arg_length > SERIAL_FRAME_PAYLOAD_MAX - 2) {
+        return false;
+    }
+    payload[0] = opcode;
+    payload[1] = sequence;
+    if (arg_length > 0) {
+        memcpy(&payload[2], args, arg_length);
+    }
+    size_t length = serial_frame_pack(payload, 2 + arg_length, encoded);
+    return wake_if_idle() && write_port(encoded, length);
+}
+
+/**
+ * @brief Receive the next valid frame
+ *
+ * @param frame Filled with the decoded payload
+ * @param deadline_us now_us() time to give up at
+ * @return false on timeout, interrupt or a closed port
+ */
+static bool receive_frame(frame_t *frame, int64_t deadline_us)
+{
+    while (!interrupted) {
+        while (rx_chunk_pos < rx_chunk_length) {
+            uint8_t byte = rx_chunk[rx_chunk_pos++];
+            if (byte != SERIAL_FRAME_DELIMITER) {
+                if (rx_frame_length < sizeof(rx_frame)) {
+                    rx_frame[rx_frame_length++] = byte;
+                } else {
+                    rx_overflow = true;
+                }
+                continue;
+            }
+            // Text between frames, empty frames and corrupt ones fail here
+            int length = rx_frame_length > 0 && !rx_overflow ? serial_frame_unpack(rx_frame, rx_frame_length) : -1;
+            rx_frame_length = 0;
+            rx_overflow = false;
+            if (length >= FRAME_HEADER_SIZE && length <= SERIAL_FRAME_PAYLOAD_MAX) {
+                memcpy(frame->payload, rx_frame, (size_t)length);
+                frame->length = (size_t)length;
+                return true;
+            }
+        }
+
+        int64_t remaining_us = deadline_us - now_us();
+        if (remaining_us <= 0) {
+            return false;
+        }
+        struct pollfd pfd = { .fd = port_fd, .events = POLLIN };
+        int ready = poll(&pfd, 1, (int)((remaining_us + 999) / 1000));
+        if (ready <= 0) {
+            continue;       // Timeout or signal; checked at the top
+        }
+        ssize_t got = read(port_fd, rx_chunk, sizeof(rx_chunk));
+        if (got <= 0) {
+            if (got < 0 && (errno == EINTR || errno == EAGAIN)) {
+                continue;
+            }
+            fprintf(stderr, "Serial port closed\n");
+            return false;
+        }
+        rx_chunk_length = (size_t)got;
+        rx_chunk_pos = 0;
+    }
+    return false;
+}
+
+/**
+ * @brief Wait for the response to one request
+ */
+static bool wait_response(uint8_t opcode, uint8_t sequence, frame_t *response, int64_t deadline_us)
+{
+    while (receive_frame(response, deadline_us)) {
+        if (response->payload[0] == (opcode | SERIAL_OP_RESPONSE) && response->payload[1] == sequence) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Send a request and wait for its response
+ *
+ * A request without a response is sent once more with the same sequence
+ * number, so a late response to the first copy is accepted too.
+ *
+ * @param results Set to the results in the response
+ * @param result_length Number of result bytes
+ * @return Response status, or -1 if there was none
+ */
+static int transact(uint8_t opcode, const uint8_t *args, size_t arg_length, frame_t *response,
+                    const uint8_t **results, size_t *result_length)
+{
+    uint8_t sequence = next_sequence++;
+    bool answered = false;
+    for (int attempt = 0; attempt < 2 && !answered && !interrupted; attempt++) {
+        if (!send_request(opcode, sequence, args, arg_length)) {
+            return -1;
+        }
+        answered = wait_response(opcode, sequence, response, now_us() + RESPONSE_TIMEOUT_MS * 1000LL);
+    }
+    if (!answered) {
+        if (!interrupted) {
+            fprintf(stderr, "No response to opcode 0x%02x\n", opcode);
+        }
+        return -1;
+    }
+    if (results != NULL) {
+        *results = &response->payload[FRAME_HEADER_SIZE];
+        *result_length = response->length - FRAME_HEADER_SIZE;
+    }
+    return response->payload[2];
+}
+
+/**
+ * @brief Run a request whose only result is its status, and report it
+ *
+ * @return Exit code
+ */
+static int simple_command(uint8_t opcode, const uint8_t *args, size_t arg_length)
+{
+    frame_t response;
+    int status = transact(opcode, args, arg_length, &response, NULL, NULL);
+    if (status < 0) {
+        return 1;
+    }
+    if (status != SERIAL_STATUS_OK) {
+        fprintf(stderr, "Device: %s\n",
+                status < (int)(sizeof(status_names) / sizeof(status_names[0])) ? status_names[status] : "error");
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Read a CBOR unsigned integer (the only type telemetry uses)
+ *
+ * @return Bytes read, or 0 if malformed
+ */
+static size_t cbor_get_uint(const uint8_t *data, size_t length, uint8_t major, uint32_t *value)
+{
+    if (length == 0 || (data[0] & 0xE0) != major) {
+        return 0;
+    }
+    uint8_t info = data[0] & 0x1F;
+    size_t size = info < 24 ? 0 : info == 24 ? 1 : info == 25 ? 2 : info == 26 ? 4 : SIZE_MAX;
+    if (size == SIZE_MAX || length < 1 + size) {
+        return 0;
+    }
+    *value = info < 24 ? info : 0;
+    for (size_t i = 0; i < size; i++) {
+        *value = (*value << 8) | data[1 + i];
+    }
+    return 1 + size;
+}
+
+/**
+ * @brief Print a telemetry CBOR map as key=value pairs on one line
+ */
+static void print_telemetry(const uint8_t *data, size_t length)
+{
+    uint32_t pairs;
+    size_t pos = cbor_get_uint(data, length, 0xA0, &pairs);
+    if (pos == 0) {
+        printf("(malformed telemetry)\n");
+        return;
+    }
+    for (uint32_t i = 0; i < pairs; i++) {
+        uint32_t key, value;
+        size_t key_size = cbor_get_uint(&data[pos], length - pos, 0x00, &key);
+        size_t value_size = key_size > 0 ? cbor_get_uint(&data[pos + key_size], length - pos - key_size, 0x00, &value) : 0;
+        if (value_size == 0) {
+            printf(" (malformed)");
+            break;
+        }
+        pos += key_size + value_size;
+        if (key < TELEMETRY_KEY_COUNT) {
+            printf("%s%s=%" PRIu32, i > 0 ? " " : "", telemetry_names[key], value);
+        } else {
+            printf("%s%" PRIu32 "=%" PRIu32, i > 0 ? " " : "", key, value);
+        }
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+static int command_ping(void)
+{
+    frame_t response;
+    static const uint8_t probe[] = { 'F', 'B', 0x00, 0xFF };
+    int64_t start_us = now_us();
+    const uint8_t *results;
+    size_t result_length;
+    int status = transact(SERIAL_OP_PING, probe, sizeof(probe), &response, &results, &result_length);
+    if (status < 0) {
+        return 1;
+    }
+    if (status != SERIAL_STATUS_OK || result_length != sizeof(probe) || memcmp(results, probe, sizeof(probe)) != 0) {
+        fprintf(stderr, "Bad ping response\n");
+        return 1;
+    }
+    printf("Pong in %" PRId64 " us\n", now_us() - start_us);
+    return 0;
+}
+
+static int command_status(void)
+{
+    frame_t response;
+    const uint8_t *results;
+    size_t result_length;
+    int status = transact(SERIAL_OP_TIMER_QUERY, NULL, 0, &response, &results, &result_length);
+    if (status != SERIAL_STATUS_OK || result_length < 9) {
+        return 1;
+    }
+    uint32_t remaining_ms = serial_frame_get_u32(&results[1]);
+    uint32_t run_ms = serial_frame_get_u32(&results[5]);
+    printf("%s", results[0] < sizeof(state_names) / sizeof(state_names[0]) ? state_names[results[0]] : "unknown");
+    if (run_ms > 0) {
+        printf(", %" PRIu32 ":%02" PRIu32 " of %" PRIu32 " min left", remaining_ms / 60000,
+               remaining_ms / 1000 % 60, run_ms / 60000);
+    }
+    printf("\n");
+    return 0;
+}
+
+static int command_scene(int argc, char **argv)
+{
+    static const char *const scene_names[] = { "off", "solid", "pulse", "progress" };
+    int scene = -1;
+    for (int i = 0; argc > 0 && i < 4; i++) {
+        if (strcmp(argv[0], scene_names[i]) == 0) {
+            scene = i;
+        }
+    }
+    if (scene < 0) {
+        fprintf(stderr, "Usage: scene off|solid|pulse|progress [RRGGBB [INTENSITY [PARAM]]]\n");
+        return 2;
+    }
+    // RRGGBB as usual on the command line; the protocol takes 0x00GGRRBB
+    uint32_t rgb = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 16) : 0xFFFFFF;
+    uint32_t color = ((rgb & 0x00FF00) << 8) | ((rgb & 0xFF0000) >> 8) | (rgb & 0x0000FF);
+    uint8_t args[9];
+    args[0] = (uint8_t)scene;
+    args[1] = (uint8_t)(argc > 2 ? atoi(argv[2]) : 255);
+    serial_frame_put_u32(&args[2], color);
+    args[6] = 0;
+    serial_frame_put_u16(&args[7], (uint16_t)(argc > 3 ? atoi(argv[3]) : (scene == SERIAL_LED_PROGRESS ? 65535 : 0)));
+    return simple_command(SERIAL_OP_LED_SCENE, args, sizeof(args));
+}
+
+static int command_perf(void)
+{
+    frame_t response;
+    const uint8_t *results;
+    size_t result_length;
+    int status = transact(SERIAL_OP_PERF, NULL, 0, &response, &results, &result_length);
+    if (status != SERIAL_STATUS_OK) {
+        return 1;
+    }
+    for (size_t i = 0; i < SERIAL_PERF_COUNT && 4 * i + 4 <= result_length; i++) {
+        printf("%-16s %" PRIu32 "\n", perf_names[i], serial_frame_get_u32(&results[4 * i]));
+    }
+    return 0;
+}
+
+static int command_telemetry(int argc, char **argv)
+{
+    uint16_t interval_ms = (uint16_t)(argc > 0 ? atoi(argv[0]) : 0);
+    long count = argc > 1 ? atol(argv[1]) : 0;
+    uint8_t args[2];
+    serial_frame_put_u16(args, interval_ms);
+
+    frame_t response;
+    const uint8_t *results;
+    size_t result_length;
+    int status = transact(SERIAL_OP_TELEMETRY, args, sizeof(args), &response, &results, &result_length);
+    if (status != SERIAL_STATUS_OK) {
+        if (status > 0) {
+            fprintf(stderr, "Interval must be 0 or at least %d ms\n", SERIAL_TELEMETRY_MIN_INTERVAL_MS);
+        }
+        return 1;
+    }
+    print_telemetry(results, result_length);
+    if (interval_ms == 0) {
+        return 0;
+    }
+
+    // Streamed messages until COUNT or Ctrl-C, then unsubscribe; a ping
+    // every half lease keeps the subscription alive
+    long received = 1;
+    int64_t renewed_us = now_us();
+    while (!interrupted && (count == 0 || received < count)) {
+        if (!receive_frame(&response, now_us() + 2 * (interval_ms + RESPONSE_TIMEOUT_MS) * 1000LL)) {
+            break;
+        }
+        if (response.payload[0] == (SERIAL_OP_TELEMETRY | SERIAL_OP_RESPONSE)) {
+            print_telemetry(&response.payload[FRAME_HEADER_SIZE], response.length - FRAME_HEADER_SIZE);
+            received++;
+        }
+        if (now_us() - renewed_us >= SERIAL_TELEMETRY_LEASE_MS * 1000LL / 2) {
+            send_request(SERIAL_OP_PING, next_sequence++, NULL, 0);
+            renewed_us = now_us();
+        }
+    }
+    interrupted = 0;
+    serial_frame_put_u16(args, 0);
+    return transact(SERIAL_OP_TELEMETRY, args, sizeof(args), &response, NULL, NULL) == SERIAL_STATUS_OK ? 0 : 1;
+}
+
+/**
+ * @brief Read the device log from its oldest kept byte to its end
+ *
+ * @param out Where the text goes, or NULL to only count it
+ * @param bytes Number of bytes read
+ * @return Exit code
+ */
+static int export_log(FILE *out, size_t *bytes)
+{
+    uint32_t position = 0;
+    *bytes = 0;
+    while (1) {
+        uint8_t args[4];
+        serial_frame_put_u32(args, position);
+        frame_t response;
+        const uint8_t *results;
+        size_t result_length;
+        if (transact(SERIAL_OP_LOG_READ, args, sizeof(args), &response, &results, &result_length) != SERIAL_STATUS_OK ||
+            result_length < 8) {
+            return 1;
+        }
+        uint32_t first = serial_frame_get_u32(&results[0]);
+        size_t length = result_length - 8;
+        if (first != position && position != 0) {
+            fprintf(stderr, "%" PRIu32 " bytes of log overwritten while reading\n", first - position);
+        }
+        if (length == 0) {
+            return 0;
+        }
+        if (out != NULL) {
+            fwrite(&results[8], 1, length, out);
+        }
+        *bytes += length;
+        position = first + (uint32_t)length;
+    }
+}
+
+static int command_logs(int argc, char **argv)
+{
+    FILE *out = stdout;
+    if (argc > 0 && (out = fopen(argv[0], "w")) == NULL) {
+        perror(argv[0]);
+        return 1;
+    }
+    size_t bytes;
+    int64_t start_us = now_us();
+    int ret = export_log(out, &bytes);
+    int64_t elapsed_us = now_us() - start_us;
+    if (out != stdout) {
+        fclose(out);
+    }
+    fprintf(stderr, "%zu bytes of log in %.1f ms\n", bytes, elapsed_us / 1000.0);
+    return ret;
+}
+
+static int compare_int64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Print min, median, 99th percentile and max of round-trip times
+ *
+ * Also prints how long the frames alone take on a UART at the port's
+ * baud rate, 10 bits per byte; a pseudo-terminal has no such limit.
+ */
+static void report_rtt(const char *name, rtt_samples_t *rtt, size_t request_bytes, size_t response_bytes)
+{
+    if (rtt->count == 0) {
+        printf("%-18s no responses\n", name);
+        return;
+    }
+    qsort(rtt->samples_us, rtt->count, sizeof(int64_t), compare_int64);
+    int64_t total_us = 0;
+    for (size_t i = 0; i < rtt->count; i++) {
+        total_us += rtt->samples_us[i];
+    }
+    double wire_us = (request_bytes + response_bytes) * 10 * 1e6 / port_baud;
+    printf("%-18s min %6" PRId64 "  median %6" PRId64 "  p99 %6" PRId64 "  max %6" PRId64
+           "  avg %8.1f us  (wire at %d baud: %.0f us)\n", name, rtt->samples_us[0],
+           rtt->samples_us[rtt->count / 2], rtt->samples_us[rtt->count * 99 / 100], rtt->samples_us[rtt->count - 1],
+           (double)total_us / rtt->count, port_baud, wire_us);
+}
+
+/**
+ * @brief Time COUNT pings one at a time
+ */
+static void bench_round_trip(const char *name, size_t payload_length, size_t count)
+{
+    uint8_t probe[SERIAL_FRAME_PAYLOAD_MAX];
+    for (size_t i = 0; i < payload_length; i++) {
+        probe[i] = (uint8_t)i;      // Includes zeros, so COBS has work to do
+    }
+    rtt_samples_t rtt = { .samples_us = calloc(count, sizeof(int64_t)), .count = 0 };
+    for (size_t i = 0; i < count && !interrupted; i++) {
+        frame_t response;
+        int64_t start_us = now_us();
+        if (transact(SERIAL_OP_PING, probe, payload_length, &response, NULL, NULL) != SERIAL_STATUS_OK) {
+            break;
+        }
+        rtt.samples_us[rtt.count++] = now_us() - start_us;
+    }
+
+    // Frame sizes for the wire time, with a typical sequence number
+    uint8_t payload[SERIAL_FRAME_PAYLOAD_MAX + SERIAL_FRAME_CRC_SIZE];
+    uint8_t encoded[FRAME_ENCODED_MAX];
+    payload[0] = SERIAL_OP_PING;
+    payload[1] = 1;
+    memcpy(&payload[2], probe, payload_length);
+    size_t request_bytes = serial_frame_pack(payload, 2 + payload_length, encoded);
+    payload[0] = SERIAL_OP_PING | SERIAL_OP_RESPONSE;
+    payload[2] = SERIAL_STATUS_OK;
+    memcpy(&payload[3], probe, payload_length);
+    size_t response_bytes = serial_frame_pack(payload, FRAME_HEADER_SIZE + payload_length, encoded);
+    report_rtt(name, &rtt, request_bytes, response_bytes);
+    free(rtt.samples_us);
+}
+
+/**
+ * @brief Keep BENCH_WINDOW of the largest pings in flight
+ */
+static void bench_throughput(size_t count)
+{
+    static uint8_t probe[SERIAL_FRAME_PAYLOAD_MAX - FRAME_HEADER_SIZE];
+    size_t sent = 0;
+    size_t done = 0;
+    uint8_t first_sequence = next_sequence;
+    int64_t start_us = now_us();
+    while (done < count && !interrupted) {
+        while (sent < count && sent - done < BENCH_WINDOW) {
+            if (!send_request(SERIAL_OP_PING, (uint8_t)(first_sequence + sent), probe, sizeof(probe))) {
+                return;
+            }
+            sent++;
+        }
+        // Responses come back in order
+        frame_t response;
+        if (!wait_response(SERIAL_OP_PING, (uint8_t)(first_sequence + done), &response,
+                           now_us() + RESPONSE_TIMEOUT_MS * 1000LL)) {
+            fprintf(stderr, "Lost response %zu\n", done);
+            break;
+        }
+        done++;
+    }
+    int64_t elapsed_us = now_us() - start_us;
+    next_sequence = (uint8_t)(first_sequence + sent);
+    if (done > 0 && elapsed_us > 0) {
+        printf("%-18s %zu pings of %zu bytes, %zu in flight: %.0f frames/s, %.1f kB/s each way\n",
+               "throughput", done, sizeof(probe), (size_t)BENCH_WINDOW, done * 1e6 / elapsed_us,
+               done * sizeof(probe) * 1e3 / elapsed_us);
+    }
+}
+
+static int command_bench(int argc, char **argv)
+{
+    size_t count = argc > 0 ? (size_t)atol(argv[0]) : DEFAULT_BENCH_COUNT;
+    if (count == 0) {
+        return 2;
+    }
+    wake_if_idle();     // Not part of the first sample
+    bench_round_trip("ping, empty", 0, count);
+    bench_round_trip("ping, 93 bytes", SERIAL_FRAME_PAYLOAD_MAX - FRAME_HEADER_SIZE, count);
+    bench_throughput(count);
+
+    size_t bytes;
+    int64_t start_us = now_us();
+    if (export_log(NULL, &bytes) != 0) {
+        return 1;
+    }
+    int64_t elapsed_us = now_us() - start_us;
+    printf("%-18s %zu bytes in %.1f ms: %.1f kB/s\n", "log export", bytes, elapsed_us / 1000.0,
+           elapsed_us > 0 ? bytes * 1e3 / elapsed_us : 0.0);
+    return interrupted ? 1 : 0;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [--port PATH] [--baud N] COMMAND [ARGS]\n"
+            "Commands: ping, start MINUTES, stop, status, scene SCENE [RRGGBB [INTENSITY [PARAM]]],\n"
+            "          tone FREQ [MS], notone, perf, telemetry [INTERVAL [COUNT]], logs [FILE], bench [COUNT]\n",
+            program);
+}
+
+int main(int argc, char **argv)
+{
+    const char *port = DEFAULT_PORT;
+    int baud = DEFAULT_BAUD;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = argv[++i];
+        } else if (strcmp(argv[i], "--baud") == 0 && i + 1 < argc) {
+            baud = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (i >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+    const char *command = argv[i];
+    int command_argc = argc - i - 1;
+    char **command_argv = &argv[i + 1];
+
+    struct sigaction action = { .sa_handler = handle_interrupt };
+    sigaction(SIGINT, &action, NULL);
+    if (!open_port(port, baud)) {
+        return 1;
+    }
+
+    uint8_t args[4];
+    if (strcmp(command, "ping") == 0) {
+        return command_ping();
+    } else if (strcmp(command, "start") == 0 && command_argc == 1) {
+        args[0] = (uint8_t)atoi(command_argv[0]);
+        return simple_command(SERIAL_OP_TIMER_START, args, 1);
+    } else if (strcmp(command, "stop") == 0) {
+        return simple_command(SERIAL_OP_TIMER_STOP, NULL, 0);
+    } else if (strcmp(command, "status") == 0) {
+        return command_status();
+    } else if (strcmp(command, "scene") == 0) {
+        return command_scene(command_argc, command_argv);
+    } else if (strcmp(command, "tone") == 0 && command_argc >= 1) {
+        serial_frame_put_u16(&args[0], (uint16_t)atoi(command_argv[0]));
+        serial_frame_put_u16(&args[2], (uint16_t)(command_argc > 1 ? atoi(command_argv[1]) : 200));
+        return simple_command(SERIAL_OP_PLAY_TONE, args, 4);
+    } else if (strcmp(command, "notone") == 0) {
+        return simple_command(SERIAL_OP_STOP_TONE, NULL, 0);
+    } else if (strcmp(command, "perf") == 0) {
+        return command_perf();
+    } else if (strcmp(command, "telemetry") == 0) {
+        return command_telemetry(command_argc, command_argv);
+    } else if (strcmp(command, "logs") == 0) {
+        return command_logs(command_argc, command_argv);
+    } else if (strcmp(command, "bench") == 0) {
+        return command_bench(command_argc, command_argv);
+    }
+    usage(argv[0]);
+    return 2;
+}
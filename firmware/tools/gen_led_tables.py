@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+"""
+Generate the constant lookup tables used by the LED renderer.
+
+The tables are emitted as a C source/header pair and compiled into flash,
+so the firmware never evaluates transcendental functions at run time.
+
+Usage: gen_led_tables.py [--curve cie|gamma2] [--white-balance R G B] <output_dir>
+"""
+
+import argparse
+import math
+import os
+
+WAVE_TABLE_BITS = 8
+WAVE_TABLE_SIZE = 1 << WAVE_TABLE_BITS
+WAVE_MAX = 65535
+
+LUT_SIZE = 256
+LUMINANCE_MAX = 65535
+
+HEADER_BANNER = """\
+/*
+ * Generated by firmware/tools/gen_led_tables.py - do not edit.
+ */
+"""
+
+
+def wave_sine(x):
+    """Sine between 0 and 1, starting at mid level and rising."""
+    return (math.sin(2.0 * math.pi * x) + 1.0) / 2.0
+
+
+def wave_triangle(x):
+    """Triangle between 0 and 1, in phase with the sine."""
+    x = (x + 0.25) % 1.0
+    return 2.0 * x if x < 0.5 else 2.0 * (1.0 - x)
+
+
+def wave_breathe(x):
+    """Exponential of a sine, lingering near dark like a breathing light."""
+    e = math.e
+    return (math.exp(math.sin(2.0 * math.pi * x)) - 1.0 / e) / (e - 1.0 / e)
+
+
+def wave_square(x):
+    """Square wave, on for the first half of the period."""
+    return 1.0 if x < 0.5 else 0.0
+
+
+WAVEFORMS = [
+    ("sine", wave_sine),
+    ("triangle", wave_triangle),
+    ("breathe", wave_breathe),
+    ("square", wave_square),
+]
+
+
+def lightness_cie(x):
+    """CIE 1931 relative luminance for a perceived lightness L* = 100 * x."""
+    lightness = 100.0 * x
+    if lightness <= 8.0:
+        return lightness / 903.3
+    return ((lightness + 16.0) / 116.0) ** 3
+
+
+def lightness_gamma2(x):
+    """Square law, the curve the renderer used before the lookup tables."""
+    return x * x
+
+
+CURVES = {
+    "cie": lightness_cie,
+    "gamma2": lightness_gamma2,
+}
+
+
+def format_table(ctype, name, values, per_line=8):
+    lines = [f"const {ctype} {name}[{len(values)}] = {{"]
+    for i in range(0, len(values), per_line):
+        chunk = ", ".join(f"{v:5d}" for v in values[i:i + per_line])
+        lines.append(f"    {chunk},")
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def wave_tables():
+    tables = []
+    for name, func in WAVEFORMS:
+        values = [round(func(i / WAVE_TABLE_SIZE) * WAVE_MAX) for i in range(WAVE_TABLE_SIZE)]
+        tables.append((name, values))
+    return tables
+
+
+def lightness_table(curve):
+    func = CURVES[curve]
+    return [round(func(i / (LUT_SIZE - 1)) * LUMINANCE_MAX) for i in range(LUT_SIZE)]
+
+
+def white_balance_table(scale):
+    return [round(i * scale / 255) for i in range(LUT_SIZE)]
+
+
+def write_header(path, args):
+    with open(path, "w") as f:
+        f.write(HEADER_BANNER)
+        f.write("\n#ifndef LED_TABLES_H\n#define LED_TABLES_H\n\n#include <stdint.h>\n\n")
+        f.write(f"#define LED_WAVE_TABLE_BITS {WAVE_TABLE_BITS}\n")
+        f.write(f"#define LED_WAVE_TABLE_SIZE {WAVE_TABLE_SIZE}\n\n")
+        f.write("// Waveform indices into led_wave_tables\n")
+        for index, (name, _) in enumerate(WAVEFORMS):
+            f.write(f"#define LED_WAVE_INDEX_{name.upper()} {index}\n")
+        f.write(f"#define LED_WAVE_COUNT {len(WAVEFORMS)}\n\n")
+        f.write("// One period of each pulse waveform, 0 (off) to 65535 (full brightness)\n")
+        f.write("extern const uint16_t *const led_wave_tables[LED_WAVE_COUNT];\n\n")
+        f.write(f"#define LED_LUT_SIZE {LUT_SIZE}\n\n")
+        f.write(f"// Perceived brightness (index 0-255) to linear luminance (0-65535), {args.curve} curve\n")
+        f.write("extern const uint16_t led_lut_lightness[LED_LUT_SIZE];\n\n")
+        f.write("// Per-channel white balance, indexed [channel][value] in wire order (G, R, B)\n")
+        f.write("extern const uint8_t led_lut_white_balance[3][LED_LUT_SIZE];\n\n")
+        f.write("#endif // LED_TABLES_H\n")
+
+
+def write_source(path, args):
+    with open(path, "w") as f:
+        f.write(HEADER_BANNER)
+        f.write('\n#include "led_tables.h"\n\n')
+        names = []
+        for name, values in wave_tables():
+            table_name = f"led_wave_{name}"
+            names.append(table_name)
+            f.write("static " + format_table("uint16_t", table_name, values) + "\n\n")
+        f.write("const uint16_t *const led_wave_tables[LED_WAVE_COUNT] = {\n")
+        for table_name in names:
+            f.write(f"    {table_name},\n")
+        f.write("};\n\n")
+
+        f.write(format_table("uint16_t", "led_lut_lightness", lightness_table(args.curve)) + "\n\n")
+
+        red, green, blue = args.white_balance
+        f.write("const uint8_t led_lut_white_balance[3][LED_LUT_SIZE] = {\n")
+        for name, scale in (("green", green), ("red", red), ("blue", blue)):
+            f.write(f"    // {name}, scale {scale}/255\n")
+            f.write("    {\n")
+            values = white_balance_table(scale)
+            for i in range(0, len(values), 16):
+                f.write("        " + ", ".join(f"{v:3d}" for v in values[i:i + 16]) + ",\n")
+            f.write("    },\n")
+        f.write("};\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--curve", choices=sorted(CURVES), default="cie",
+                        help="Brightness curve for the lightness table (default: cie)")
+    parser.add_argument("--white-balance", type=int, nargs=3, metavar=("R", "G", "B"),
+                        default=[255, 255, 255],
+                        help="Full-scale output of each channel, 0-255 (default: 255 255 255)")
+    parser.add_argument("output_dir", help="Directory for led_tables.c and led_tables.h")
+    args = parser.parse_args()
+
+    if any(not 0 <= scale <= 255 for scale in args.white_balance):
+        parser.error("white balance scales must be between 0 and 255")
+
+    os.makedirs(args.output_dir, exist_ok=True)
+    write_header(os.path.join(args.output_dir, "led_tables.h"), args)
+    write_source(os.path.join(args.output_dir, "led_tables.c"), args)
+
+
+if __name__ == "__main__":
+    main()
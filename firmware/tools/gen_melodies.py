@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""
+Compile RTTTL melodies into the packed format the piezo sequencer plays.
+
+Each note is one 16-bit word: the pitch in the top 6 bits (0 for a rest,
+p for MIDI note 56 + p) and the duration in 5 ms units in the low 10 bits.
+The built-in melodies are emitted as a C source/header pair and compiled
+into flash together with the pitch to frequency table, so the firmware
+never parses a melody. --hex prints one melody as the hex string the
+"tune store" serial command takes, for melodies kept in NVS.
+
+Usage: gen_melodies.py [--melodies FILE] <output_dir>
+       gen_melodies.py --hex RTTTL
+"""
+
+import argparse
+import os
+import re
+import sys
+
+# Must match melody.h; melody_tables.c checks them at compile time
+PITCH_BITS = 6
+DURATION_BITS = 10
+DURATION_UNIT_MS = 5
+MIDI_BASE = 56
+MAX_NOTES = 64
+
+PITCHES = 1 << PITCH_BITS
+MAX_DURATION = (1 << DURATION_BITS) - 1
+
+SEMITONES = {"c": 0, "d": 2, "e": 4, "f": 5, "g": 7, "a": 9, "b": 11, "h": 11}
+NOTE_RE = re.compile(r"^(\d+)?([a-hp])(#)?(\.)?(\d)?(\.)?$")
+
+HEADER_BANNER = """\
+/*
+ * Generated by firmware/tools/gen_melodies.py - do not edit.
+ */
+"""
+
+
+class MelodyError(Exception):
+    pass
+
+
+def pitch_hz(pitch):
+    """Equal-tempered frequency of a pitch index, 0 for a rest."""
+    if pitch == 0:
+        return 0
+    return round(440.0 * 2.0 ** ((MIDI_BASE + pitch - 69) / 12.0))
+
+
+def parse_rtttl(text):
+    """Parse 'name:d=4,o=6,b=120:notes' into (name, packed words)."""
+    parts = text.strip().split(":")
+    if len(parts) != 3:
+        raise MelodyError(f"expected name:defaults:notes, got {text.strip()!r}")
+    name, defaults, notes = (part.strip() for part in parts)
+    if not re.match(r"^[a-z_][a-z0-9_]*$", name):
+        raise MelodyError(f"melody name {name!r} is not a C identifier")
+
+    settings = {"d": 4, "o": 6, "b": 63}
+    for item in filter(None, (d.strip() for d in defaults.split(","))):
+        key, _, value = item.partition("=")
+        if key not in settings or not value.isdigit() or int(value) == 0:
+            raise MelodyError(f"{name}: bad default {item!r}")
+        settings[key] = int(value)
+    whole_ms = 4 * 60000.0 / settings["b"]
+
+    words = []
+    for token in filter(None, (n.strip().lower() for n in notes.split(","))):
+        match = NOTE_RE.match(token)
+        if not match:
+            raise MelodyError(f"{name}: bad note {token!r}")
+        length, letter, sharp, dot1, octave, dot2 = match.groups()
+        duration_ms = whole_ms / int(length or settings["d"])
+        if dot1 or dot2:
+            duration_ms *= 1.5
+        duration = round(duration_ms / DURATION_UNIT_MS)
+        if not 1 <= duration <= MAX_DURATION:
+            raise MelodyError(f"{name}: {token!r} lasts {duration_ms:.0f} ms, outside "
+                              f"{DURATION_UNIT_MS}..{MAX_DURATION * DURATION_UNIT_MS} ms")
+
+        pitch = 0
+        if letter != "p":
+            midi = 12 * (int(octave or settings["o"]) + 1) + SEMITONES[letter] + (1 if sharp else 0)
+            pitch = midi - MIDI_BASE
+            if not 1 <= pitch < PITCHES:
+                raise MelodyError(f"{name}: {token!r} is out of range "
+                                  f"({pitch_hz(1)}..{pitch_hz(PITCHES - 1)} Hz)")
+        words.append(pitch << DURATION_BITS | duration)
+
+    if not 1 <= len(words) <= MAX_NOTES:
+        raise MelodyError(f"{name}: {len(words)} notes, expected 1..{MAX_NOTES}")
+    return name, words
+
+
+def read_melodies(path):
+    melodies = []
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            line = line.strip()
+            if not line or line.startswith("#"):
+                continue
+            try:
+                melodies.append(parse_rtttl(line))
+            except MelodyError as e:
+                raise MelodyError(f"{path}:{number}: {e}")
+    names = [name for name, _ in melodies]
+    if len(set(names)) != len(names):
+        raise MelodyError(f"{path}: duplicate melody names")
+    return melodies
+
+
+def write_header(path, melodies):
+    with open(path, "w") as f:
+        f.write(HEADER_BANNER)
+        f.write('\n#ifndef MELODY_TABLES_H\n#define MELODY_TABLES_H\n\n#include "melody.h"\n\n')
+        f.write("// Frequency of each pitch index in Hz, 0 for a rest\n")
+        f.write("extern const uint16_t melody_pitch_hz[MELODY_PITCHES];\n\n")
+        f.write("// Built-in melodies\n")
+        for name, _ in melodies:
+            f.write(f"extern const melody_t melody_{name};\n")
+        f.write("\n#endif // MELODY_TABLES_H\n")
+
+
+def write_source(path, melodies):
+    with open(path, "w") as f:
+        f.write(HEADER_BANNER)
+        f.write('\n#include "melody_tables.h"\n\n')
+        f.write(f"_Static_assert(MELODY_PITCH_BITS == {PITCH_BITS} && MELODY_DURATION_BITS == {DURATION_BITS} &&\n")
+        f.write(f"               MELODY_DURATION_UNIT_MS == {DURATION_UNIT_MS} && MELODY_MIDI_BASE == {MIDI_BASE},\n")
+        f.write('               "melody.h does not match gen_melodies.py");\n\n')
+
+        values = [pitch_hz(p) for p in range(PITCHES)]
+        f.write("const uint16_t melody_pitch_hz[MELODY_PITCHES] = {\n")
+        for i in range(0, PITCHES, 8):
+            f.write("    " + ", ".join(f"{v:5d}" for v in values[i:i + 8]) + ",\n")
+        f.write("};\n")
+
+        for name, words in melodies:
+            f.write(f"\nstatic const uint16_t melody_{name}_notes[{len(words)}] = {{\n")
+            for i in range(0, len(words), 8):
+                f.write("    " + ", ".join(f"0x{w:04x}" for w in words[i:i + 8]) + ",\n")
+            f.write("};\n")
+            f.write(f"const melody_t melody_{name} = {{ melody_{name}_notes, {len(words)} }};\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--melodies", help="RTTTL file with one melody per line")
+    parser.add_argument("--hex", metavar="RTTTL", help="Print one melody packed as hex and exit")
+    parser.add_argument("output_dir", nargs="?", help="Directory for melody_tables.c and melody_tables.h")
+    args = parser.parse_args()
+
+    try:
+        if args.hex is not None:
+            _, words = parse_rtttl(args.hex)
+            print("".join(f"{w:04x}" for w in words))
+            return
+        if args.output_dir is None or args.melodies is None:
+            parser.error("--melodies and output_dir are required unless --hex is given")
+        melodies = read_melodies(args.melodies)
+    except (MelodyError, OSError) as e:
+        sys.exit(f"gen_melodies.py: {e}")
+
+    os.makedirs(args.output_dir, exist_ok=True)
+    write_header(os.path.join(args.output_dir, "melody_tables.h"), melodies)
+    write_source(os.path.join(args.output_dir, "melody_tables.c"), melodies)
+
+
+if __name__ == "__main__":
+    main()